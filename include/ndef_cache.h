@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#ifndef NDEF_CACHE_H
+#define NDEF_CACHE_H
+
+#include "ndef_rec.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Bounded LRU cache of parsed NDEF messages, keyed by the content of
+ * the raw data. For repeatedly presented tags, a cache hit returns a new
+ * reference to the chain of records parsed the first time around,
+ * without parsing anything. Failures are not cached.
+ *
+ * The cache can be shared by multiple threads. The records it returns
+ * are shared too and must be treated as read-only. For that reason,
+ * NDEF_PARSE_FLAG_LAZY is ignored, the records are always fully decoded.
+ * The records parsed before the parse limits were changed stay in the
+ * cache until they get evicted or the cache is cleared.
+ *
+ * Zero max_entries selects the default size.
+ */
+
+typedef struct ndef_parse_cache NdefParseCache; /* Since 1.1.0 */
+
+typedef struct ndef_parse_cache_stats {
+    guint hits;
+    guint misses;
+    guint entries;
+} NdefParseCacheStats; /* Since 1.1.0 */
+
+NdefParseCache*
+ndef_parse_cache_new(
+    guint max_entries); /* Since 1.1.0 */
+
+void
+ndef_parse_cache_free(
+    NdefParseCache* cache); /* Since 1.1.0 */
+
+void
+ndef_parse_cache_clear(
+    NdefParseCache* cache); /* Since 1.1.0 */
+
+void
+ndef_parse_cache_get_stats(
+    NdefParseCache* cache,
+    NdefParseCacheStats* stats); /* Since 1.1.0 */
+
+NdefRec*
+ndef_parse_cache_rec_new(
+    NdefParseCache* cache,
+    const GUtilData* block,
+    NDEF_PARSE_FLAGS flags); /* Since 1.1.0 */
+
+NdefRec*
+ndef_parse_cache_rec_new_from_tlv(
+    NdefParseCache* cache,
+    const GUtilData* tlv,
+    NDEF_PARSE_FLAGS flags); /* Since 1.1.0 */
+
+G_END_DECLS
+
+#endif /* NDEF_CACHE_H */
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
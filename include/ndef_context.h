@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#ifndef NDEF_CONTEXT_H
+#define NDEF_CONTEXT_H
+
+#include "ndef_rec.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Parse context for bulk decoding. The raw data and the decoded strings
+ * of the records parsed with the context are carved out of large chunks
+ * of memory owned by the context, instead of being allocated one by one.
+ *
+ * ndef_parse_context_reset() releases all chunks at once and starts from
+ * scratch. The records remain valid even if they outlive the reset, the
+ * chunks which are still in use are freed when the last record pointing
+ * to them is gone.
+ *
+ * The context itself is not thread-safe, it's supposed to be used by
+ * one thread at a time. The records parsed with it can be handed over
+ * to (and released by) other threads, even while the context is being
+ * used, reset or freed.
+ */
+
+typedef struct ndef_parse_context NdefParseContext; /* Since 1.1.0 */
+
+NdefParseContext*
+ndef_parse_context_new(
+    gsize chunk_size); /* Since 1.1.0 */
+
+void
+ndef_parse_context_free(
+    NdefParseContext* ctx); /* Since 1.1.0 */
+
+void
+ndef_parse_context_reset(
+    NdefParseContext* ctx); /* Since 1.1.0 */
+
+NdefRec*
+ndef_parse_context_rec_new(
+    NdefParseContext* ctx,
+    const GUtilData* block,
+    NDEF_PARSE_FLAGS flags); /* Since 1.1.0 */
+
+NdefRec*
+ndef_parse_context_rec_new_from_tlv(
+    NdefParseContext* ctx,
+    const GUtilData* tlv,
+    NDEF_PARSE_FLAGS flags); /* Since 1.1.0 */
+
+/*
+ * Parses a batch of independent NDEF messages (or TLV sequences) on up
+ * to max_threads threads, including the calling one. Zero means one
+ * thread per CPU. Each thread parses with its own context. The chain of
+ * records parsed from blocks[i] is stored in recs[i] (NULL if nothing
+ * could be parsed), regardless of the order in which the blocks happen
+ * to be processed. The function returns when the whole batch is done.
+ *
+ * The caller owns the returned records and may release them on any
+ * thread.
+ */
+void
+ndef_parse_batch(
+    const GUtilData* blocks,
+    NdefRec** recs,
+    guint count,
+    NDEF_PARSE_FLAGS flags,
+    guint max_threads); /* Since 1.1.0 */
+
+void
+ndef_parse_batch_tlv(
+    const GUtilData* tlvs,
+    NdefRec** recs,
+    guint count,
+    NDEF_PARSE_FLAGS flags,
+    guint max_threads); /* Since 1.1.0 */
+
+G_END_DECLS
+
+#endif /* NDEF_CONTEXT_H */
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#ifndef NDEF_MSG_H
+#define NDEF_MSG_H
+
+#include "ndef_rec.h"
+#include "ndef_tlv.h"
+
+G_BEGIN_DECLS
+
+/*
+ * NDEF message, the records stored in an array. The records are still
+ * linked into the chain (via NdefRec->next), so the first record can be
+ * passed wherever a chain of records is expected.
+ *
+ * Both the array and the records are read-only. NdefMsg holds its own
+ * references to the records, they stay alive as long as the message
+ * object is alive.
+ */
+
+typedef struct ndef_msg {
+    NdefRec* const* rec;
+    guint count;
+} NdefMsg; /* Since 1.1.0 */
+
+NdefMsg*
+ndef_msg_new(
+    const GUtilData* block,
+    NDEF_PARSE_FLAGS flags); /* Since 1.1.0 */
+
+NdefMsg*
+ndef_msg_new_from_tlv(
+    const GUtilData* tlv,
+    NDEF_PARSE_FLAGS flags); /* Since 1.1.0 */
+
+NdefMsg*
+ndef_msg_new_from_rec(
+    NdefRec* rec); /* Since 1.1.0 */
+
+NdefMsg*
+ndef_msg_ref(
+    NdefMsg* msg); /* Since 1.1.0 */
+
+void
+ndef_msg_unref(
+    NdefMsg* msg); /* Since 1.1.0 */
+
+NdefRec*
+ndef_msg_rec_at(
+    const NdefMsg* msg,
+    guint index); /* Since 1.1.0 */
+
+NdefRec*
+ndef_msg_last(
+    const NdefMsg* msg); /* Since 1.1.0 */
+
+/* Returns -1 if the record doesn't belong to the message */
+int
+ndef_msg_index_of(
+    const NdefMsg* msg,
+    const NdefRec* rec); /* Since 1.1.0 */
+
+/*
+ * Allocation-free iteration over the records of an NDEF message.
+ * The views point directly into the block being iterated, nothing
+ * gets copied. Chunked records (all the chunks, including the
+ * terminating one) and stray chunks are skipped, i.e. the iterator
+ * yields the same records as ndef_rec_new() would return, except
+ * for the chunked ones. Iteration stops at the first malformed record.
+ * Usage:
+ *
+ * NdefRecIter it;
+ * NdefRecView view;
+ *
+ * ndef_rec_iter_init(&it, &block);
+ * while (ndef_rec_iter_next(&it, &view)) {
+ *   ... analyze view
+ * }
+ */
+
+typedef struct ndef_rec_view {
+    NDEF_TNF tnf;
+    NDEF_REC_FLAGS flags;
+    GUtilData raw;
+    GUtilData type;
+    GUtilData id;
+    GUtilData payload;
+} NdefRecView; /* Since 1.1.0 */
+
+typedef struct ndef_rec_iter {
+    GUtilData buf;
+    gboolean chunk;     /* Inside a chunked record */
+} NdefRecIter; /* Since 1.1.0 */
+
+void
+ndef_rec_iter_init(
+    NdefRecIter* iter,
+    const GUtilData* block); /* Since 1.1.0 */
+
+gboolean
+ndef_rec_iter_next(
+    NdefRecIter* iter,
+    NdefRecView* view); /* Since 1.1.0 */
+
+/*
+ * ndef_msg_check() validates the NDEF message without allocating any
+ * memory. It returns the size of the message (up to and including the
+ * record with ME flag set), zero if the message is incomplete or broken.
+ * Sequence of record chunks counts as one record. The data following
+ * the last record of the message are ignored. Optional NdefMsgInfo
+ * receives the details, even if the message turns out to be broken.
+ */
+
+typedef enum ndef_msg_check_flags {
+    NDEF_MSG_CHECK_FLAGS_NONE = 0x00,
+    NDEF_MSG_CHECK_FLAG_CHUNKED = 0x01,     /* Contains chunked records */
+    NDEF_MSG_CHECK_FLAG_BAD_MB = 0x02,      /* MB is missing or misplaced */
+    NDEF_MSG_CHECK_FLAG_BAD_ME = 0x04,      /* ME is missing or misplaced */
+    NDEF_MSG_CHECK_FLAG_BAD_CHUNK = 0x08,   /* Broken chunk sequence */
+    NDEF_MSG_CHECK_FLAG_GARBAGE = 0x10      /* Malformed record */
+} NDEF_MSG_CHECK_FLAGS; /* Since 1.1.0 */
+
+#define NDEF_MSG_CHECK_ERRORS (NDEF_MSG_CHECK_FLAG_BAD_MB | \
+    NDEF_MSG_CHECK_FLAG_BAD_ME | NDEF_MSG_CHECK_FLAG_BAD_CHUNK | \
+    NDEF_MSG_CHECK_FLAG_GARBAGE) /* Since 1.1.0 */
+
+typedef struct ndef_msg_info {
+    guint count;
+    gsize size;
+    NDEF_MSG_CHECK_FLAGS flags;
+} NdefMsgInfo; /* Since 1.1.0 */
+
+gsize
+ndef_msg_check(
+    const GUtilData* block,
+    NdefMsgInfo* info); /* Since 1.1.0 */
+
+/*
+ * One-pass message builder. The records are collected first, then the
+ * whole message is written into a single buffer of the exact size, with
+ * MB, ME, SR and IL flags set as appropriate. The records returned by
+ * ndef_msg_builder_build() point into that buffer, nothing gets copied
+ * after it has been written.
+ *
+ * The builder doesn't copy the data passed to ndef_msg_builder_add(),
+ * it has to remain valid until the message is built. The records added
+ * with ndef_msg_builder_add_rec() are referenced by the builder (only
+ * the record itself is added, not the rest of the chain).
+ *
+ * Once the message is built, the builder is empty and can be reused.
+ * Building an empty builder produces an empty NDEF (a single record
+ * of NDEF_TNF_EMPTY type), same as parsing an empty block.
+ */
+
+typedef struct ndef_msg_builder NdefMsgBuilder; /* Since 1.1.0 */
+
+NdefMsgBuilder*
+ndef_msg_builder_new(
+    void); /* Since 1.1.0 */
+
+void
+ndef_msg_builder_free(
+    NdefMsgBuilder* builder); /* Since 1.1.0 */
+
+gboolean
+ndef_msg_builder_add(
+    NdefMsgBuilder* builder,
+    NDEF_TNF tnf,
+    const GUtilData* type,
+    const GUtilData* id,
+    const GUtilData* payload); /* Since 1.1.0 */
+
+gboolean
+ndef_msg_builder_add_rec(
+    NdefMsgBuilder* builder,
+    NdefRec* rec); /* Since 1.1.0 */
+
+/*
+ * URI and Text records are encoded in the most compact form. The URI
+ * gets the longest matching abbreviation. The text is stored in UTF-8
+ * or UTF-16 (big endian), whichever is shorter. NULL language means
+ * the system one. The strings must remain valid until the message is
+ * built, same as the data passed to ndef_msg_builder_add().
+ */
+gboolean
+ndef_msg_builder_add_uri(
+    NdefMsgBuilder* builder,
+    const char* uri); /* Since 1.1.0 */
+
+gboolean
+ndef_msg_builder_add_text(
+    NdefMsgBuilder* builder,
+    const char* text,
+    const char* lang); /* Since 1.1.0 */
+
+/* Exact size of the encoded message */
+gsize
+ndef_msg_builder_size(
+    const NdefMsgBuilder* builder); /* Since 1.1.0 */
+
+/*
+ * ndef_msg_builder_tlv_size() predicts the exact size of the message
+ * wrapped into TLVs by ndef_tlv_encode(), without allocating anything.
+ * Returns zero if the message can't be encoded as a TLV.
+ *
+ * ndef_msg_builder_tlv() writes the TLV sequence directly into the
+ * buffer of the given capacity (e.g. the tag's data area) and returns
+ * the number of bytes written. If it doesn't fit, zero is returned,
+ * the overflow (if not NULL) receives the number of bytes by which the
+ * capacity is exceeded, and the builder remains intact, so that the
+ * caller can drop some records and try again. The overflow is zero if
+ * the message can't be encoded at all.
+ */
+gsize
+ndef_msg_builder_tlv_size(
+    const NdefMsgBuilder* builder,
+    const NdefTlvParams* params); /* Since 1.1.0 */
+
+gsize
+ndef_msg_builder_tlv(
+    NdefMsgBuilder* builder,
+    const NdefTlvParams* params,
+    void* buf,
+    gsize capacity,
+    gsize* overflow); /* Since 1.1.0 */
+
+GBytes*
+ndef_msg_builder_bytes(
+    NdefMsgBuilder* builder); /* Since 1.1.0 */
+
+NdefRec*
+ndef_msg_builder_build(
+    NdefMsgBuilder* builder); /* Since 1.1.0 */
+
+/*
+ * Message template, for writing the same layout many times with a few
+ * variable pieces (e.g. a serial number in a URI). The template is
+ * compiled from a chain of records, in which each occurrence of a slot
+ * name in the record payload (compared byte by byte, so it has to be
+ * encoded the same way as the payload) marks a variable slot. Slots are
+ * identified by their index in the NULL-terminated array of names.
+ *
+ * Instantiating the template substitutes the slot values (which may be
+ * of any length) and fixes up the payload lengths, SR flags and the
+ * enclosing TLV length, including the records nested in Smart Posters.
+ * Missing values (index beyond the count) are replaced with nothing.
+ *
+ * The output is written directly into the caller's buffer. If the buffer
+ * is NULL, the number of bytes that would be written is returned.
+ * Otherwise, it's the number of bytes written, or zero if the buffer is
+ * too small or the result can't be encoded, same as ndef_tlv_encode().
+ */
+
+typedef struct ndef_msg_template NdefMsgTemplate; /* Since 1.1.0 */
+
+NdefMsgTemplate*
+ndef_msg_template_new(
+    NdefRec* rec,
+    const char* const* slots); /* Since 1.1.0 */
+
+void
+ndef_msg_template_free(
+    NdefMsgTemplate* tmpl); /* Since 1.1.0 */
+
+gint
+ndef_msg_template_slot(
+    const NdefMsgTemplate* tmpl,
+    const char* name); /* Since 1.1.0 */
+
+gsize
+ndef_msg_template_encode(
+    const NdefMsgTemplate* tmpl,
+    const GUtilData* values,
+    guint count,
+    void* buf,
+    gsize size); /* Since 1.1.0 */
+
+gsize
+ndef_msg_template_encode_tlv(
+    const NdefMsgTemplate* tmpl,
+    const GUtilData* values,
+    guint count,
+    const NdefTlvParams* params,
+    void* buf,
+    gsize size); /* Since 1.1.0 */
+
+G_END_DECLS
+
+#endif /* NDEF_MSG_H */
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
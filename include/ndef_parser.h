@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#ifndef NDEF_PARSER_H
+#define NDEF_PARSER_H
+
+#include "ndef_rec.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Incremental parser. The data can be fed to it in pieces of any size
+ * (e.g. as they are being read from the tag, page by page) and each
+ * record is returned by ndef_parser_feed() as soon as it's complete,
+ * possibly as a part of a chain. Only the incomplete record (or the
+ * incomplete sequence of record chunks) is buffered by the parser.
+ *
+ * ndef_parser_new() expects a bare NDEF message, ndef_parser_new_tlv()
+ * the TLV sequence in the format defined by NFCForum-TS-Type-2-Tag
+ * specification.
+ *
+ * ndef_parser_bytes_needed() returns the minimum number of bytes needed
+ * to complete the current TLV block or record. That's not necessarily
+ * the amount of data remaining till the end of the message, feeding
+ * that many bytes may reveal that more data is needed. Zero means that
+ * the parser has stopped - either the end of the message (or the TLV
+ * terminator) has been reached, or the data turned out to be broken.
+ * Any data fed to the parser after that is ignored.
+ *
+ * The parser takes a snapshot of the parse limits when it's created.
+ * A record exceeding them breaks the message, which is detected as soon
+ * as the record header arrives, or as soon as the amount of buffered
+ * data gets over max_alloc.
+ */
+
+typedef struct ndef_parser NdefParser; /* Since 1.1.0 */
+
+typedef enum ndef_parser_state {
+    NDEF_PARSER_STATE_PARSING,
+    NDEF_PARSER_STATE_DONE,
+    NDEF_PARSER_STATE_ERROR
+} NDEF_PARSER_STATE; /* Since 1.1.0 */
+
+NdefParser*
+ndef_parser_new(
+    NDEF_PARSE_FLAGS flags); /* Since 1.1.0 */
+
+NdefParser*
+ndef_parser_new_tlv(
+    NDEF_PARSE_FLAGS flags); /* Since 1.1.0 */
+
+void
+ndef_parser_free(
+    NdefParser* parser); /* Since 1.1.0 */
+
+NdefRec*
+ndef_parser_feed(
+    NdefParser* parser,
+    const GUtilData* data); /* Since 1.1.0 */
+
+NDEF_PARSER_STATE
+ndef_parser_state(
+    const NdefParser* parser); /* Since 1.1.0 */
+
+gsize
+ndef_parser_bytes_needed(
+    const NdefParser* parser); /* Since 1.1.0 */
+
+G_END_DECLS
+
+#endif /* NDEF_PARSER_H */
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
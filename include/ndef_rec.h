@@ -52,6 +52,12 @@ typedef enum nfc_ndef_rec_flags {
     NDEF_REC_FLAG_LAST = 0x02       /* ME */
 } NDEF_REC_FLAGS;
 
+typedef enum nfc_ndef_parse_flags {
+    NDEF_PARSE_FLAGS_NONE = 0x00,
+    NDEF_PARSE_FLAG_SHARED_STORAGE = 0x01,
+    NDEF_PARSE_FLAG_LAZY = 0x02
+} NDEF_PARSE_FLAGS; /* Since 1.1.0 */
+
 /* Known record types (RTD = Record Type Definition) */
 typedef enum nfc_ndef_rtd {
     NDEF_RTD_UNKNOWN,
@@ -86,6 +92,11 @@ struct nfc_ndef_rec {
     GUtilData payload;
 };
 
+/* Allows applications to derive their own record types */
+typedef struct ndef_rec_class {
+    GObjectClass parent;
+} NdefRecClass; /* Since 1.1.0 */
+
 GType ndef_rec_get_type(void);
 #define NDEF_TYPE_REC (ndef_rec_get_type())
 #define NDEF_REC(obj) (G_TYPE_CHECK_INSTANCE_CAST(obj, \
@@ -99,11 +110,115 @@ NdefRec*
 ndef_rec_new_from_tlv(
     const GUtilData* tlv);
 
+/*
+ * Zero-copy versions of ndef_rec_new() and ndef_rec_new_from_tlv().
+ * Records returned by these functions keep a reference to GBytes and
+ * their raw, type, id and payload point directly into it.
+ */
+NdefRec*
+ndef_rec_new_bytes(
+    GBytes* bytes); /* Since 1.1.0 */
+
+NdefRec*
+ndef_rec_new_from_tlv_bytes(
+    GBytes* tlv); /* Since 1.1.0 */
+
+/*
+ * With NDEF_PARSE_FLAG_SHARED_STORAGE the raw data of all records and
+ * the decoded data of the known record types (URIs, texts etc.) are
+ * stored in a single reference counted block of memory, shared by the
+ * whole chain of records.
+ *
+ * With NDEF_PARSE_FLAG_LAZY the record type is determined from the record
+ * header and a few cheap checks of the payload (URI prefix, language code
+ * of a Text record) and the content of URI, Text and SmartPoster records
+ * is decoded on the first call to the respective accessor (ndef_rec_u_uri(),
+ * ndef_rec_t_text() and such). Until then, the decoded fields of those
+ * records are NULL. Note that errors in the text encoding or in the nested
+ * message of a SmartPoster are only detected on access. In that case lazy
+ * parsing still produces NdefRecT or NdefRecSp whose accessors return NULL,
+ * whereas eager parsing falls back to a generic NdefRec.
+ */
+NdefRec*
+ndef_rec_new_full(
+    const GUtilData* block,
+    NDEF_PARSE_FLAGS flags); /* Since 1.1.0 */
+
+NdefRec*
+ndef_rec_new_from_tlv_full(
+    const GUtilData* tlv,
+    NDEF_PARSE_FLAGS flags); /* Since 1.1.0 */
+
+/*
+ * Process-wide resource limits, applied to each NDEF message by all
+ * the parsing functions. Zero means no limit.
+ *
+ * max_records limits the number of records in the message, including
+ * the ones nested in Smart Posters. max_payload limits the payload of
+ * a single record (after reassembling the chunks). max_alloc limits
+ * the amount of memory allocated for the raw and decoded data of the
+ * message (doesn't include the objects themselves and the data decoded
+ * lazily). max_depth limits the nesting of Smart Posters.
+ *
+ * The limits are checked before anything is allocated. If any of them
+ * is exceeded, no records are returned. ndef_parse_limits_set(NULL)
+ * restores the defaults which only limit the nesting depth.
+ *
+ * The limits can be changed from any thread at any time. Reading them
+ * doesn't take any locks. A message which is being parsed keeps using
+ * the limits which were in effect when its parsing started, the data
+ * decoded lazily is checked against the limits in effect at that time.
+ */
+typedef struct ndef_parse_limits {
+    guint max_records;
+    guint max_payload;
+    gsize max_alloc;
+    guint max_depth;
+} NdefParseLimits; /* Since 1.1.0 */
+
+#define NDEF_PARSE_DEFAULT_MAX_DEPTH (8) /* Since 1.1.0 */
+
+void
+ndef_parse_limits_get(
+    NdefParseLimits* limits); /* Since 1.1.0 */
+
+void
+ndef_parse_limits_set(
+    const NdefParseLimits* limits); /* Since 1.1.0 */
+
 NdefRec*
 ndef_rec_new_mediatype(
     const GUtilData* type,
     const GUtilData* payload);
 
+/*
+ * Registers a handler for the records of the particular type, which is
+ * the combination of TNF and the record type. Records of this type are
+ * going to be created as instances of gtype (which has to be derived from
+ * NDEF_TYPE_REC) and then passed to the init function (if there is one).
+ * If init returns FALSE, the record is parsed as if there was no handler.
+ *
+ * Handlers registered by the application take precedence over the
+ * built-in types. Registering another handler for the same type replaces
+ * the previous one. Returns zero on failure.
+ */
+typedef gboolean (*NdefRecInitFunc)(
+    NdefRec* rec,
+    gpointer user_data); /* Since 1.1.0 */
+
+guint
+ndef_rec_type_register(
+    NDEF_TNF tnf,
+    const GUtilData* type,
+    GType gtype,
+    NdefRecInitFunc init,
+    gpointer user_data,
+    GDestroyNotify destroy); /* Since 1.1.0 */
+
+void
+ndef_rec_type_unregister(
+    guint id); /* Since 1.1.0 */
+
 NdefRec*
 ndef_rec_ref(
     NdefRec* rec);
@@ -112,6 +227,64 @@ void
 ndef_rec_unref(
     NdefRec* rec);
 
+/*
+ * Hashing and comparison, compatible with GHashFunc and GEqualFunc.
+ * Two records are equal if their raw data are identical, except for
+ * the MB and ME flags which only reflect the position of the record in
+ * the message. The hash of the record is calculated once and cached.
+ *
+ * The chain versions treat the argument as the first record of a chain.
+ * Chains are equal if they consist of the same number of pairwise equal
+ * records, in the same order.
+ */
+guint
+ndef_rec_hash(
+    gconstpointer rec); /* Since 1.1.0 */
+
+gboolean
+ndef_rec_equal(
+    gconstpointer a,
+    gconstpointer b); /* Since 1.1.0 */
+
+guint
+ndef_rec_chain_hash(
+    gconstpointer rec); /* Since 1.1.0 */
+
+gboolean
+ndef_rec_chain_equal(
+    gconstpointer a,
+    gconstpointer b); /* Since 1.1.0 */
+
+/*
+ * Scatter-gather serialization of a chain of records, e.g. for writev().
+ * The iovec entries point directly to the raw data of the records (which
+ * must stay alive while the entries are in use), nothing is copied.
+ * If the MB and ME flags of a record don't match its position in the
+ * chain, the record's header byte is replaced with a separate one byte
+ * entry pointing to static read-only storage. Entries pointing to
+ * adjacent memory are merged, so a chain created by ndef_rec_new_bytes()
+ * or ndef_msg_builder_build() normally takes just one entry.
+ *
+ * Returns the number of entries required for the whole chain. At most
+ * max_count entries are filled, if the return value is larger than that
+ * then the array was too small. Passing NULL iov with zero max_count
+ * just calculates the number of entries. The chain needs at most two
+ * entries per record.
+ *
+ * ndef_rec_chain_size() returns the total size of the serialized chain.
+ */
+struct iovec;
+
+guint
+ndef_rec_chain_iov(
+    NdefRec* rec,
+    struct iovec* iov,
+    guint max_count); /* Since 1.1.0 */
+
+gsize
+ndef_rec_chain_size(
+    NdefRec* rec); /* Since 1.1.0 */
+
 /* URI */
 
 typedef struct nfc_ndef_rec_u_priv NdefRecUPriv;
@@ -133,6 +306,54 @@ NdefRecU*
 ndef_rec_u_new(
     const char* uri);
 
+const char*
+ndef_rec_u_uri(
+    NdefRecU* rec); /* Since 1.1.0 */
+
+/*
+ * Expands the URI record payload (identifier code followed by the rest
+ * of the URI) into the caller's buffer, NUL-terminated. If the buffer is
+ * NULL, returns the size of the buffer required. Otherwise, returns the
+ * number of bytes written (including the terminating NUL), or zero if
+ * the buffer is too small or the identifier code is unknown.
+ */
+gsize
+ndef_rec_u_decode(
+    const GUtilData* payload,
+    char* buf,
+    gsize size); /* Since 1.1.0 */
+
+/*
+ * URI components (RFC 3986), computed once when the URI is decoded.
+ * The offsets are relative to the beginning of the URI string. The
+ * delimiters (":", "//", "@", "?" and "#") and the brackets around
+ * IP literals are not included. Missing components have zero length.
+ * The prefix is the URI identifier code from the record (e.g. 0x05 for
+ * "tel:"), zero if the URI wasn't abbreviated. For opaque URIs like
+ * tel, mailto or sip the path is what follows the scheme, e.g. the
+ * phone number or the address.
+ */
+typedef struct ndef_uri_span {
+    guint offset;
+    guint length;
+} NdefUriSpan; /* Since 1.1.0 */
+
+typedef struct ndef_uri_parts {
+    NdefUriSpan scheme;
+    NdefUriSpan authority;
+    NdefUriSpan userinfo;
+    NdefUriSpan host;
+    NdefUriSpan port;
+    NdefUriSpan path;
+    NdefUriSpan query;
+    NdefUriSpan fragment;
+    guint8 prefix;
+} NdefUriParts; /* Since 1.1.0 */
+
+const NdefUriParts*
+ndef_rec_u_parts(
+    NdefRecU* rec); /* Since 1.1.0 */
+
 /* Text */
 
 typedef struct nfc_ndef_rec_t_priv NdefRecTPriv;
@@ -173,6 +394,14 @@ ndef_rec_t_new_enc(
 #define ndef_rec_t_new(text, lang) \
     ndef_rec_t_new_enc(text, lang, NDEF_REC_T_ENC_UTF8)
 
+const char*
+ndef_rec_t_lang(
+    NdefRecT* rec); /* Since 1.1.0 */
+
+const char*
+ndef_rec_t_text(
+    NdefRecT* rec); /* Since 1.1.0 */
+
 NDEF_LANG_MATCH
 ndef_rec_t_lang_match(
     NdefRecT* rec,
@@ -229,6 +458,57 @@ ndef_rec_sp_new(
     NDEF_SP_ACT act,
     const NdefMedia* icon);
 
+/*
+ * Same as ndef_rec_sp_new() but allows multiple titles in different
+ * languages (NULL lang means the system language). The nested message
+ * is written directly into the payload of the new record, in one pass.
+ * ndef_rec_sp_title() and ndef_rec_sp_lang() return the title best
+ * matching the system language, the same one that would be picked if
+ * the record was parsed.
+ */
+typedef struct nfc_ndef_sp_title {
+    const char* title;
+    const char* lang;
+} NdefSpTitle; /* Since 1.1.0 */
+
+NdefRecSp*
+ndef_rec_sp_new_full(
+    const char* uri,
+    const NdefSpTitle* titles,
+    guint n_titles,
+    const char* type,
+    guint size,
+    NDEF_SP_ACT act,
+    const NdefMedia* icon); /* Since 1.1.0 */
+
+const char*
+ndef_rec_sp_uri(
+    NdefRecSp* rec); /* Since 1.1.0 */
+
+const char*
+ndef_rec_sp_title(
+    NdefRecSp* rec); /* Since 1.1.0 */
+
+const char*
+ndef_rec_sp_lang(
+    NdefRecSp* rec); /* Since 1.1.0 */
+
+const char*
+ndef_rec_sp_type(
+    NdefRecSp* rec); /* Since 1.1.0 */
+
+guint
+ndef_rec_sp_size(
+    NdefRecSp* rec); /* Since 1.1.0 */
+
+NDEF_SP_ACT
+ndef_rec_sp_act(
+    NdefRecSp* rec); /* Since 1.1.0 */
+
+const NdefMedia*
+ndef_rec_sp_icon(
+    NdefRecSp* rec); /* Since 1.1.0 */
+
 /* Utilities */
 
 gboolean
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#ifndef NDEF_STATS_H
+#define NDEF_STATS_H
+
+#include "ndef_rec.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Parser statistics. Collecting the statistics is off by default, the
+ * counters aren't updated until ndef_stats_enable(TRUE) is called.
+ * The counters are shared by all threads and updated atomically.
+ *
+ * ndef_stats_get() takes a snapshot of the counters. Each counter is
+ * read atomically, but the counters are not read all at once, so the
+ * snapshot may be slightly inconsistent if the parsing is going on at
+ * the same time in another thread. The counters are 32-bit and wrap
+ * around on overflow.
+ *
+ * The size of NdefStats is part of the ABI and never changes. The arrays
+ * have room for all possible TNF values (the raw 3-bit field, including
+ * Unknown, Unchanged and Reserved) and for NDEF_STATS_RTD_COUNT record
+ * types, so that adding more NDEF_RTD values doesn't affect the layout.
+ * New counters take the reserved slots at the end, which read as zero
+ * until then.
+ */
+
+#define NDEF_STATS_TNF_COUNT (8) /* Since 1.1.0 */
+#define NDEF_STATS_RTD_COUNT (16) /* Since 1.1.0 */
+
+typedef struct ndef_stats {
+    guint rec_tnf[NDEF_STATS_TNF_COUNT];  /* Records parsed, by TNF */
+    guint rec_rtd[NDEF_STATS_RTD_COUNT];  /* Records parsed, by RTD */
+    guint bytes;            /* Bytes of NDEF messages parsed */
+    guint garbage;          /* Messages with unparseable data */
+    guint chunked;          /* Chunked records reassembled */
+    guint chunked_dropped;  /* Broken chunk sequences and stray chunks */
+    guint text_errors;      /* Failed text conversions */
+    guint allocs;           /* Memory blocks allocated for the records */
+    guint reserved[10];     /* For future counters */
+} NdefStats; /* Since 1.1.0 */
+
+void
+ndef_stats_enable(
+    gboolean enable); /* Since 1.1.0 */
+
+gboolean
+ndef_stats_enabled(
+    void); /* Since 1.1.0 */
+
+void
+ndef_stats_get(
+    NdefStats* stats); /* Since 1.1.0 */
+
+void
+ndef_stats_reset(
+    void); /* Since 1.1.0 */
+
+G_END_DECLS
+
+#endif /* NDEF_STATS_H */
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -81,6 +81,61 @@ gsize
 ndef_tlv_check(
     const GUtilData* buf);
 
+/*
+ * The inverse of ndef_tlv_next(). Encodes an NDEF message (either raw,
+ * or a chain of records) as a sequence of TLV blocks in the following
+ * order: Lock Control TLVs, Memory Control TLVs, NDEF Message TLV and
+ * TLV_TERMINATOR, padded with TLV_NULL bytes up to the next page_size
+ * boundary (if page_size is non-zero). The short (one byte) length format
+ * is used when possible. Params are optional, NULL means no control TLVs
+ * and no padding.
+ *
+ * The result is written directly to the caller's buffer. If the buffer
+ * is NULL, the functions return the number of bytes that would be
+ * written. Otherwise, it's the number of bytes actually written, or
+ * zero if the buffer is too small, the message or a control TLV is too
+ * large (more than 0xfffe bytes) or the input is invalid.
+ *
+ * ndef_tlv_append() and ndef_tlv_append_rec() do the same, writing the
+ * data directly to the end of the byte array.
+ *
+ * When encoding a chain of records, MB, ME, SR and IL flags are set
+ * appropriately and chunked records are written as one record.
+ */
+typedef struct ndef_tlv_params {
+    const GUtilData* lock_control;      /* Lock Control TLV values */
+    guint lock_control_count;
+    const GUtilData* memory_control;    /* Memory Control TLV values */
+    guint memory_control_count;
+    guint page_size;                    /* Padding granularity */
+} NdefTlvParams; /* Since 1.1.0 */
+
+gsize
+ndef_tlv_encode(
+    const GUtilData* msg,
+    const NdefTlvParams* params,
+    void* buf,
+    gsize size); /* Since 1.1.0 */
+
+gsize
+ndef_tlv_encode_rec(
+    NdefRec* rec,
+    const NdefTlvParams* params,
+    void* buf,
+    gsize size); /* Since 1.1.0 */
+
+gsize
+ndef_tlv_append(
+    GByteArray* out,
+    const GUtilData* msg,
+    const NdefTlvParams* params); /* Since 1.1.0 */
+
+gsize
+ndef_tlv_append_rec(
+    GByteArray* out,
+    NdefRec* rec,
+    const NdefTlvParams* params); /* Since 1.1.0 */
+
 G_END_DECLS
 
 #endif /* NDEF_TLV_H */
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#ifndef NDEF_URI_MATCHER_H
+#define NDEF_URI_MATCHER_H
+
+#include "ndef_types.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Matches URIs against a set of patterns compiled into a single DFA,
+ * so the cost of matching depends on the length of the URI but not on
+ * the number of patterns. The patterns are matched against the whole
+ * URI, byte by byte (i.e. case-sensitively), with two wildcards:
+ *
+ *   *   any sequence of characters not containing '/' (e.g. a host
+ *       name component or a path segment)
+ *   **  any sequence of characters
+ *
+ * A backslash makes the next character literal. For example, "tel:**"
+ * matches any phone number, "https://www.example.com/pay**" matches
+ * anything under /pay on that host and "http*:**" matches any http or
+ * https URI. A single star at the beginning of the host name matches
+ * any subdomain.
+ *
+ * ndef_uri_matcher_match() takes the URI record payload as is (the URI
+ * identifier code followed by the rest of the URI) and never expands
+ * the URI. It can be given the payload of a lazily parsed record too,
+ * without decoding it. ndef_uri_matcher_match_uri() takes a plain URI.
+ *
+ * Both return the index of the matching pattern in the array passed to
+ * ndef_uri_matcher_new(), the lowest one if several patterns match, or
+ * -1 if none does. The matcher is immutable and can be shared between
+ * threads. NULL is returned if the patterns produce too many states.
+ */
+
+typedef struct ndef_uri_matcher NdefUriMatcher; /* Since 1.1.0 */
+
+NdefUriMatcher*
+ndef_uri_matcher_new(
+    const char* const* patterns); /* Since 1.1.0 */
+
+void
+ndef_uri_matcher_free(
+    NdefUriMatcher* matcher); /* Since 1.1.0 */
+
+gint
+ndef_uri_matcher_match(
+    const NdefUriMatcher* matcher,
+    const GUtilData* payload); /* Since 1.1.0 */
+
+gint
+ndef_uri_matcher_match_uri(
+    const NdefUriMatcher* matcher,
+    const char* uri); /* Since 1.1.0 */
+
+G_END_DECLS
+
+#endif /* NDEF_URI_MATCHER_H */
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -39,8 +39,14 @@
 #ifndef NFCDEF_H
 #define NFCDEF_H
 
+#include "ndef_cache.h"
+#include "ndef_context.h"
+#include "ndef_msg.h"
+#include "ndef_parser.h"
 #include "ndef_rec.h"
+#include "ndef_stats.h"
 #include "ndef_tlv.h"
+#include "ndef_uri_matcher.h"
 #include "ndef_util.h"
 #include "ndef_version.h"
 
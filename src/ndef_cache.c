@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "ndef_cache.h"
+#include "ndef_util_p.h"
+#include "ndef_log.h"
+
+#include <gutil_macros.h>
+#include <gutil_misc.h>
+
+typedef struct ndef_parse_cache_entry {
+    GList link;                 /* Node in the LRU list */
+    guint hash;
+    NDEF_PARSE_FLAGS flags;
+    gboolean tlv;
+    GUtilData data;             /* Copy of the input */
+    NdefRec* rec;
+} NdefParseCacheEntry;
+
+struct ndef_parse_cache {
+    GMutex mutex;
+    GHashTable* table;          /* Entries (both keys and values) */
+    GQueue lru;                 /* Most recently used entry first */
+    guint max_entries;
+    guint hits;
+    guint misses;
+};
+
+#define NDEF_PARSE_CACHE_DEFAULT_SIZE (32)
+#define NDEF_PARSE_CACHE_ENTRY_SIZE G_ALIGN8(sizeof(NdefParseCacheEntry))
+
+static
+guint
+ndef_parse_cache_hash(
+    const GUtilData* data,
+    NDEF_PARSE_FLAGS flags,
+    gboolean tlv)
+{
+    /* Same input parsed differently is a different entry */
+    return ndef_hash(data->bytes, data->size, (flags << 1) | (tlv ? 1 : 0));
+}
+
+static
+guint
+ndef_parse_cache_entry_hash(
+    gconstpointer key)
+{
+    return ((const NdefParseCacheEntry*)key)->hash;
+}
+
+static
+gboolean
+ndef_parse_cache_entry_equal(
+    gconstpointer a,
+    gconstpointer b)
+{
+    const NdefParseCacheEntry* e1 = a;
+    const NdefParseCacheEntry* e2 = b;
+
+    return e1->hash == e2->hash && e1->flags == e2->flags &&
+        e1->tlv == e2->tlv && gutil_data_equal(&e1->data, &e2->data);
+}
+
+static
+NdefParseCacheEntry*
+ndef_parse_cache_entry_new(
+    const NdefParseCacheEntry* key,
+    NdefRec* rec)
+{
+    NdefParseCacheEntry* entry = g_malloc(NDEF_PARSE_CACHE_ENTRY_SIZE +
+        key->data.size);
+    guint8* data = ((guint8*)entry) + NDEF_PARSE_CACHE_ENTRY_SIZE;
+
+    *entry = *key;
+    entry->link.data = entry;
+    entry->link.prev = entry->link.next = NULL;
+    entry->data.bytes = data;
+    entry->rec = ndef_rec_ref(rec);
+    if (key->data.size) {
+        memcpy(data, key->data.bytes, key->data.size);
+    }
+    return entry;
+}
+
+static
+void
+ndef_parse_cache_entry_free(
+    NdefParseCacheEntry* entry)
+{
+    if (entry) {
+        ndef_rec_unref(entry->rec);
+        g_free(entry);
+    }
+}
+
+/* Returns the entries to free (outside of the lock) */
+static
+GList*
+ndef_parse_cache_trim(
+    NdefParseCache* self,
+    guint max_entries)
+{
+    GList* dropped = NULL;
+
+    while (self->lru.length > max_entries) {
+        GList* link = self->lru.tail;
+
+        g_queue_unlink(&self->lru, link);
+        g_hash_table_remove(self->table, link->data);
+        link->next = dropped;
+        dropped = link;
+    }
+    return dropped;
+}
+
+static
+void
+ndef_parse_cache_free_entries(
+    GList* link)
+{
+    while (link) {
+        GList* next = link->next;
+
+        ndef_parse_cache_entry_free(link->data);
+        link = next;
+    }
+}
+
+static
+NdefRec*
+ndef_parse_cache_lookup(
+    NdefParseCache* self,
+    const GUtilData* data,
+    NDEF_PARSE_FLAGS flags,
+    gboolean tlv)
+{
+    NdefParseCacheEntry key;
+    NdefParseCacheEntry* entry;
+    NdefRec* rec;
+
+    /* Shared records must not change after they have been parsed */
+    flags &= ~NDEF_PARSE_FLAG_LAZY;
+
+    memset(&key, 0, sizeof(key));
+    key.hash = ndef_parse_cache_hash(data, flags, tlv);
+    key.flags = flags;
+    key.tlv = tlv;
+    key.data = *data;
+
+    g_mutex_lock(&self->mutex);
+    entry = g_hash_table_lookup(self->table, &key);
+    if (entry) {
+        self->hits++;
+        g_queue_unlink(&self->lru, &entry->link);
+        g_queue_push_head_link(&self->lru, &entry->link);
+        rec = ndef_rec_ref(entry->rec);
+        g_mutex_unlock(&self->mutex);
+        return rec;
+    }
+    self->misses++;
+    g_mutex_unlock(&self->mutex);
+
+    /* Parse without holding the lock */
+    rec = tlv ? ndef_rec_new_from_tlv_full(data, flags) :
+        ndef_rec_new_full(data, flags);
+    if (rec) {
+        GList* dropped = NULL;
+
+        entry = ndef_parse_cache_entry_new(&key, rec);
+        g_mutex_lock(&self->mutex);
+        if (g_hash_table_lookup(self->table, entry)) {
+            /* Another thread has got here first */
+            dropped = &entry->link;
+        } else {
+            g_hash_table_insert(self->table, entry, entry);
+            g_queue_push_head_link(&self->lru, &entry->link);
+            dropped = ndef_parse_cache_trim(self, self->max_entries);
+        }
+        g_mutex_unlock(&self->mutex);
+        ndef_parse_cache_free_entries(dropped);
+    }
+    return rec;
+}
+
+/*==========================================================================*
+ * Interface
+ *==========================================================================*/
+
+NdefParseCache*
+ndef_parse_cache_new(
+    guint max_entries) /* Since 1.1.0 */
+{
+    NdefParseCache* self = g_slice_new0(NdefParseCache);
+
+    g_mutex_init(&self->mutex);
+    g_queue_init(&self->lru);
+    self->table = g_hash_table_new(ndef_parse_cache_entry_hash,
+        ndef_parse_cache_entry_equal);
+    self->max_entries = max_entries ? max_entries :
+        NDEF_PARSE_CACHE_DEFAULT_SIZE;
+    return self;
+}
+
+void
+ndef_parse_cache_free(
+    NdefParseCache* self) /* Since 1.1.0 */
+{
+    if (G_LIKELY(self)) {
+        ndef_parse_cache_free_entries(ndef_parse_cache_trim(self, 0));
+        g_hash_table_destroy(self->table);
+        g_mutex_clear(&self->mutex);
+        g_slice_free(NdefParseCache, self);
+    }
+}
+
+void
+ndef_parse_cache_clear(
+    NdefParseCache* self) /* Since 1.1.0 */
+{
+    if (G_LIKELY(self)) {
+        GList* dropped;
+
+        g_mutex_lock(&self->mutex);
+        dropped = ndef_parse_cache_trim(self, 0);
+        g_mutex_unlock(&self->mutex);
+        ndef_parse_cache_free_entries(dropped);
+    }
+}
+
+void
+ndef_parse_cache_get_stats(
+    NdefParseCache* self,
+    NdefParseCacheStats* stats) /* Since 1.1.0 */
+{
+    if (G_LIKELY(stats)) {
+        if (G_LIKELY(self)) {
+            g_mutex_lock(&self->mutex);
+            stats->hits = self->hits;
+            stats->misses = self->misses;
+            stats->entries = self->lru.length;
+            g_mutex_unlock(&self->mutex);
+        } else {
+            memset(stats, 0, sizeof(*stats));
+        }
+    }
+}
+
+NdefRec*
+ndef_parse_cache_rec_new(
+    NdefParseCache* self,
+    const GUtilData* block,
+    NDEF_PARSE_FLAGS flags) /* Since 1.1.0 */
+{
+    if (G_LIKELY(block)) {
+        return self ? ndef_parse_cache_lookup(self, block, flags, FALSE) :
+            ndef_rec_new_full(block, flags);
+    }
+    return NULL;
+}
+
+NdefRec*
+ndef_parse_cache_rec_new_from_tlv(
+    NdefParseCache* self,
+    const GUtilData* tlv,
+    NDEF_PARSE_FLAGS flags) /* Since 1.1.0 */
+{
+    if (G_LIKELY(tlv)) {
+        return self ? ndef_parse_cache_lookup(self, tlv, flags, TRUE) :
+            ndef_rec_new_from_tlv_full(tlv, flags);
+    }
+    return NULL;
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
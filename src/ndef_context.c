@@ -0,0 +1,371 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "ndef_context.h"
+#include "ndef_rec_p.h"
+#include "ndef_stats_p.h"
+#include "ndef_log.h"
+
+#include <gutil_macros.h>
+
+#include <unistd.h>
+
+typedef struct ndef_arena_chunk NdefArenaChunk;
+
+struct ndef_arena_chunk {
+    NdefArenaChunk* next;
+    guint8* data;
+    gsize size;
+    gsize used;
+    gint state;                 /* Users and the DETACHED bit */
+};
+
+/*
+ * The number of blocks still in use and the fact that the chunk has been
+ * detached from the context share the same atomic word, so that the last
+ * user and the context can't both miss (or both take) the ownership of
+ * the chunk. Only the context adds users, only from its own thread.
+ */
+#define NDEF_ARENA_CHUNK_DETACHED (0x01)
+#define NDEF_ARENA_CHUNK_USER (0x02)
+
+struct ndef_parse_context {
+    NdefBlockAlloc alloc;
+    NdefArenaChunk* chunks;     /* All chunks owned by the context */
+    NdefArenaChunk* current;
+    gsize chunk_size;
+};
+
+typedef struct ndef_parse_batch {
+    const GUtilData* blocks;
+    NdefRec** recs;
+    guint count;
+    gint next;                  /* Index of the next block to parse */
+    NDEF_PARSE_FLAGS flags;
+    gboolean tlv;
+} NdefParseBatch;
+
+#define NDEF_PARSE_CONTEXT_DEFAULT_CHUNK_SIZE (0x4000)
+#define NDEF_ARENA_CHUNK_HEADER_SIZE G_ALIGN8(sizeof(NdefArenaChunk))
+
+static
+NdefArenaChunk*
+ndef_arena_chunk_new(
+    NdefParseContext* ctx,
+    gsize size)
+{
+    NdefArenaChunk* chunk = g_malloc(NDEF_ARENA_CHUNK_HEADER_SIZE + size);
+
+    NDEF_STATS_INC(allocs);
+    chunk->data = ((guint8*)chunk) + NDEF_ARENA_CHUNK_HEADER_SIZE;
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->state = 0;
+    chunk->next = ctx->chunks;
+    ctx->chunks = chunk;
+    return chunk;
+}
+
+static
+void
+ndef_arena_block_free(
+    gpointer user_data)
+{
+    NdefArenaChunk* chunk = user_data;
+
+    /*
+     * Records can be released by any thread, including while the context
+     * is being reset. Chunks which are still attached to the context get
+     * reclaimed by the context itself (see ndef_parse_context_alloc).
+     */
+    const gint prev = g_atomic_int_add(&chunk->state,
+        -NDEF_ARENA_CHUNK_USER);
+
+    GASSERT(prev >= NDEF_ARENA_CHUNK_USER);
+    if (prev == (NDEF_ARENA_CHUNK_USER | NDEF_ARENA_CHUNK_DETACHED)) {
+        /* The context has been reset or freed */
+        g_free(chunk);
+    }
+}
+
+/*
+ * Hands the chunk over to its remaining users. Returns FALSE if there
+ * are none, in which case the chunk still belongs to the context.
+ */
+static
+gboolean
+ndef_arena_chunk_detach(
+    NdefArenaChunk* chunk)
+{
+    gint state = g_atomic_int_get(&chunk->state);
+
+    /* The number of users can only go down while we are here */
+    while (state && !g_atomic_int_compare_and_exchange(&chunk->state,
+        state, state | NDEF_ARENA_CHUNK_DETACHED)) {
+        state = g_atomic_int_get(&chunk->state);
+    }
+    return state != 0;
+}
+
+static
+GBytes*
+ndef_parse_context_alloc(
+    NdefBlockAlloc* alloc,
+    gsize size,
+    guint8** data)
+{
+    NdefParseContext* ctx = G_CAST(alloc, NdefParseContext, alloc);
+    const gsize aligned_size = G_ALIGN8(size);
+    NdefArenaChunk* chunk = ctx->current;
+
+    if (!chunk || (chunk->size - chunk->used) < aligned_size) {
+        /* Find an idle chunk which is big enough or allocate a new one */
+        for (chunk = ctx->chunks; chunk; chunk = chunk->next) {
+            if (chunk->size >= aligned_size &&
+                !g_atomic_int_get(&chunk->state)) {
+                /* Nothing is using this chunk anymore, it can be reused */
+                chunk->used = 0;
+                break;
+            }
+        }
+        if (!chunk) {
+            chunk = ndef_arena_chunk_new(ctx, MAX(aligned_size,
+                ctx->chunk_size));
+        }
+        ctx->current = chunk;
+    }
+
+    *data = chunk->data + chunk->used;
+    chunk->used += aligned_size;
+    g_atomic_int_add(&chunk->state, NDEF_ARENA_CHUNK_USER);
+    return g_bytes_new_with_free_func(*data, size,
+        ndef_arena_block_free, chunk);
+}
+
+static
+void
+ndef_parse_context_release(
+    NdefParseContext* ctx,
+    gboolean keep_idle)
+{
+    NdefArenaChunk* chunk = ctx->chunks;
+    NdefArenaChunk* idle = NULL;
+
+    ctx->chunks = ctx->current = NULL;
+    while (chunk) {
+        NdefArenaChunk* next = chunk->next;
+
+        /* Otherwise the last block to go will free the chunk */
+        if (!ndef_arena_chunk_detach(chunk)) {
+            if (keep_idle && chunk->size == ctx->chunk_size) {
+                /* Keep the standard sized chunks for reuse */
+                chunk->used = 0;
+                chunk->next = idle;
+                idle = chunk;
+            } else {
+                g_free(chunk);
+            }
+        }
+        chunk = next;
+    }
+    ctx->chunks = idle;
+}
+
+/*
+ * Each worker has its own context and keeps grabbing the blocks one by
+ * one until there's nothing left. The records escape the worker only
+ * after its context is gone, so they can be freed by any thread.
+ */
+static
+void
+ndef_parse_batch_worker(
+    gpointer data,
+    gpointer user_data)
+{
+    NdefParseBatch* batch = data;
+    NdefParseContext* ctx = ndef_parse_context_new(0);
+    guint i;
+
+    while ((i = (guint)g_atomic_int_add(&batch->next, 1)) < batch->count) {
+        const GUtilData* block = batch->blocks + i;
+
+        batch->recs[i] = batch->tlv ?
+            ndef_parse_context_rec_new_from_tlv(ctx, block, batch->flags) :
+            ndef_parse_context_rec_new(ctx, block, batch->flags);
+    }
+    ndef_parse_context_free(ctx);
+}
+
+static
+void
+ndef_parse_batch_run(
+    const GUtilData* blocks,
+    NdefRec** recs,
+    guint count,
+    NDEF_PARSE_FLAGS flags,
+    guint max_threads,
+    gboolean tlv)
+{
+    NdefParseBatch batch;
+    GThreadPool* pool = NULL;
+    guint i, n = max_threads;
+
+    if (!n) {
+        const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+        n = (cpus > 0) ? (guint)cpus : 1;
+    }
+    n = MIN(n, count);
+
+    batch.blocks = blocks;
+    batch.recs = recs;
+    batch.count = count;
+    batch.next = 0;
+    batch.flags = flags;
+    batch.tlv = tlv;
+
+    /* The calling thread is one of the workers */
+    if (n > 1) {
+        pool = g_thread_pool_new(ndef_parse_batch_worker, NULL, n - 1,
+            FALSE, NULL);
+    }
+    if (pool) {
+        for (i = 1; i < n; i++) {
+            g_thread_pool_push(pool, &batch, NULL);
+        }
+    }
+    ndef_parse_batch_worker(&batch, NULL);
+    if (pool) {
+        g_thread_pool_free(pool, FALSE, TRUE);
+    }
+}
+
+/*==========================================================================*
+ * Interface
+ *==========================================================================*/
+
+NdefParseContext*
+ndef_parse_context_new(
+    gsize chunk_size) /* Since 1.1.0 */
+{
+    NdefParseContext* ctx = g_slice_new0(NdefParseContext);
+
+    ctx->alloc.alloc = ndef_parse_context_alloc;
+    ctx->chunk_size = chunk_size ? G_ALIGN8(chunk_size) :
+        NDEF_PARSE_CONTEXT_DEFAULT_CHUNK_SIZE;
+    return ctx;
+}
+
+void
+ndef_parse_context_free(
+    NdefParseContext* ctx) /* Since 1.1.0 */
+{
+    if (G_LIKELY(ctx)) {
+        ndef_parse_context_release(ctx, FALSE);
+        g_slice_free(NdefParseContext, ctx);
+    }
+}
+
+void
+ndef_parse_context_reset(
+    NdefParseContext* ctx) /* Since 1.1.0 */
+{
+    if (G_LIKELY(ctx)) {
+        ndef_parse_context_release(ctx, TRUE);
+    }
+}
+
+NdefRec*
+ndef_parse_context_rec_new(
+    NdefParseContext* ctx,
+    const GUtilData* block,
+    NDEF_PARSE_FLAGS flags) /* Since 1.1.0 */
+{
+    if (G_LIKELY(block)) {
+        return ctx ? ndef_rec_new_with_alloc(block, flags, &ctx->alloc) :
+            ndef_rec_new_full(block, flags);
+    }
+    return NULL;
+}
+
+NdefRec*
+ndef_parse_context_rec_new_from_tlv(
+    NdefParseContext* ctx,
+    const GUtilData* tlv,
+    NDEF_PARSE_FLAGS flags) /* Since 1.1.0 */
+{
+    if (G_LIKELY(tlv)) {
+        return ctx ? ndef_rec_new_from_tlv_with_alloc(tlv, flags,
+            &ctx->alloc) : ndef_rec_new_from_tlv_full(tlv, flags);
+    }
+    return NULL;
+}
+
+void
+ndef_parse_batch(
+    const GUtilData* blocks,
+    NdefRec** recs,
+    guint count,
+    NDEF_PARSE_FLAGS flags,
+    guint max_threads) /* Since 1.1.0 */
+{
+    if (G_LIKELY(blocks) && G_LIKELY(recs) && count) {
+        ndef_parse_batch_run(blocks, recs, count, flags, max_threads, FALSE);
+    }
+}
+
+void
+ndef_parse_batch_tlv(
+    const GUtilData* tlvs,
+    NdefRec** recs,
+    guint count,
+    NDEF_PARSE_FLAGS flags,
+    guint max_threads) /* Since 1.1.0 */
+{
+    if (G_LIKELY(tlvs) && G_LIKELY(recs) && count) {
+        ndef_parse_batch_run(tlvs, recs, count, flags, max_threads, TRUE);
+    }
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
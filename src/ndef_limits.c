@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "ndef_rec_p.h"
+#include "ndef_log.h"
+
+static const NdefParseLimits ndef_parse_limits_default = {
+    0, 0, 0, NDEF_PARSE_DEFAULT_MAX_DEPTH
+};
+
+/*
+ * The current limits are an immutable snapshot, read without locking
+ * by every parse. ndef_parse_limits_set() publishes a new snapshot
+ * rather than modifying the current one. Since the readers don't hold
+ * any reference, the replaced snapshots are never freed, but they are
+ * reused when the same limits are set again. The limits are normally
+ * configured once or a few times, so that doesn't add up to much.
+ */
+static const NdefParseLimits* ndef_parse_limits = &ndef_parse_limits_default;
+static GSList* ndef_parse_limits_snapshots;
+
+/* Serializes the writers */
+G_LOCK_DEFINE_STATIC(ndef_parse_limits);
+
+static
+gboolean
+ndef_parse_limits_equal(
+    const NdefParseLimits* l1,
+    const NdefParseLimits* l2)
+{
+    return l1->max_records == l2->max_records &&
+        l1->max_payload == l2->max_payload &&
+        l1->max_alloc == l2->max_alloc &&
+        l1->max_depth == l2->max_depth;
+}
+
+/*==========================================================================*
+ * Interface
+ *==========================================================================*/
+
+void
+ndef_parse_limits_get(
+    NdefParseLimits* limits) /* Since 1.1.0 */
+{
+    if (G_LIKELY(limits)) {
+        *limits = *(const NdefParseLimits*)
+            g_atomic_pointer_get(&ndef_parse_limits);
+    }
+}
+
+void
+ndef_parse_limits_set(
+    const NdefParseLimits* limits) /* Since 1.1.0 */
+{
+    const NdefParseLimits* snapshot = &ndef_parse_limits_default;
+
+    G_LOCK(ndef_parse_limits);
+    if (limits && !ndef_parse_limits_equal(limits, snapshot)) {
+        GSList* l;
+
+        for (l = ndef_parse_limits_snapshots; l; l = l->next) {
+            if (ndef_parse_limits_equal(limits, l->data)) {
+                break;
+            }
+        }
+        if (l) {
+            snapshot = l->data;
+        } else {
+            NdefParseLimits* copy = g_new0(NdefParseLimits, 1);
+
+            copy->max_records = limits->max_records;
+            copy->max_payload = limits->max_payload;
+            copy->max_alloc = limits->max_alloc;
+            copy->max_depth = limits->max_depth;
+            ndef_parse_limits_snapshots =
+                g_slist_prepend(ndef_parse_limits_snapshots, copy);
+            snapshot = copy;
+        }
+    }
+    g_atomic_pointer_set(&ndef_parse_limits, snapshot);
+    G_UNLOCK(ndef_parse_limits);
+}
+
+/*==========================================================================*
+ * Internal interface
+ *==========================================================================*/
+
+/* NULL limits means the current process-wide limits */
+void
+ndef_parse_state_init(
+    NdefParseState* state,
+    const NdefParseLimits* limits,
+    guint depth)
+{
+    memset(state, 0, sizeof(*state));
+    if (limits) {
+        state->limits = *limits;
+    } else {
+        ndef_parse_limits_get(&state->limits);
+    }
+    state->depth = depth;
+}
+
+/*
+ * Walks the headers of the records in the block and checks the number
+ * of records and the size of their payload against the limits. Nothing
+ * gets allocated, that's the point.
+ */
+gboolean
+ndef_parse_state_check(
+    NdefParseState* state,
+    const GUtilData* block)
+{
+    const NdefParseLimits* limits = &state->limits;
+
+    if (!state->failed && (limits->max_records || limits->max_payload)) {
+        GUtilData data = *block;
+        guint64 payload = 0;
+        NdefData ndef;
+
+        while (data.size > 0 && ndef_rec_parse(&data, &ndef)) {
+            if ((ndef.rec.bytes[0] & NDEF_HDR_TNF_MASK) !=
+                NDEF_TNF_UNCHANGED) {
+                /* Chunks are counted as a single record */
+                payload = 0;
+                state->records++;
+                if (limits->max_records &&
+                    state->records > limits->max_records) {
+                    GWARN("Too many NDEF records (%u max)",
+                        limits->max_records);
+                    state->failed = TRUE;
+                    break;
+                }
+            }
+            payload += ndef.payload_length;
+            if (limits->max_payload && payload > limits->max_payload) {
+                GWARN("NDEF payload is too large (%u max)",
+                    limits->max_payload);
+                state->failed = TRUE;
+                break;
+            }
+        }
+    }
+    return !state->failed;
+}
+
+gboolean
+ndef_parse_state_alloc(
+    NdefParseState* state,
+    gsize size)
+{
+    if (!state->failed) {
+        const gsize max_alloc = state->limits.max_alloc;
+
+        if (max_alloc && (size > max_alloc ||
+            state->alloc > (max_alloc - size))) {
+            GWARN("NDEF message requires too much memory (%lu max)",
+                (gulong)max_alloc);
+            state->failed = TRUE;
+        } else {
+            state->alloc += size;
+        }
+    }
+    return !state->failed;
+}
+
+gboolean
+ndef_parse_state_enter(
+    NdefParseState* state)
+{
+    if (!state->failed) {
+        const guint max_depth = state->limits.max_depth;
+
+        if (max_depth && state->depth >= max_depth) {
+            GWARN("NDEF records are nested too deep (%u max)", max_depth);
+            state->failed = TRUE;
+        } else {
+            state->depth++;
+        }
+    }
+    return !state->failed;
+}
+
+void
+ndef_parse_state_leave(
+    NdefParseState* state)
+{
+    GASSERT(state->depth);
+    state->depth--;
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,325 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "ndef_msg.h"
+#include "ndef_rec_p.h"
+#include "ndef_log.h"
+
+#include <gutil_macros.h>
+
+/* The array of records immediately follows this structure */
+typedef struct ndef_msg_priv {
+    NdefMsg pub;
+    gint ref_count;
+} NdefMsgPriv;
+
+#define ndef_msg_cast(msg) G_CAST(msg, NdefMsgPriv, pub)
+
+/*==========================================================================*
+ * Interface
+ *==========================================================================*/
+
+NdefMsg*
+ndef_msg_new(
+    const GUtilData* block,
+    NDEF_PARSE_FLAGS flags) /* Since 1.1.0 */
+{
+    NdefRec* rec = ndef_rec_new_full(block, flags);
+    NdefMsg* msg = ndef_msg_new_from_rec(rec);
+
+    ndef_rec_unref(rec);
+    return msg;
+}
+
+NdefMsg*
+ndef_msg_new_from_tlv(
+    const GUtilData* tlv,
+    NDEF_PARSE_FLAGS flags) /* Since 1.1.0 */
+{
+    NdefRec* rec = ndef_rec_new_from_tlv_full(tlv, flags);
+    NdefMsg* msg = ndef_msg_new_from_rec(rec);
+
+    ndef_rec_unref(rec);
+    return msg;
+}
+
+NdefMsg*
+ndef_msg_new_from_rec(
+    NdefRec* first) /* Since 1.1.0 */
+{
+    if (G_LIKELY(first)) {
+        NdefMsgPriv* priv;
+        NdefRec** recs;
+        NdefRec* rec;
+        guint i, n = 0;
+
+        for (rec = first; rec; rec = rec->next) {
+            n++;
+        }
+
+        /* One allocation for both the structure and the array */
+        priv = g_malloc(sizeof(NdefMsgPriv) + n * sizeof(NdefRec*));
+        recs = (NdefRec**)(priv + 1);
+        for (i = 0, rec = first; i < n; i++, rec = rec->next) {
+            recs[i] = ndef_rec_ref(rec);
+            ndef_rec_set_index(rec, i);
+        }
+        priv->ref_count = 1;
+        priv->pub.rec = recs;
+        priv->pub.count = n;
+        return &priv->pub;
+    }
+    return NULL;
+}
+
+NdefMsg*
+ndef_msg_ref(
+    NdefMsg* msg) /* Since 1.1.0 */
+{
+    if (G_LIKELY(msg)) {
+        NdefMsgPriv* priv = ndef_msg_cast(msg);
+
+        GASSERT(priv->ref_count > 0);
+        g_atomic_int_inc(&priv->ref_count);
+    }
+    return msg;
+}
+
+void
+ndef_msg_unref(
+    NdefMsg* msg) /* Since 1.1.0 */
+{
+    if (G_LIKELY(msg)) {
+        NdefMsgPriv* priv = ndef_msg_cast(msg);
+
+        GASSERT(priv->ref_count > 0);
+        if (g_atomic_int_dec_and_test(&priv->ref_count)) {
+            guint i;
+
+            for (i = 0; i < msg->count; i++) {
+                ndef_rec_unref(msg->rec[i]);
+            }
+            g_free(priv);
+        }
+    }
+}
+
+NdefRec*
+ndef_msg_rec_at(
+    const NdefMsg* msg,
+    guint index) /* Since 1.1.0 */
+{
+    return (G_LIKELY(msg) && index < msg->count) ? msg->rec[index] : NULL;
+}
+
+NdefRec*
+ndef_msg_last(
+    const NdefMsg* msg) /* Since 1.1.0 */
+{
+    return G_LIKELY(msg) ? msg->rec[msg->count - 1] : NULL;
+}
+
+int
+ndef_msg_index_of(
+    const NdefMsg* msg,
+    const NdefRec* rec) /* Since 1.1.0 */
+{
+    if (G_LIKELY(msg) && G_LIKELY(rec)) {
+        const guint index = ndef_rec_index(rec);
+        guint i;
+
+        if (index < msg->count && msg->rec[index] == rec) {
+            /* The hint is correct (it normally is) */
+            return index;
+        }
+
+        /* The record is shared with another message */
+        for (i = 0; i < msg->count; i++) {
+            if (msg->rec[i] == rec) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+void
+ndef_rec_iter_init(
+    NdefRecIter* iter,
+    const GUtilData* block) /* Since 1.1.0 */
+{
+    if (G_LIKELY(iter)) {
+        if (G_LIKELY(block)) {
+            iter->buf = *block;
+        } else {
+            iter->buf.bytes = NULL;
+            iter->buf.size = 0;
+        }
+        iter->chunk = FALSE;
+    }
+}
+
+gboolean
+ndef_rec_iter_next(
+    NdefRecIter* iter,
+    NdefRecView* view) /* Since 1.1.0 */
+{
+    if (G_LIKELY(iter)) {
+        NdefData ndef;
+
+        while (iter->buf.size > 0 && ndef_rec_parse(&iter->buf, &ndef)) {
+            const guint8 hdr = ndef.rec.bytes[0];
+
+            /* Skip the same records as ndef_rec_new() drops */
+            if (iter->chunk) {
+                if ((hdr & (NDEF_HDR_MB | NDEF_HDR_IL | NDEF_HDR_TNF_MASK))
+                    == NDEF_TNF_UNCHANGED && !ndef.type_length) {
+                    /* The terminating chunk has CF cleared */
+                    iter->chunk = (hdr & NDEF_HDR_CF) != 0;
+                    continue;
+                }
+                /* Invalid chunk, start over with this record */
+                iter->chunk = FALSE;
+            }
+            if ((hdr & NDEF_HDR_TNF_MASK) == NDEF_TNF_UNCHANGED) {
+                /* Not preceded by the first chunk */
+                continue;
+            } else if (hdr & NDEF_HDR_CF) {
+                iter->chunk = TRUE;
+            } else {
+                if (view) {
+                    view->tnf = ndef_tnf(&ndef);
+                    view->flags = ndef_flags(&ndef);
+                    view->raw = ndef.rec;
+                    ndef_type(&ndef, &view->type);
+                    ndef_payload(&ndef, &view->payload);
+                    if (ndef.id_length) {
+                        view->id.bytes = ndef.rec.bytes + ndef.type_offset +
+                            ndef.type_length;
+                        view->id.size = ndef.id_length;
+                    } else {
+                        view->id.bytes = NULL;
+                        view->id.size = 0;
+                    }
+                }
+                return TRUE;
+            }
+        }
+
+        /* Stop at the end of the block or the first broken record */
+        iter->buf.size = 0;
+    }
+    return FALSE;
+}
+
+gsize
+ndef_msg_check(
+    const GUtilData* block,
+    NdefMsgInfo* info) /* Since 1.1.0 */
+{
+    NDEF_MSG_CHECK_FLAGS flags = NDEF_MSG_CHECK_FLAGS_NONE;
+    gboolean chunk = FALSE;
+    gboolean end = FALSE;
+    guint count = 0;
+    gsize size = 0;
+
+    if (G_LIKELY(block) && block->size) {
+        GUtilData buf = *block;
+        NdefData ndef;
+
+        while (!end && buf.size > 0) {
+            guint8 hdr;
+
+            if (!ndef_rec_parse(&buf, &ndef)) {
+                flags |= NDEF_MSG_CHECK_FLAG_GARBAGE;
+                break;
+            }
+
+            hdr = ndef.rec.bytes[0];
+            if ((size == 0) != ((hdr & NDEF_HDR_MB) != 0)) {
+                /* MB must be set for the first record and only for it */
+                flags |= NDEF_MSG_CHECK_FLAG_BAD_MB;
+            }
+            size += ndef.rec.size;
+            if (hdr & NDEF_HDR_ME) {
+                end = TRUE;
+            }
+
+            if (chunk) {
+                /* Middle or terminating chunk */
+                if ((hdr & (NDEF_HDR_IL | NDEF_HDR_TNF_MASK)) !=
+                    NDEF_TNF_UNCHANGED || ndef.type_length) {
+                    flags |= NDEF_MSG_CHECK_FLAG_BAD_CHUNK;
+                }
+                chunk = ((hdr & NDEF_HDR_CF) != 0);
+            } else if ((hdr & NDEF_HDR_TNF_MASK) == NDEF_TNF_UNCHANGED) {
+                /* Not preceded by the first chunk */
+                flags |= NDEF_MSG_CHECK_FLAG_BAD_CHUNK;
+            } else {
+                if (hdr & NDEF_HDR_CF) {
+                    flags |= NDEF_MSG_CHECK_FLAG_CHUNKED;
+                    chunk = TRUE;
+                }
+                count++;
+            }
+        }
+
+        if (chunk) {
+            /* Either unterminated or has ME set in the middle */
+            flags |= NDEF_MSG_CHECK_FLAG_BAD_CHUNK;
+        }
+        if (!end) {
+            flags |= NDEF_MSG_CHECK_FLAG_BAD_ME;
+        }
+    }
+
+    if (info) {
+        info->count = count;
+        info->size = size;
+        info->flags = flags;
+    }
+    return (flags & NDEF_MSG_CHECK_ERRORS) ? 0 : size;
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,478 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "ndef_msg.h"
+#include "ndef_rec_p.h"
+#include "ndef_stats_p.h"
+#include "ndef_log.h"
+
+#include <gutil_misc.h>
+
+typedef enum ndef_msg_builder_payload {
+    NDEF_MSG_BUILDER_PAYLOAD_DATA,      /* Written as is */
+    NDEF_MSG_BUILDER_PAYLOAD_URI,       /* Identifier code + the rest */
+    NDEF_MSG_BUILDER_PAYLOAD_UTF8,      /* Status + lang + UTF-8 text */
+    NDEF_MSG_BUILDER_PAYLOAD_UTF16      /* Status + lang + UTF-16BE text */
+} NDEF_MSG_BUILDER_PAYLOAD;
+
+typedef struct ndef_msg_builder_rec {
+    guint8 tnf;                 /* Raw TNF bits, not necessarily NDEF_TNF */
+    NDEF_MSG_BUILDER_PAYLOAD encoding;
+    GUtilData type;
+    GUtilData id;
+    GUtilData payload;          /* Data, URI or text (UTF-8) */
+    gsize payload_length;       /* Encoded payload length */
+    GUtilData lang;             /* Text language */
+    guint8 lead;                /* URI identifier code or Text status */
+    gboolean bom;               /* UTF-16 text needs BOM */
+    NdefRec* rec;               /* Holds the data (optional) */
+    char* lang_buf;             /* Holds the language (optional) */
+} NdefMsgBuilderRec;
+
+struct ndef_msg_builder {
+    GArray* recs;               /* NdefMsgBuilderRec */
+    gsize size;                 /* Size of the encoded message */
+};
+
+/* NFCForum-TS-RTD_Text_1.0 */
+#define TEXT_STATUS_ENC_UTF16 (0x80)
+#define TEXT_LANG_MAX (0x3f)
+#define UTF16_BOM (0xfeff)
+
+static
+void
+ndef_msg_builder_data_init(
+    GUtilData* data,
+    const GUtilData* src)
+{
+    if (src && src->size) {
+        *data = *src;
+    } else {
+        data->bytes = NULL;
+        data->size = 0;
+    }
+}
+
+static
+void
+ndef_msg_builder_clear(
+    NdefMsgBuilder* self)
+{
+    guint i;
+
+    for (i = 0; i < self->recs->len; i++) {
+        NdefMsgBuilderRec* rec = &g_array_index(self->recs,
+            NdefMsgBuilderRec, i);
+
+        ndef_rec_unref(rec->rec);
+        g_free(rec->lang_buf);
+    }
+    g_array_set_size(self->recs, 0);
+    self->size = 0;
+}
+
+static
+gboolean
+ndef_msg_builder_append(
+    NdefMsgBuilder* self,
+    NdefMsgBuilderRec* rec)
+{
+    /*
+     * NFCForum-TS-NDEF_1.0, section 3.3.1 "Empty": TYPE_LENGTH,
+     * ID_LENGTH, and PAYLOAD_LENGTH fields MUST be zero.
+     */
+    if (rec->tnf <= NDEF_TNF_UNCHANGED &&
+        rec->type.size <= 0xff && rec->id.size <= 0xff &&
+        rec->payload_length < 0x80000000 && (rec->tnf != NDEF_TNF_EMPTY ||
+        !(rec->type.size || rec->id.size || rec->payload_length))) {
+        g_array_append_vals(self->recs, rec, 1);
+        self->size += ndef_rec_header_size(0, rec->id.size,
+            rec->payload_length) + rec->type.size + rec->id.size +
+            rec->payload_length;
+        return TRUE;
+    }
+    GWARN("Invalid NDEF record");
+    g_free(rec->lang_buf);
+    return FALSE;
+}
+
+/* Number of bytes taken by the text encoded in UTF-16 */
+static
+gsize
+ndef_msg_builder_utf16_size(
+    const GUtilData* text)
+{
+    const char* ptr = (const char*)text->bytes;
+    const char* end = ptr + text->size;
+    gsize size = 0;
+
+    while (ptr < end) {
+        /* Code points outside of BMP are encoded as surrogate pairs */
+        size += (g_utf8_get_char(ptr) < 0x10000) ? 2 : 4;
+        ptr = g_utf8_next_char(ptr);
+    }
+    return size;
+}
+
+static
+guint8*
+ndef_msg_builder_write_utf16(
+    guint8* ptr,
+    const GUtilData* text,
+    gboolean bom)
+{
+    const char* src = (const char*)text->bytes;
+    const char* end = src + text->size;
+
+    /* Big endian */
+    if (bom) {
+        *ptr++ = (guint8)(UTF16_BOM >> 8);
+        *ptr++ = (guint8)UTF16_BOM;
+    }
+    while (src < end) {
+        gunichar c = g_utf8_get_char(src);
+
+        if (c >= 0x10000) {
+            const gunichar hi = 0xd800 + ((c - 0x10000) >> 10);
+
+            *ptr++ = (guint8)(hi >> 8);
+            *ptr++ = (guint8)hi;
+            c = 0xdc00 + ((c - 0x10000) & 0x3ff);
+        }
+        *ptr++ = (guint8)(c >> 8);
+        *ptr++ = (guint8)c;
+        src = g_utf8_next_char(src);
+    }
+    return ptr;
+}
+
+static
+guint8*
+ndef_msg_builder_write_payload(
+    const NdefMsgBuilderRec* rec,
+    guint8* ptr)
+{
+    switch (rec->encoding) {
+    case NDEF_MSG_BUILDER_PAYLOAD_DATA:
+        break;
+    case NDEF_MSG_BUILDER_PAYLOAD_URI:
+        *ptr++ = rec->lead;
+        break;
+    case NDEF_MSG_BUILDER_PAYLOAD_UTF8:
+    case NDEF_MSG_BUILDER_PAYLOAD_UTF16:
+        *ptr++ = rec->lead;
+        ptr = ndef_rec_write_data(ptr, &rec->lang);
+        if (rec->encoding == NDEF_MSG_BUILDER_PAYLOAD_UTF16) {
+            return ndef_msg_builder_write_utf16(ptr, &rec->payload,
+                rec->bom);
+        }
+        break;
+    }
+    return ndef_rec_write_data(ptr, &rec->payload);
+}
+
+static
+guint8*
+ndef_msg_builder_write(
+    const NdefMsgBuilder* self,
+    guint8* ptr)
+{
+    const guint n = self->recs->len;
+    guint i;
+
+    for (i = 0; i < n; i++) {
+        const NdefMsgBuilderRec* rec = &g_array_index(self->recs,
+            NdefMsgBuilderRec, i);
+        const guint8 hdr = rec->tnf |
+            (i ? 0 : NDEF_HDR_MB) |
+            ((i == n - 1) ? NDEF_HDR_ME : 0);
+
+        ptr = ndef_rec_write_header(ptr, hdr, rec->type.size, rec->id.size,
+            rec->payload_length);
+        ptr = ndef_rec_write_data(ptr, &rec->type);
+        ptr = ndef_rec_write_data(ptr, &rec->id);
+        ptr = ndef_msg_builder_write_payload(rec, ptr);
+    }
+    return ptr;
+}
+
+static
+gboolean
+ndef_msg_builder_add_data(
+    NdefMsgBuilder* self,
+    guint8 tnf,
+    const GUtilData* type,
+    const GUtilData* id,
+    const GUtilData* payload)
+{
+    NdefMsgBuilderRec rec;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.tnf = tnf;
+    ndef_msg_builder_data_init(&rec.type, type);
+    ndef_msg_builder_data_init(&rec.id, id);
+    ndef_msg_builder_data_init(&rec.payload, payload);
+    rec.payload_length = rec.payload.size;
+    return ndef_msg_builder_append(self, &rec);
+}
+
+/*==========================================================================*
+ * Interface
+ *==========================================================================*/
+
+NdefMsgBuilder*
+ndef_msg_builder_new(
+    void) /* Since 1.1.0 */
+{
+    NdefMsgBuilder* self = g_slice_new0(NdefMsgBuilder);
+
+    self->recs = g_array_new(FALSE, FALSE, sizeof(NdefMsgBuilderRec));
+    return self;
+}
+
+void
+ndef_msg_builder_free(
+    NdefMsgBuilder* self) /* Since 1.1.0 */
+{
+    if (G_LIKELY(self)) {
+        ndef_msg_builder_clear(self);
+        g_array_free(self->recs, TRUE);
+        g_slice_free(NdefMsgBuilder, self);
+    }
+}
+
+gboolean
+ndef_msg_builder_add(
+    NdefMsgBuilder* self,
+    NDEF_TNF tnf,
+    const GUtilData* type,
+    const GUtilData* id,
+    const GUtilData* payload) /* Since 1.1.0 */
+{
+    return G_LIKELY(self) && (guint)tnf <= NDEF_TNF_MAX &&
+        ndef_msg_builder_add_data(self, (guint8)tnf, type, id, payload);
+}
+
+gboolean
+ndef_msg_builder_add_rec(
+    NdefMsgBuilder* self,
+    NdefRec* rec) /* Since 1.1.0 */
+{
+    /* Copy the raw TNF, rec->tnf can't represent all of them */
+    if (G_LIKELY(self) && G_LIKELY(rec) && ndef_msg_builder_add_data(self,
+        ndef_rec_tnf_bits(rec), &rec->type, &rec->id, &rec->payload)) {
+        g_array_index(self->recs, NdefMsgBuilderRec,
+            self->recs->len - 1).rec = ndef_rec_ref(rec);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+gboolean
+ndef_msg_builder_add_uri(
+    NdefMsgBuilder* self,
+    const char* uri) /* Since 1.1.0 */
+{
+    if (G_LIKELY(self) && G_LIKELY(uri)) {
+        NdefMsgBuilderRec rec;
+        gsize skip;
+
+        memset(&rec, 0, sizeof(rec));
+        rec.tnf = NDEF_TNF_WELL_KNOWN;
+        rec.encoding = NDEF_MSG_BUILDER_PAYLOAD_URI;
+        rec.type = ndef_rec_type_u;
+        rec.lead = ndef_rec_u_abbreviate(uri, &skip);
+        gutil_data_from_string(&rec.payload, uri + skip);
+        rec.payload_length = 1 + rec.payload.size;
+        return ndef_msg_builder_append(self, &rec);
+    }
+    return FALSE;
+}
+
+gboolean
+ndef_msg_builder_add_text(
+    NdefMsgBuilder* self,
+    const char* text,
+    const char* lang) /* Since 1.1.0 */
+{
+    if (G_LIKELY(self) && G_LIKELY(text) &&
+        g_utf8_validate(text, -1, NULL)) {
+        NdefMsgBuilderRec rec;
+        gsize utf16_size;
+
+        memset(&rec, 0, sizeof(rec));
+        if (!lang) {
+            lang = rec.lang_buf = ndef_rec_t_system_lang();
+            if (!lang) {
+                lang = "en";
+            }
+        }
+        gutil_data_from_string(&rec.lang, lang);
+        if (rec.lang.size > TEXT_LANG_MAX) {
+            GWARN("Language code too long: %s", lang);
+            g_free(rec.lang_buf);
+            return FALSE;
+        }
+
+        /* Pick the most compact encoding */
+        rec.tnf = NDEF_TNF_WELL_KNOWN;
+        rec.type = ndef_rec_type_t;
+        gutil_data_from_string(&rec.payload, text);
+        utf16_size = ndef_msg_builder_utf16_size(&rec.payload);
+        if (utf16_size) {
+            /*
+             * NFCForum-TS-RTD_Text_1.0, 3.4 UTF-16 Byte Order: If the BOM
+             * is omitted, the byte order shall be big-endian. But if the
+             * text itself starts with something that looks like a BOM,
+             * we have to add one.
+             */
+            const gunichar c = g_utf8_get_char(text);
+
+            if (c == UTF16_BOM || c == 0xfffe) {
+                rec.bom = TRUE;
+                utf16_size += 2;
+            }
+        }
+        if (utf16_size < rec.payload.size) {
+            rec.encoding = NDEF_MSG_BUILDER_PAYLOAD_UTF16;
+            rec.lead = TEXT_STATUS_ENC_UTF16 | (guint8)rec.lang.size;
+            rec.payload_length = 1 + rec.lang.size + utf16_size;
+        } else {
+            rec.encoding = NDEF_MSG_BUILDER_PAYLOAD_UTF8;
+            rec.lead = (guint8)rec.lang.size;
+            rec.bom = FALSE;
+            rec.payload_length = 1 + rec.lang.size + rec.payload.size;
+        }
+        return ndef_msg_builder_append(self, &rec);
+    }
+    return FALSE;
+}
+
+gsize
+ndef_msg_builder_size(
+    const NdefMsgBuilder* self) /* Since 1.1.0 */
+{
+    return G_LIKELY(self) ? self->size : 0;
+}
+
+gsize
+ndef_msg_builder_tlv_size(
+    const NdefMsgBuilder* self,
+    const NdefTlvParams* params) /* Since 1.1.0 */
+{
+    return G_LIKELY(self) ? ndef_tlv_size(self->size, params) : 0;
+}
+
+gsize
+ndef_msg_builder_tlv(
+    NdefMsgBuilder* self,
+    const NdefTlvParams* params,
+    void* buf,
+    gsize capacity,
+    gsize* overflow) /* Since 1.1.0 */
+{
+    gsize size = ndef_msg_builder_tlv_size(self, params);
+
+    if (size > capacity || (size && !buf)) {
+        /* Doesn't fit, the builder remains intact */
+        if (overflow) {
+            *overflow = (size > capacity) ? (size - capacity) : 0;
+        }
+        return 0;
+    }
+    if (overflow) {
+        *overflow = 0;
+    }
+    if (size) {
+        guint8* ptr = ndef_tlv_write_head(buf, self->size, params);
+
+        ptr = ndef_msg_builder_write(self, ptr);
+        ndef_tlv_write_tail(ptr, (guint8*)buf + size);
+        ndef_msg_builder_clear(self);
+    }
+    return size;
+}
+
+GBytes*
+ndef_msg_builder_bytes(
+    NdefMsgBuilder* self) /* Since 1.1.0 */
+{
+    if (G_LIKELY(self)) {
+        const gsize size = self->size;
+        GBytes* bytes;
+
+        if (size) {
+            guint8* buf = g_malloc(size);
+            guint8* end = ndef_msg_builder_write(self, buf);
+
+            NDEF_STATS_INC(allocs);
+            GASSERT(end == buf + size);
+            (void)end;
+            bytes = g_bytes_new_take(buf, size);
+        } else {
+            bytes = g_bytes_new_static(NULL, 0);
+        }
+        ndef_msg_builder_clear(self);
+        return bytes;
+    }
+    return NULL;
+}
+
+NdefRec*
+ndef_msg_builder_build(
+    NdefMsgBuilder* self) /* Since 1.1.0 */
+{
+    GBytes* bytes = ndef_msg_builder_bytes(self);
+
+    if (bytes) {
+        /* The records take their own references */
+        NdefRec* rec = ndef_rec_new_bytes(bytes);
+
+        g_bytes_unref(bytes);
+        return rec;
+    }
+    return NULL;
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,437 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "ndef_msg.h"
+#include "ndef_rec_p.h"
+#include "ndef_log.h"
+
+/*
+ * The template is compiled into a tree of records. The payload of each
+ * record is a sequence of literal pieces (pointing into the records the
+ * template was compiled from) and slot references. Smart Poster records
+ * containing slots are compiled recursively, so that the lengths of the
+ * nested records get fixed up too. Instantiating the template is a matter
+ * of adding up the lengths and copying the pieces into the output buffer.
+ */
+
+#define SLOT_NONE (-1)
+#define PAYLOAD_LENGTH_MAX (0x7fffffff)
+
+typedef struct ndef_msg_template_part {
+    GUtilData data;             /* Literal data */
+    gint slot;                  /* Or the slot index */
+} NdefMsgTemplatePart;
+
+typedef struct ndef_msg_template_rec NdefMsgTemplateRec;
+struct ndef_msg_template_rec {
+    NdefMsgTemplateRec* next;
+    NdefMsgTemplateRec* nested; /* The payload is a nested message */
+    NdefMsgTemplatePart* parts; /* Otherwise, it's made of the parts */
+    guint n_parts;
+    guint8 tnf;                 /* Raw TNF bits */
+    GUtilData type;
+    GUtilData id;
+};
+
+struct ndef_msg_template {
+    NdefMsgTemplateRec* recs;
+    GSList* data;               /* NdefRec chains holding the data */
+    char** slots;
+    gsize* slot_len;
+    guint n_slots;
+};
+
+static
+const guint8*
+ndef_msg_template_find(
+    const NdefMsgTemplate* self,
+    const guint8* ptr,
+    const guint8* end,
+    gint* slot)
+{
+    for (; ptr < end; ptr++) {
+        guint i;
+
+        for (i = 0; i < self->n_slots; i++) {
+            const gsize len = self->slot_len[i];
+
+            if (len <= (gsize)(end - ptr) && ptr[0] == self->slots[i][0] &&
+                !memcmp(ptr, self->slots[i], len)) {
+                *slot = i;
+                return ptr;
+            }
+        }
+    }
+    return NULL;
+}
+
+static
+void
+ndef_msg_template_split(
+    NdefMsgTemplate* self,
+    NdefMsgTemplateRec* node,
+    const GUtilData* payload)
+{
+    const guint8* ptr = payload->bytes;
+    const guint8* end = ptr + payload->size;
+    GArray* parts = g_array_new(FALSE, FALSE, sizeof(NdefMsgTemplatePart));
+    NdefMsgTemplatePart part;
+    const guint8* found;
+
+    while ((found = ndef_msg_template_find(self, ptr, end, &part.slot))) {
+        const gint slot = part.slot;
+
+        if (found > ptr) {
+            part.data.bytes = ptr;
+            part.data.size = found - ptr;
+            part.slot = SLOT_NONE;
+            g_array_append_vals(parts, &part, 1);
+        }
+        memset(&part.data, 0, sizeof(part.data));
+        part.slot = slot;
+        g_array_append_vals(parts, &part, 1);
+        ptr = found + self->slot_len[slot];
+    }
+    if (end > ptr) {
+        part.data.bytes = ptr;
+        part.data.size = end - ptr;
+        part.slot = SLOT_NONE;
+        g_array_append_vals(parts, &part, 1);
+    }
+    node->n_parts = parts->len;
+    node->parts = (NdefMsgTemplatePart*)g_array_free(parts, FALSE);
+}
+
+static
+NdefMsgTemplateRec*
+ndef_msg_template_compile(
+    NdefMsgTemplate* self,
+    NdefRec* rec)
+{
+    NdefMsgTemplateRec* first = NULL;
+    NdefMsgTemplateRec* last = NULL;
+
+    for (; rec; rec = rec->next) {
+        NdefMsgTemplateRec* node = g_new0(NdefMsgTemplateRec, 1);
+        const GUtilData* payload = &rec->payload;
+        gint slot;
+
+        node->tnf = ndef_rec_tnf_bits(rec);
+        node->type = rec->type;
+        node->id = rec->id;
+        if (rec->tnf == NDEF_TNF_WELL_KNOWN &&
+            rec->rtd == NDEF_RTD_SMART_POSTER &&
+            ndef_msg_template_find(self, payload->bytes, payload->bytes +
+            payload->size, &slot)) {
+            NdefRec* nested = ndef_rec_new(payload);
+
+            if (nested) {
+                self->data = g_slist_prepend(self->data, nested);
+                node->nested = ndef_msg_template_compile(self, nested);
+            }
+        }
+        if (!node->nested) {
+            ndef_msg_template_split(self, node, payload);
+        }
+        if (last) {
+            last->next = node;
+        } else {
+            first = node;
+        }
+        last = node;
+    }
+    return first;
+}
+
+static
+void
+ndef_msg_template_free_recs(
+    NdefMsgTemplateRec* node)
+{
+    while (node) {
+        NdefMsgTemplateRec* next = node->next;
+
+        ndef_msg_template_free_recs(node->nested);
+        g_free(node->parts);
+        g_free(node);
+        node = next;
+    }
+}
+
+static
+gsize
+ndef_msg_template_chain_size(
+    const NdefMsgTemplateRec* node,
+    const GUtilData* values,
+    guint count);
+
+/* Returns G_MAXSIZE if the payload gets too large */
+static
+gsize
+ndef_msg_template_payload_length(
+    const NdefMsgTemplateRec* node,
+    const GUtilData* values,
+    guint count)
+{
+    gsize len = 0;
+
+    if (node->nested) {
+        /* Zero means that the nested message is too large */
+        len = ndef_msg_template_chain_size(node->nested, values, count);
+        if (!len) {
+            return G_MAXSIZE;
+        }
+    } else {
+        guint i;
+
+        for (i = 0; i < node->n_parts; i++) {
+            const NdefMsgTemplatePart* part = node->parts + i;
+            gsize part_len = 0;
+
+            if (part->slot == SLOT_NONE) {
+                part_len = part->data.size;
+            } else if ((guint)part->slot < count) {
+                part_len = values[part->slot].size;
+            }
+            if (part_len > PAYLOAD_LENGTH_MAX - len) {
+                return G_MAXSIZE;
+            }
+            len += part_len;
+        }
+    }
+    return (len <= PAYLOAD_LENGTH_MAX) ? len : G_MAXSIZE;
+}
+
+/* Returns zero if the message gets too large */
+static
+gsize
+ndef_msg_template_chain_size(
+    const NdefMsgTemplateRec* node,
+    const GUtilData* values,
+    guint count)
+{
+    gsize size = 0;
+
+    for (; node; node = node->next) {
+        const gsize len = ndef_msg_template_payload_length(node, values,
+            count);
+        gsize rec_size;
+
+        if (len == G_MAXSIZE) {
+            return 0;
+        }
+        rec_size = ndef_rec_header_size(0, node->id.size, len) +
+            node->type.size + node->id.size + len;
+        if (rec_size > G_MAXSIZE - size) {
+            return 0;
+        }
+        size += rec_size;
+    }
+    return size;
+}
+
+static
+guint8*
+ndef_msg_template_write(
+    const NdefMsgTemplateRec* node,
+    const GUtilData* values,
+    guint count,
+    guint8* ptr)
+{
+    guint8 hdr = NDEF_HDR_MB;
+
+    for (; node; node = node->next) {
+        const gsize len = ndef_msg_template_payload_length(node, values,
+            count);
+
+        if (!node->next) {
+            hdr |= NDEF_HDR_ME;
+        }
+        ptr = ndef_rec_write_header(ptr, hdr | node->tnf, node->type.size,
+            node->id.size, len);
+        ptr = ndef_rec_write_data(ptr, &node->type);
+        ptr = ndef_rec_write_data(ptr, &node->id);
+        if (node->nested) {
+            ptr = ndef_msg_template_write(node->nested, values, count, ptr);
+        } else {
+            guint i;
+
+            for (i = 0; i < node->n_parts; i++) {
+                const NdefMsgTemplatePart* part = node->parts + i;
+
+                if (part->slot == SLOT_NONE) {
+                    ptr = ndef_rec_write_data(ptr, &part->data);
+                } else if ((guint)part->slot < count) {
+                    ptr = ndef_rec_write_data(ptr, values + part->slot);
+                }
+            }
+        }
+        hdr = 0;
+    }
+    return ptr;
+}
+
+/*==========================================================================*
+ * Interface
+ *==========================================================================*/
+
+NdefMsgTemplate*
+ndef_msg_template_new(
+    NdefRec* rec,
+    const char* const* slots) /* Since 1.1.0 */
+{
+    if (G_LIKELY(rec)) {
+        NdefMsgTemplate* self;
+        guint i, n = 0;
+
+        if (slots) {
+            for (n = 0; slots[n]; n++) {
+                if (!slots[n][0]) {
+                    GWARN("Empty template slot name");
+                    return NULL;
+                }
+            }
+        }
+
+        self = g_slice_new0(NdefMsgTemplate);
+        self->n_slots = n;
+        self->slots = g_new(char*, n + 1);
+        self->slot_len = g_new(gsize, n);
+        for (i = 0; i < n; i++) {
+            self->slots[i] = g_strdup(slots[i]);
+            self->slot_len[i] = strlen(slots[i]);
+        }
+        self->slots[n] = NULL;
+        self->data = g_slist_prepend(NULL, ndef_rec_ref(rec));
+        self->recs = ndef_msg_template_compile(self, rec);
+        return self;
+    }
+    return NULL;
+}
+
+void
+ndef_msg_template_free(
+    NdefMsgTemplate* self) /* Since 1.1.0 */
+{
+    if (G_LIKELY(self)) {
+        ndef_msg_template_free_recs(self->recs);
+        g_slist_free_full(self->data, (GDestroyNotify) ndef_rec_unref);
+        g_strfreev(self->slots);
+        g_free(self->slot_len);
+        g_slice_free(NdefMsgTemplate, self);
+    }
+}
+
+gint
+ndef_msg_template_slot(
+    const NdefMsgTemplate* self,
+    const char* name) /* Since 1.1.0 */
+{
+    if (G_LIKELY(self) && G_LIKELY(name)) {
+        guint i;
+
+        for (i = 0; i < self->n_slots; i++) {
+            if (!strcmp(self->slots[i], name)) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+gsize
+ndef_msg_template_encode(
+    const NdefMsgTemplate* self,
+    const GUtilData* values,
+    guint count,
+    void* buf,
+    gsize size) /* Since 1.1.0 */
+{
+    if (G_LIKELY(self)) {
+        const gsize msg_size = ndef_msg_template_chain_size(self->recs,
+            values, values ? count : 0);
+
+        if (!buf) {
+            return msg_size;
+        } else if (msg_size && msg_size <= size) {
+            guint8* end = ndef_msg_template_write(self->recs, values,
+                values ? count : 0, buf);
+
+            GASSERT(end == (guint8*)buf + msg_size);
+            (void)end;
+            return msg_size;
+        }
+    }
+    return 0;
+}
+
+gsize
+ndef_msg_template_encode_tlv(
+    const NdefMsgTemplate* self,
+    const GUtilData* values,
+    guint count,
+    const NdefTlvParams* params,
+    void* buf,
+    gsize size) /* Since 1.1.0 */
+{
+    if (G_LIKELY(self)) {
+        const gsize msg_size = ndef_msg_template_chain_size(self->recs,
+            values, values ? count : 0);
+        const gsize tlv_size = msg_size ? ndef_tlv_size(msg_size, params) : 0;
+
+        if (!buf) {
+            return tlv_size;
+        } else if (tlv_size && tlv_size <= size) {
+            guint8* ptr = ndef_tlv_write_head(buf, msg_size, params);
+
+            ptr = ndef_msg_template_write(self->recs, values,
+                values ? count : 0, ptr);
+            ndef_tlv_write_tail(ptr, (guint8*)buf + tlv_size);
+            return tlv_size;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,437 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "ndef_parser.h"
+#include "ndef_rec_p.h"
+#include "ndef_tlv.h"
+#include "ndef_log.h"
+
+typedef enum ndef_parser_msg_state {
+    NDEF_PARSER_MSG_RECORDS,
+    NDEF_PARSER_MSG_END,
+    NDEF_PARSER_MSG_BROKEN
+} NDEF_PARSER_MSG_STATE;
+
+typedef struct ndef_parser_output {
+    NdefRec* first;
+    NdefRec* last;
+} NdefParserOutput;
+
+struct ndef_parser {
+    NDEF_PARSE_FLAGS flags;
+    NDEF_PARSER_STATE state;
+    NdefParseLimits limits;
+    gboolean tlv;
+    /* Message */
+    NDEF_PARSER_MSG_STATE msg;
+    NdefParseState msg_limits;  /* Limits and accounting of the message */
+    guint records;              /* Records in the current message */
+    GByteArray* buf;            /* Records which haven't been emitted yet */
+    gsize scan;                 /* Offset of the first incomplete record */
+    /* TLV sequence */
+    guint8 tlv_hdr[4];
+    guint tlv_hdr_len;
+    guint tlv_type;
+    gsize tlv_left;             /* Remaining size of the current value */
+};
+
+/*
+ * Returns the size of the record at the beginning of the data, or the
+ * minimum size required to find that out if the header is incomplete.
+ * Zero means that the record is broken or its payload exceeds the limit.
+ */
+static
+gsize
+ndef_parser_rec_size(
+    const guint8* ptr,
+    gsize avail,
+    guint max_payload)
+{
+    if (avail > 0) {
+        const guint8 hdr = ptr[0];
+        const gsize hdr_size = ((hdr & NDEF_HDR_SR) ? 3 : 6) +
+            ((hdr & NDEF_HDR_IL) ? 1 : 0);
+
+        if (avail >= hdr_size) {
+            const guint type_length = ptr[1];
+            const guint id_length = (hdr & NDEF_HDR_IL) ?
+                ptr[hdr_size - 1] : 0;
+            guint payload_length;
+
+            if (hdr & NDEF_HDR_SR) {
+                payload_length = ptr[2];
+            } else {
+                payload_length = (((guint)ptr[2]) << 24) |
+                    (((guint)ptr[3]) << 16) |
+                    (((guint)ptr[4]) << 8) |
+                    ((guint)ptr[5]);
+                if (payload_length >= 0x80000000) {
+                    return 0;
+                }
+            }
+            if (max_payload && payload_length > max_payload) {
+                GWARN("NDEF payload is too large (%u max)", max_payload);
+                return 0;
+            }
+            return hdr_size + type_length + id_length + payload_length;
+        }
+        return hdr_size;
+    }
+    /* At least 3 bytes is required for anything meaningful */
+    return 3;
+}
+
+static
+void
+ndef_parser_output_append(
+    NdefParserOutput* out,
+    NdefRec* rec)
+{
+    if (rec) {
+        if (out->last) {
+            out->last->next = rec;
+        } else {
+            out->first = rec;
+        }
+        /* Could be a chain */
+        out->last = rec;
+        while (out->last->next) {
+            out->last = out->last->next;
+        }
+    }
+}
+
+static
+void
+ndef_parser_msg_reset(
+    NdefParser* self)
+{
+    self->msg = NDEF_PARSER_MSG_RECORDS;
+    ndef_parse_state_init(&self->msg_limits, &self->limits, 0);
+    self->records = 0;
+    self->scan = 0;
+    g_byte_array_set_size(self->buf, 0);
+}
+
+static
+void
+ndef_parser_msg_emit(
+    NdefParser* self,
+    NdefParserOutput* out)
+{
+    GUtilData block;
+
+    block.bytes = self->buf->data;
+    block.size = self->scan;
+    /* The limits are the ones which were in effect at creation time */
+    ndef_parser_output_append(out, ndef_rec_new_with_state(&block,
+        self->flags, &self->msg_limits));
+    g_byte_array_remove_range(self->buf, 0, self->scan);
+    self->scan = 0;
+    if (self->msg_limits.failed) {
+        self->msg = NDEF_PARSER_MSG_BROKEN;
+    }
+}
+
+static
+void
+ndef_parser_msg_feed(
+    NdefParser* self,
+    const guint8* data,
+    gsize len,
+    NdefParserOutput* out)
+{
+    if (self->msg == NDEF_PARSER_MSG_RECORDS) {
+        const NdefParseLimits* limits = &self->limits;
+        GByteArray* buf = self->buf;
+
+        if (limits->max_alloc && (len > limits->max_alloc ||
+            buf->len > limits->max_alloc - len)) {
+            /* Don't even buffer it */
+            GWARN("NDEF message requires too much memory (%lu max)",
+                (gulong)limits->max_alloc);
+            self->msg = NDEF_PARSER_MSG_BROKEN;
+            return;
+        }
+
+        g_byte_array_append(buf, data, len);
+        while (self->msg == NDEF_PARSER_MSG_RECORDS) {
+            const guint8* ptr = buf->data + self->scan;
+            const gsize avail = buf->len - self->scan;
+            const gsize size = ndef_parser_rec_size(ptr, avail,
+                limits->max_payload);
+
+            if (!size) {
+                GDEBUG("Garbage (record is too long)");
+                self->msg = NDEF_PARSER_MSG_BROKEN;
+            } else if (size <= avail) {
+                const guint8 hdr = ptr[0];
+
+                if ((hdr & NDEF_HDR_TNF_MASK) != NDEF_TNF_UNCHANGED &&
+                    limits->max_records &&
+                    ++self->records > limits->max_records) {
+                    GWARN("Too many NDEF records (%u max)",
+                        limits->max_records);
+                    self->msg = NDEF_PARSER_MSG_BROKEN;
+                    break;
+                }
+                self->scan += size;
+                if (!(hdr & NDEF_HDR_CF)) {
+                    /*
+                     * Either a complete record or the terminating
+                     * chunk, everything buffered so far can be parsed.
+                     */
+                    ndef_parser_msg_emit(self, out);
+                    if ((hdr & NDEF_HDR_ME) &&
+                        self->msg == NDEF_PARSER_MSG_RECORDS) {
+                        self->msg = NDEF_PARSER_MSG_END;
+                    }
+                }
+            } else {
+                /* Need more data */
+                break;
+            }
+        }
+    }
+}
+
+static
+gsize
+ndef_parser_msg_bytes_needed(
+    const NdefParser* self)
+{
+    if (self->msg == NDEF_PARSER_MSG_RECORDS) {
+        const GByteArray* buf = self->buf;
+        const gsize avail = buf->len - self->scan;
+
+        /* Record is incomplete, otherwise it would have been emitted */
+        return ndef_parser_rec_size(buf->data + self->scan, avail,
+            self->limits.max_payload) - avail;
+    }
+    return 0;
+}
+
+static
+void
+ndef_parser_tlv_value_done(
+    NdefParser* self)
+{
+    if (self->tlv_type == TLV_NDEF_MESSAGE) {
+        if (self->msg == NDEF_PARSER_MSG_RECORDS && self->buf->len) {
+            GDEBUG("Incomplete NDEF message");
+        }
+        ndef_parser_msg_reset(self);
+    }
+}
+
+static
+void
+ndef_parser_tlv_header_done(
+    NdefParser* self,
+    NdefParserOutput* out)
+{
+    const guint8* hdr = self->tlv_hdr;
+
+    self->tlv_type = hdr[0];
+    self->tlv_left = (self->tlv_hdr_len == 2) ? hdr[1] :
+        ((((guint)hdr[2]) << 8) | hdr[3]);
+    self->tlv_hdr_len = 0;
+    if (!self->tlv_left && self->tlv_type == TLV_NDEF_MESSAGE) {
+        static const GUtilData empty = { NULL, 0 };
+        NdefParseState limits;
+
+        /* Special case - Empty NDEF */
+        ndef_parse_state_init(&limits, &self->limits, 0);
+        ndef_parser_output_append(out, ndef_rec_new_with_state(&empty,
+            self->flags, &limits));
+    }
+}
+
+static
+void
+ndef_parser_tlv_feed(
+    NdefParser* self,
+    const guint8* ptr,
+    gsize len,
+    NdefParserOutput* out)
+{
+    while (len > 0 && self->state == NDEF_PARSER_STATE_PARSING) {
+        if (self->tlv_left) {
+            /* Inside the value */
+            const gsize n = MIN(len, self->tlv_left);
+
+            if (self->tlv_type == TLV_NDEF_MESSAGE) {
+                ndef_parser_msg_feed(self, ptr, n, out);
+            }
+            ptr += n;
+            len -= n;
+            self->tlv_left -= n;
+            if (!self->tlv_left) {
+                ndef_parser_tlv_value_done(self);
+            }
+        } else {
+            const guint8 b = *ptr++;
+
+            len--;
+            if (self->tlv_hdr_len) {
+                self->tlv_hdr[self->tlv_hdr_len++] = b;
+                if ((self->tlv_hdr_len == 2 && self->tlv_hdr[1] != 0xff) ||
+                    self->tlv_hdr_len == 4) {
+                    ndef_parser_tlv_header_done(self, out);
+                }
+            } else if (b == TLV_TERMINATOR) {
+                /* No L, no V */
+                self->state = NDEF_PARSER_STATE_DONE;
+            } else if (b != TLV_NULL) {
+                self->tlv_hdr[self->tlv_hdr_len++] = b;
+            }
+        }
+    }
+}
+
+static
+NdefParser*
+ndef_parser_create(
+    gboolean tlv,
+    NDEF_PARSE_FLAGS flags)
+{
+    NdefParser* self = g_slice_new0(NdefParser);
+
+    self->flags = flags;
+    self->tlv = tlv;
+    ndef_parse_limits_get(&self->limits);
+    ndef_parse_state_init(&self->msg_limits, &self->limits, 0);
+    self->buf = g_byte_array_new();
+    return self;
+}
+
+/*==========================================================================*
+ * Interface
+ *==========================================================================*/
+
+NdefParser*
+ndef_parser_new(
+    NDEF_PARSE_FLAGS flags) /* Since 1.1.0 */
+{
+    return ndef_parser_create(FALSE, flags);
+}
+
+NdefParser*
+ndef_parser_new_tlv(
+    NDEF_PARSE_FLAGS flags) /* Since 1.1.0 */
+{
+    return ndef_parser_create(TRUE, flags);
+}
+
+void
+ndef_parser_free(
+    NdefParser* self) /* Since 1.1.0 */
+{
+    if (G_LIKELY(self)) {
+        g_byte_array_free(self->buf, TRUE);
+        g_slice_free(NdefParser, self);
+    }
+}
+
+NdefRec*
+ndef_parser_feed(
+    NdefParser* self,
+    const GUtilData* data) /* Since 1.1.0 */
+{
+    NdefParserOutput out;
+
+    out.first = out.last = NULL;
+    if (G_LIKELY(self) && G_LIKELY(data) && data->size &&
+        self->state == NDEF_PARSER_STATE_PARSING) {
+        if (self->tlv) {
+            ndef_parser_tlv_feed(self, data->bytes, data->size, &out);
+        } else {
+            ndef_parser_msg_feed(self, data->bytes, data->size, &out);
+            switch (self->msg) {
+            case NDEF_PARSER_MSG_RECORDS:
+                break;
+            case NDEF_PARSER_MSG_END:
+                self->state = NDEF_PARSER_STATE_DONE;
+                break;
+            case NDEF_PARSER_MSG_BROKEN:
+                self->state = NDEF_PARSER_STATE_ERROR;
+                break;
+            }
+        }
+    }
+    return out.first;
+}
+
+NDEF_PARSER_STATE
+ndef_parser_state(
+    const NdefParser* self) /* Since 1.1.0 */
+{
+    return G_LIKELY(self) ? self->state : NDEF_PARSER_STATE_ERROR;
+}
+
+gsize
+ndef_parser_bytes_needed(
+    const NdefParser* self) /* Since 1.1.0 */
+{
+    if (G_LIKELY(self) && self->state == NDEF_PARSER_STATE_PARSING) {
+        if (!self->tlv) {
+            return ndef_parser_msg_bytes_needed(self);
+        } else if (self->tlv_left) {
+            if (self->tlv_type == TLV_NDEF_MESSAGE) {
+                const gsize needed = ndef_parser_msg_bytes_needed(self);
+
+                /* Zero if the rest of the value is going to be skipped */
+                return needed ? MIN(needed, self->tlv_left) :
+                    self->tlv_left;
+            }
+            return self->tlv_left;
+        } else {
+            /* One byte for T, then either one or three bytes for L */
+            return (self->tlv_hdr_len < 2) ? 1 : (4 - self->tlv_hdr_len);
+        }
+    }
+    return 0;
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
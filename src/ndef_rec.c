@@ -38,16 +38,23 @@
  */
 
 #include "ndef_rec_p.h"
+#include "ndef_stats_p.h"
 #include "ndef_tlv.h"
 #include "ndef_util_p.h"
 #include "ndef_log.h"
 
 #include <gutil_misc.h>
 
+#include <sys/uio.h>
+
 GLOG_MODULE_DEFINE("ndef");
 
 struct nfc_ndef_rec_priv {
     guint8* data;
+    GBytes* bytes;
+    gint index;   /* Position in the last NdefMsg it was added to */
+    guint depth;  /* Nesting level */
+    gint hash;    /* Cached hash, zero if not calculated yet */
 };
 
 #define THIS(obj) NDEF_REC(obj)
@@ -57,204 +64,579 @@ struct nfc_ndef_rec_priv {
 
 G_DEFINE_TYPE(NdefRec, ndef_rec, PARENT_TYPE)
 
+/*
+ * Short types are packed into 32-bit keys, so that the known types can
+ * be recognized with a single switch, without comparing the bytes one by
+ * one against each known type.
+ */
+#define NDEF_TYPE_KEY(tnf,len,c0,c1) ((((guint32)(tnf)) << 24) | \
+    (((guint32)(len)) << 16) | (((guint32)(c0)) << 8) | ((guint32)(c1)))
+#define NDEF_TYPE_KEY_WKT1(c0) NDEF_TYPE_KEY(NDEF_TNF_WELL_KNOWN,1,c0,0)
+#define NDEF_TYPE_KEY_WKT2(c0,c1) NDEF_TYPE_KEY(NDEF_TNF_WELL_KNOWN,2,c0,c1)
+
 static
 NdefRec*
-ndef_rec_alloc(
+ndef_rec_u_alloc(
     const NdefData* ndef)
 {
-    if (ndef->rec.size) {
-        const NDEF_TNF tnf = ndef->rec.bytes[0] & NDEF_HDR_TNF_MASK;
+    NdefRecU* uri_rec = ndef_rec_u_new_from_data(ndef);
 
-        /* Handle known types */
-        if (tnf == NDEF_TNF_WELL_KNOWN) {
-            GUtilData type;
+    if (uri_rec) {
+        /* URI Record (not decoded yet in lazy mode) */
+        if (uri_rec->uri) {
+            GDEBUG("URI Record: %s", uri_rec->uri);
+        }
+        return THIS(uri_rec);
+    }
+    return NULL;
+}
 
-            ndef_type(ndef, &type);
-            if (gutil_data_equal(&type, &ndef_rec_type_u)) {
-                NdefRecU* uri_rec = ndef_rec_u_new_from_data(ndef);
+static
+NdefRec*
+ndef_rec_t_alloc(
+    const NdefData* ndef)
+{
+    NdefRecT* text_rec = ndef_rec_t_new_from_data(ndef);
 
-                if (uri_rec) {
-                    /* URI Record */
-                    GDEBUG("URI Record: %s", uri_rec->uri);
-                    return THIS(uri_rec);
-                }
-            } else if (gutil_data_equal(&type, &ndef_rec_type_t)) {
-                NdefRecT* text_rec = ndef_rec_t_new_from_data(ndef);
-
-                if (text_rec) {
-                    /* TEXT Record */
-                    GVERBOSE("Locale: %s", ndef_system_locale());
-                    GVERBOSE("Language: %s", text_rec->lang);
-                    GDEBUG("Text Record: %s", text_rec->text);
-                    return THIS(text_rec);
-                }
-            } else if (gutil_data_equal(&type, &ndef_rec_type_sp)) {
-                NdefRecSp* sp_rec = ndef_rec_sp_new_from_data(ndef);
+    if (text_rec) {
+        /* TEXT Record */
+        if (text_rec->text) {
+            GVERBOSE("Locale: %s", ndef_system_locale());
+            GVERBOSE("Language: %s", text_rec->lang);
+            GDEBUG("Text Record: %s", text_rec->text);
+        }
+        return THIS(text_rec);
+    }
+    return NULL;
+}
 
-                if (sp_rec) {
-                    /* SmartPoster Record */
-                    GVERBOSE("SmartPoster URI: %s", sp_rec->uri);
-                    return THIS(sp_rec);
-                }
-            }
+static
+NdefRec*
+ndef_rec_sp_alloc(
+    const NdefData* ndef)
+{
+    NdefRecSp* sp_rec = ndef_rec_sp_new_from_data(ndef);
+
+    if (sp_rec) {
+        /* SmartPoster Record */
+        if (sp_rec->uri) {
+            GVERBOSE("SmartPoster URI: %s", sp_rec->uri);
         }
+        return THIS(sp_rec);
+    }
+    return NULL;
+}
 
-        /* Generic record */
-        return ndef_rec_initialize(g_object_new(THIS_TYPE, NULL),
-            NDEF_RTD_UNKNOWN, ndef);
+/* Indexed by NDEF_RTD */
+static const struct ndef_rec_known_type {
+    NdefRec* (*alloc)(const NdefData* ndef);
+    gsize (*storage_size)(const NdefData* ndef);
+} ndef_rec_known_types[] = {
+    { NULL, NULL },                                 /* NDEF_RTD_UNKNOWN */
+    { ndef_rec_u_alloc, ndef_rec_u_storage_size },  /* NDEF_RTD_URI */
+    { ndef_rec_t_alloc, ndef_rec_t_storage_size },  /* NDEF_RTD_TEXT */
+    { ndef_rec_sp_alloc, ndef_rec_sp_storage_size } /* NDEF_RTD_SMART_POSTER */
+};
+
+static
+NDEF_RTD
+ndef_rec_rtd(
+    const NdefData* ndef)
+{
+    const guint8 tnf = (ndef->rec.bytes[0] & NDEF_HDR_TNF_MASK);
+    const guint8* type = ndef->rec.bytes + ndef->type_offset;
+
+    switch (ndef->type_length) {
+    case 1:
+        switch (NDEF_TYPE_KEY(tnf, 1, type[0], 0)) {
+        case NDEF_TYPE_KEY_WKT1('U'):
+            return NDEF_RTD_URI;
+        case NDEF_TYPE_KEY_WKT1('T'):
+            return NDEF_RTD_TEXT;
+        }
+        break;
+    case 2:
+        switch (NDEF_TYPE_KEY(tnf, 2, type[0], type[1])) {
+        case NDEF_TYPE_KEY_WKT2('S','p'):
+            return NDEF_RTD_SMART_POSTER;
+        }
+        break;
+    }
+    return NDEF_RTD_UNKNOWN;
+}
+
+static
+NdefRec*
+ndef_rec_alloc(
+    const NdefData* ndef)
+{
+    if (ndef->rec.size) {
+        /* Types registered by the application take precedence */
+        NdefRec* rec = ndef_registry_rec_new(ndef);
+
+        if (!rec) {
+            /* Handle known types */
+            const struct ndef_rec_known_type* known =
+                ndef_rec_known_types + ndef_rec_rtd(ndef);
+
+            if (!known->alloc || !(rec = known->alloc(ndef))) {
+                /* Generic record */
+                rec = ndef_rec_initialize(g_object_new(THIS_TYPE, NULL),
+                    NDEF_RTD_UNKNOWN, ndef);
+            }
+        }
+        return rec;
     } else {
         /* Special case - Empty NDEF */
         return g_object_new(THIS_TYPE, NULL);
     }
 }
 
+/*
+ * Validates the sequence of chunks which starts with the chunk at the
+ * beginning of the block and calculates the total payload length. The
+ * block is advanced past the terminating chunk. Returns FALSE if the
+ * sequence is broken, in which case the block is left pointing at the
+ * first unexpected record (or at the end of the data).
+ */
 static
 gboolean
-ndef_rec_parse(
+ndef_rec_scan_chunks(
     GUtilData* block,
-    NdefData* ndef)
+    guint* payload_length,
+    guint8* last_hdr)
 {
-    if (block->size < 3) {
-        /* At least 3 bytes is required for anything meaningful */
-        GDEBUG("Block is too short to be an NDEF record");
-        return FALSE;
-    } else {
-        const guint8 hdr = block->bytes[0];
-        guint total_len = 1;
+    guint64 total = *payload_length;
+    NdefData chunk;
 
-        memset(ndef, 0, sizeof(*ndef));
-        ndef->type_length = block->bytes[1];
+    for (;;) {
+        GUtilData next = *block;
+        guint8 hdr;
 
-        /* Type */
-        total_len += 1 + ndef->type_length;
-        ndef->type_offset = 2;
-
-        /* Payload length */
-        if (hdr & NDEF_HDR_SR) {
-            /* Short record */
-            ndef->payload_length = block->bytes[ndef->type_offset++];
-            total_len += 1 + ndef->payload_length;
-        } else {
-            /* 4 bytes for length */
-            ndef->payload_length =
-                (((guint)block->bytes[ndef->type_offset]) << 24) |
-                (((guint)block->bytes[ndef->type_offset + 1]) << 16) |
-                (((guint)block->bytes[ndef->type_offset + 2]) << 8) |
-                ((guint)block->bytes[ndef->type_offset + 3]);
-            total_len += 4 + ndef->payload_length;
-            ndef->type_offset += 4;
+        if (!next.size || !ndef_rec_parse(&next, &chunk)) {
+            GWARN("Unterminated chunked record");
+            *block = next;
+            return FALSE;
         }
 
-        /* ID Length */
-        if (hdr & NDEF_HDR_IL) {
-            ndef->id_length = block->bytes[ndef->type_offset++];
-            total_len += 1 + ndef->id_length;
+        /*
+         * NFCForum-TS-NDEF_1.0, section 2.3.3 "Record Chunks":
+         *
+         * Middle and terminating record chunks MUST have TNF set to
+         * 0x06 (Unchanged), TYPE_LENGTH and IL set to zero.
+         */
+        hdr = chunk.rec.bytes[0];
+        if ((hdr & (NDEF_HDR_MB | NDEF_HDR_IL | NDEF_HDR_TNF_MASK)) !=
+            NDEF_TNF_UNCHANGED || chunk.type_length) {
+            GWARN("Invalid record chunk");
+            return FALSE;
         }
 
-        /* Check for overflow */
-        if (ndef->payload_length < 0x80000000 && total_len <= block->size) {
-            /* Cut the garbage if there is any */
-            ndef->rec.bytes = block->bytes;
-            ndef->rec.size = total_len;
-            block->bytes += total_len;
-            block->size -= total_len;
+        *block = next;
+        total += chunk.payload_length;
+        if (total >= 0x80000000) {
+            GWARN("Chunked record is too large");
+            return FALSE;
+        }
+        if (!(hdr & NDEF_HDR_CF)) {
+            /* Terminating chunk */
+            *payload_length = (guint)total;
+            *last_hdr = hdr;
             return TRUE;
-        } else {
-            GDEBUG("Garbage (lengths don't add up)");
         }
-        return FALSE;
     }
 }
 
+/*
+ * Reassembles a chunked record. The first chunk has already been parsed,
+ * the block points to the record following it. The layout of the logical
+ * record is calculated first, then the payload gets gathered straight
+ * into a single buffer of the exact size.
+ */
 static
 NdefRec*
-ndef_rec_new_from_data(
+ndef_rec_new_chunked(
+    GUtilData* block,
+    const NdefData* first,
+    NDEF_PARSE_FLAGS flags)
+{
+    const GUtilData start = *block;
+    const guint8 first_hdr = first->rec.bytes[0];
+    guint payload_length = first->payload_length;
+    guint8 last_hdr;
+
+    if (ndef_rec_scan_chunks(block, &payload_length, &last_hdr)) {
+        const guint8 hdr = (first_hdr & (NDEF_HDR_MB | NDEF_HDR_IL |
+            NDEF_HDR_TNF_MASK)) | (last_hdr & NDEF_HDR_ME);
+        const gsize size = ndef_rec_header_size(hdr, first->id_length,
+            payload_length) + first->type_length + first->id_length +
+            payload_length;
+        guint8* buf = g_malloc(size);
+        guint8* ptr = ndef_rec_write_header(buf, hdr, first->type_length,
+            first->id_length, payload_length);
+        GUtilData chunks = start;
+        GUtilData data;
+        GBytes* bytes;
+        NdefData ndef;
+        NdefRec* rec;
+
+        NDEF_STATS_INC(allocs);
+
+        /* Type, id and the payload of the first chunk are contiguous */
+        memcpy(ptr, first->rec.bytes + first->type_offset,
+            first->type_length + first->id_length + first->payload_length);
+        ptr += first->type_length + first->id_length + first->payload_length;
+
+        /* Payloads of the remaining chunks (already validated) */
+        while (chunks.bytes < block->bytes &&
+            ndef_rec_parse(&chunks, &ndef)) {
+            memcpy(ptr, ndef.rec.bytes + ndef.type_offset,
+                ndef.payload_length);
+            ptr += ndef.payload_length;
+        }
+        GASSERT(ptr == buf + size);
+
+        /* Parse the reassembled record */
+        bytes = g_bytes_new_take(buf, size);
+        data.bytes = buf;
+        data.size = size;
+        ndef_rec_parse(&data, &ndef);
+        GASSERT(!data.size);
+        GDEBUG("NDEF (reassembled):");
+        ndef_hexdump_data(&ndef.rec);
+        ndef.bytes = bytes;
+        ndef.state = first->state;
+        ndef.flags = flags;
+        rec = ndef_rec_alloc(&ndef);
+        g_bytes_unref(bytes);
+        NDEF_STATS_INC(chunked);
+        return rec;
+    }
+    NDEF_STATS_INC(chunked_dropped);
+    return NULL;
+}
+
+/*
+ * The record either takes ownership of the private copy of the raw data
+ * or shares the data with others (in which case data must be NULL).
+ */
+static
+void
+ndef_rec_setup(
+    NdefRec* self,
+    NDEF_RTD rtd,
+    const NdefData* ndef,
+    guint8* data)
+{
+    NdefRecPriv* priv = self->priv;
+
+    self->tnf = ndef_tnf(ndef);
+    self->flags |= ndef_flags(ndef);
+    self->rtd = rtd;
+    if (ndef->state) {
+        priv->depth = ndef->state->depth;
+    }
+    if (data) {
+        self->raw.bytes = priv->data = data;
+    } else {
+        /* Zero-copy, share the data */
+        self->raw.bytes = ndef->rec.bytes;
+        priv->bytes = g_bytes_ref(ndef->bytes);
+    }
+    self->raw.size = ndef->rec.size;
+    self->type.bytes = self->raw.bytes + ndef->type_offset;
+    self->type.size = ndef->type_length;
+    if (ndef->id_length > 0) {
+        self->id.bytes = self->type.bytes + ndef->type_length;
+        self->id.size = ndef->id_length;
+    }
+    if (ndef->payload_length) {
+        self->payload.size = ndef->payload_length;
+        self->payload.bytes = self->type.bytes + ndef->type_length +
+            ndef->id_length;
+    }
+}
+
+static
+guint8*
+ndef_rec_fill_payload(
+    guint8* ptr,
+    gconstpointer payload)
+{
+    return ndef_rec_write_data(ptr, payload);
+}
+
+static
+NdefRec*
+ndef_rec_new_filled(
     GType gtype,
     NDEF_TNF tnf,
     NDEF_RTD rtd,
     const GUtilData* type,
-    const GUtilData* payload)
+    gsize payload_length,
+    NdefRecFillFunc fill,
+    gconstpointer user_data)
 {
-    /* type and payload pointers are checked by the caller */
+    /* type pointer is checked by the caller */
     if (gtype &&
 #if GLIB_SIZEOF_SIZE_T > 4
-        payload->size <= 0xffffffff &&
+        payload_length <= 0xffffffff &&
 #endif
         type->size <= 0xff) {
+        const guint8 hdr = NDEF_HDR_MB | NDEF_HDR_ME |
+            (tnf & NDEF_HDR_TNF_MASK);
+        const gsize size = ndef_rec_header_size(hdr, 0, payload_length) +
+            type->size + payload_length;
+        guint8* buf = g_malloc(size);
+        guint8* ptr = ndef_rec_write_header(buf, hdr, type->size, 0,
+            payload_length);
         NdefData ndef;
         NdefRec* rec;
-        guint8 hdr = NDEF_HDR_MB | NDEF_HDR_ME | (tnf & NDEF_HDR_TNF_MASK);
-        const guint8 type_length = type->size;
-        const gboolean sr = (payload->size <= 0xff); /* Short Record) */
-        GByteArray* buf = g_byte_array_sized_new((sr ? 3 : 6) + type_length +
-            payload->size);
 
+        /* The record is written straight into its final location */
+        NDEF_STATS_INC(allocs);
         memset(&ndef, 0, sizeof(ndef));
-        ndef.type_length = type_length;
-        ndef.payload_length = payload->size;
+        ndef.type_offset = ptr - buf;
+        ndef.type_length = type->size;
+        ndef.payload_length = payload_length;
+        ptr = ndef_rec_write_data(ptr, type);
+        ptr = fill(ptr, user_data);
+        GASSERT(ptr == buf + size);
 
-        /* Header, TYPE LENGTH and PAYLOAD LENGTH */
-        if (sr) {
-            guint8 payload_len = (guint8)payload->size;
+        /* And handed over to the object */
+        ndef.rec.bytes = buf;
+        ndef.rec.size = size;
+        rec = g_object_new(gtype, NULL);
+        ndef_rec_setup(rec, rtd, &ndef, buf);
+        return rec;
+    } else {
+        return NULL;
+    }
+}
 
-            /*
-             * If the SR flag is set, the PAYLOAD_LENGTH field is a single
-             * octet representing an 8-bit unsigned integer.
-             */
-            hdr |= NDEF_HDR_SR;
-            g_byte_array_append(buf, &hdr, 1);
-            g_byte_array_append(buf, &type_length, 1);
-            g_byte_array_append(buf, &payload_len, 1);
-        } else {
-            guint8 payload_length[4];
+static
+NdefRec*
+ndef_rec_new_from_data(
+    GType gtype,
+    NDEF_TNF tnf,
+    NDEF_RTD rtd,
+    const GUtilData* type,
+    const GUtilData* payload)
+{
+    /* type and payload pointers are checked by the caller */
+    return ndef_rec_new_filled(gtype, tnf, rtd, type, payload->size,
+        ndef_rec_fill_payload, payload);
+}
 
-            /*
-             * If the SR flag is clear, the PAYLOAD_LENGTH field is four
-             * octets representing a 32-bit unsigned integer. Transmission
-             * order of the octets is MSB-first.
-             */
-            payload_length[0] = (guint8)(payload->size >> 24);
-            payload_length[1] = (guint8)(payload->size >> 16);
-            payload_length[2] = (guint8)(payload->size >> 8);
-            payload_length[3] = (guint8)payload->size;
-            g_byte_array_append(buf, &hdr, 1);
-            g_byte_array_append(buf, &type_length, 1);
-            g_byte_array_append(buf, payload_length, 4);
-        }
+static
+NdefRec*
+ndef_rec_new_block(
+    const GUtilData* block,
+    GBytes* bytes,
+    NdefStorage* storage,
+    NdefParseState* state,
+    NDEF_PARSE_FLAGS flags)
+{
+    NdefRec* first = NULL;
+    NdefData ndef;
 
-        /* TYPE */
-        ndef.type_offset = buf->len;
-        g_byte_array_append(buf, type->bytes, type->size);
+    memset(&ndef, 0, sizeof(ndef));
+    if (G_LIKELY(block->size)) {
+        GUtilData data = *block;
+        NdefRec* last = NULL;
 
-        /* PAYLOAD */
-        g_byte_array_append(buf, payload->bytes, payload->size);
+        while (data.size > 0 && ndef_rec_parse(&data, &ndef)) {
+            const guint8 hdr = ndef.rec.bytes[0];
+            NdefRec* rec;
 
-        /* Allocate the object */
-        ndef.rec.bytes = buf->data;
-        ndef.rec.size = buf->len;
-        rec = ndef_rec_initialize(g_object_new(gtype, NULL), rtd, &ndef);
+            GASSERT(ndef.rec.size);
+            ndef.state = state;
+            if ((hdr & NDEF_HDR_TNF_MASK) == NDEF_TNF_UNCHANGED) {
+                /* Not preceded by the first chunk */
+                GWARN("Unexpected record chunk");
+                NDEF_STATS_INC(chunked_dropped);
+                rec = NULL;
+            } else if (hdr & NDEF_HDR_CF) {
+                rec = ndef_rec_new_chunked(&data, &ndef, flags);
+            } else {
+                GDEBUG("NDEF:");
+                ndef_hexdump_data(&ndef.rec);
+                ndef.bytes = bytes;
+                ndef.storage = storage;
+                ndef.flags = flags;
+                rec = ndef_rec_alloc(&ndef);
+            }
+            if (state && state->failed) {
+                /* A limit has been exceeded somewhere deep inside */
+                ndef_rec_unref(rec);
+                ndef_rec_unref(first);
+                return NULL;
+            }
+            if (rec) {
+                NDEF_STATS_REC(rec);
+                if (last) {
+                    last->next = rec;
+                    last = rec;
+                } else {
+                    first = last = rec;
+                }
+            }
+        }
+        if (data.size > 0) {
+            NDEF_STATS_INC(garbage);
+        }
+    } else {
+        /* Special case - Empty NDEF */
+        GDEBUG("Empty NDEF");
+        first = ndef_rec_alloc(&ndef);
+        NDEF_STATS_REC(first);
+    }
+    return first;
+}
 
-        g_byte_array_free(buf, TRUE);
-        return rec;
+static
+NdefRec*
+ndef_rec_new_shared(
+    const GUtilData* block,
+    NDEF_PARSE_FLAGS flags,
+    NdefBlockAlloc* alloc,
+    NdefParseState* state,
+    gsize storage_size)
+{
+    const gsize total = block->size + storage_size;
+    guint8* buf;
+    GBytes* bytes;
+    NdefStorage storage;
+    GUtilData data;
+    NdefRec* rec;
+
+    if (alloc) {
+        bytes = alloc->alloc(alloc, total, &buf);
     } else {
+        buf = g_malloc(total);
+        NDEF_STATS_INC(allocs);
+        bytes = g_bytes_new_take(buf, total);
+    }
+    memcpy(buf, block->bytes, block->size);
+    data.bytes = buf;
+    data.size = block->size;
+    storage.ptr = buf + block->size;
+    storage.end = buf + total;
+    rec = ndef_rec_new_block(&data, bytes, &storage, state, flags);
+
+    /* The records hold their own references */
+    GASSERT(storage.ptr <= storage.end);
+    g_bytes_unref(bytes);
+    return rec;
+}
+
+static
+NdefRec*
+ndef_rec_new_message_with_state(
+    const GUtilData* block,
+    GBytes* bytes,
+    NDEF_PARSE_FLAGS flags,
+    NdefBlockAlloc* alloc,
+    NdefParseState* state)
+{
+    const gboolean shared = !bytes && block->size &&
+        (flags & NDEF_PARSE_FLAG_SHARED_STORAGE);
+    gsize storage_size = 0;
+
+    NDEF_STATS_ADD(bytes, block->size);
+    if (!ndef_parse_state_check(state, block)) {
+        return NULL;
+    }
+
+    /*
+     * Lazily decoded strings are allocated later and separately,
+     * otherwise the space they need is estimated upfront, for the
+     * shared storage and for the allocation limit.
+     */
+    if (!(flags & NDEF_PARSE_FLAG_LAZY) && (shared ||
+        state->limits.max_alloc)) {
+        storage_size = ndef_storage_size(block, state);
+    }
+    if (!ndef_parse_state_alloc(state, (bytes ? 0 : block->size) +
+        storage_size)) {
         return NULL;
     }
+
+    if (shared) {
+        /* Raw data followed by the decoded strings, all in one block */
+        return ndef_rec_new_shared(block, flags, alloc, state,
+            storage_size);
+    } else {
+        return ndef_rec_new_block(block, bytes, NULL, state, flags);
+    }
 }
 
 static
-guint8
-ndef_rec_map_flags(
-    NDEF_REC_FLAGS flags)
+NdefRec*
+ndef_rec_new_message(
+    const GUtilData* block,
+    GBytes* bytes,
+    NDEF_PARSE_FLAGS flags,
+    NdefBlockAlloc* alloc)
 {
-    guint8 ndef_flags = 0;
+    NdefParseState state;
+
+    ndef_parse_state_init(&state, NULL, 0);
+    return ndef_rec_new_message_with_state(block, bytes, flags, alloc,
+        &state);
+}
 
-    if (flags & NDEF_REC_FLAG_FIRST) {
-        ndef_flags |= NDEF_HDR_MB;
+static
+NdefRec*
+ndef_rec_new_tlv_block(
+    const GUtilData* tlv,
+    GBytes* bytes,
+    NDEF_PARSE_FLAGS flags,
+    NdefBlockAlloc* alloc)
+{
+    GUtilData buf = *tlv, value;
+    NdefRec* first = NULL;
+    NdefRec* last = NULL;
+    guint type;
+
+    while ((type = ndef_tlv_next(&buf, &value)) > 0) {
+        if (type == TLV_NDEF_MESSAGE) {
+            NdefRec* rec = ndef_rec_new_message(&value, bytes, flags,
+                alloc);
+
+            if (rec) {
+                if (last) {
+                    last->next = rec;
+                } else {
+                    first = rec;
+                }
+                /* ndef_rec_new_message() can return a chain */
+                last = rec;
+                while (last->next) {
+                    last = last->next;
+                }
+            }
+        }
     }
-    if (flags & NDEF_REC_FLAG_LAST) {
-        ndef_flags |= NDEF_HDR_ME;
+    return first;
+}
+
+static
+guint
+ndef_rec_calc_hash(
+    const NdefRec* rec)
+{
+    const GUtilData* raw = &rec->raw;
+    guint32 h = 0;
+
+    if (raw->size) {
+        /* MB and ME flags don't count, the rest of the header does */
+        h = ndef_hash(raw->bytes + 1, raw->size - 1, raw->bytes[0] &
+            ~(NDEF_HDR_MB | NDEF_HDR_ME));
     }
-    return ndef_flags;
+
+    /* Zero means that the hash hasn't been calculated */
+    return h ? h : 1;
 }
 
 /* See RFC 2045, section 5.1 "Syntax of the Content-Type Header Field" */
@@ -279,6 +661,35 @@ ndef_is_token_char(
     return FALSE;
 }
 
+typedef struct ndef_rec_iov {
+    struct iovec* iov;
+    guint max_count;
+    guint count;
+    const guint8* end;          /* End of the last entry */
+} NdefRecIov;
+
+static
+void
+ndef_rec_iov_add(
+    NdefRecIov* out,
+    const guint8* base,
+    gsize len)
+{
+    if (out->count && out->end == base) {
+        /* Adjacent to the previous entry */
+        if (out->count <= out->max_count) {
+            out->iov[out->count - 1].iov_len += len;
+        }
+    } else {
+        if (out->count < out->max_count) {
+            out->iov[out->count].iov_base = (void*)base;
+            out->iov[out->count].iov_len = len;
+        }
+        out->count++;
+    }
+    out->end = base + len;
+}
+
 /*==========================================================================*
  * Interface
  *==========================================================================*/
@@ -287,75 +698,58 @@ NdefRec*
 ndef_rec_new(
     const GUtilData* block)
 {
-    NdefRec* first = NULL;
+    return ndef_rec_new_full(block, NDEF_PARSE_FLAGS_NONE);
+}
 
-    if (G_LIKELY(block)) {
-        NdefData ndef;
+NdefRec*
+ndef_rec_new_full(
+    const GUtilData* block,
+    NDEF_PARSE_FLAGS flags) /* Since 1.1.0 */
+{
+    return G_LIKELY(block) ? ndef_rec_new_message(block, NULL, flags, NULL) :
+        NULL;
+}
 
-        memset(&ndef, 0, sizeof(ndef));
-        if (G_LIKELY(block->size)) {
-            GUtilData data = *block;
-            NdefRec* last = NULL;
-
-            while (data.size > 0 && ndef_rec_parse(&data, &ndef)) {
-                GASSERT(ndef.rec.size);
-                if (ndef.rec.bytes[0] & NDEF_HDR_CF) {
-                    /* Who needs those anyway? */
-                    GWARN("Chunked records are not supported");
-                } else {
-                    NdefRec* rec;
-
-                    GDEBUG("NDEF:");
-                    ndef_hexdump_data(&ndef.rec);
-                    rec = ndef_rec_alloc(&ndef);
-                    if (last) {
-                        last->next = rec;
-                        last = rec;
-                    } else {
-                        first = last = rec;
-                    }
-                }
-            }
-        } else {
-            /* Special case - Empty NDEF */
-            GDEBUG("Empty NDEF");
-            first = ndef_rec_alloc(&ndef);
-        }
+NdefRec*
+ndef_rec_new_bytes(
+    GBytes* bytes) /* Since 1.1.0 */
+{
+    if (G_LIKELY(bytes)) {
+        GUtilData block;
+
+        return ndef_rec_new_message(gutil_data_from_bytes(&block, bytes),
+            bytes, NDEF_PARSE_FLAGS_NONE, NULL);
     }
-    return first;
+    return NULL;
 }
 
 NdefRec*
 ndef_rec_new_from_tlv(
     const GUtilData* tlv)
 {
-    NdefRec* first = NULL;
+    return ndef_rec_new_from_tlv_full(tlv, NDEF_PARSE_FLAGS_NONE);
+}
 
-    if (G_LIKELY(tlv)) {
-        GUtilData buf = *tlv, value;
-        NdefRec* last = NULL;
-        guint type;
-
-        while ((type = ndef_tlv_next(&buf, &value)) > 0) {
-            if (type == TLV_NDEF_MESSAGE) {
-                NdefRec* rec = ndef_rec_new(&value);
-
-                if (rec) {
-                    if (last) {
-                        last->next = rec;
-                    } else {
-                        first = rec;
-                    }
-                    /* ndef_rec_new() can return a chain */
-                    last = rec;
-                    while (last->next) {
-                        last = last->next;
-                    }
-                }
-            }
-        }
+NdefRec*
+ndef_rec_new_from_tlv_full(
+    const GUtilData* tlv,
+    NDEF_PARSE_FLAGS flags) /* Since 1.1.0 */
+{
+    return G_LIKELY(tlv) ? ndef_rec_new_tlv_block(tlv, NULL, flags, NULL) :
+        NULL;
+}
+
+NdefRec*
+ndef_rec_new_from_tlv_bytes(
+    GBytes* tlv) /* Since 1.1.0 */
+{
+    if (G_LIKELY(tlv)) {
+        GUtilData block;
+
+        return ndef_rec_new_tlv_block(gutil_data_from_bytes(&block, tlv), tlv,
+            NDEF_PARSE_FLAGS_NONE, NULL);
     }
-    return first;
+    return NULL;
 }
 
 NdefRec*
@@ -391,6 +785,138 @@ ndef_rec_unref(
     }
 }
 
+guint
+ndef_rec_hash(
+    gconstpointer rec) /* Since 1.1.0 */
+{
+    if (G_LIKELY(rec)) {
+        const NdefRec* self = rec;
+        NdefRecPriv* priv = self->priv;
+        guint h = (guint)g_atomic_int_get(&priv->hash);
+
+        if (!h) {
+            /* Harmless if two threads end up doing this simultaneously */
+            h = ndef_rec_calc_hash(self);
+            g_atomic_int_set(&priv->hash, (gint)h);
+        }
+        return h;
+    }
+    return 0;
+}
+
+gboolean
+ndef_rec_equal(
+    gconstpointer a,
+    gconstpointer b) /* Since 1.1.0 */
+{
+    if (a == b) {
+        return TRUE;
+    } else if (a && b) {
+        const NdefRec* r1 = a;
+        const NdefRec* r2 = b;
+
+        if (r1->raw.size == r2->raw.size &&
+            ndef_rec_hash(r1) == ndef_rec_hash(r2)) {
+            const gsize size = r1->raw.size;
+
+            return !size || (!((r1->raw.bytes[0] ^ r2->raw.bytes[0]) &
+                ~(NDEF_HDR_MB | NDEF_HDR_ME)) && !memcmp(r1->raw.bytes + 1,
+                r2->raw.bytes + 1, size - 1));
+        }
+    }
+    return FALSE;
+}
+
+guint
+ndef_rec_chain_hash(
+    gconstpointer rec) /* Since 1.1.0 */
+{
+    const NdefRec* ptr;
+    guint h = 0;
+
+    for (ptr = rec; ptr; ptr = ptr->next) {
+        h = h * 31 + ndef_rec_hash(ptr);
+    }
+    return h;
+}
+
+gboolean
+ndef_rec_chain_equal(
+    gconstpointer a,
+    gconstpointer b) /* Since 1.1.0 */
+{
+    const NdefRec* r1 = a;
+    const NdefRec* r2 = b;
+
+    while (r1 && r2) {
+        if (r1 == r2) {
+            /* The rest of the chain is shared */
+            return TRUE;
+        } else if (!ndef_rec_equal(r1, r2)) {
+            return FALSE;
+        }
+        r1 = r1->next;
+        r2 = r2->next;
+    }
+    return !r1 && !r2;
+}
+
+guint
+ndef_rec_chain_iov(
+    NdefRec* first,
+    struct iovec* iov,
+    guint max_count) /* Since 1.1.0 */
+{
+    /* Every possible header byte, to point the patched headers to */
+#define B4(n) (n), (n) + 1, (n) + 2, (n) + 3
+#define B16(n) B4(n), B4((n) + 4), B4((n) + 8), B4((n) + 12)
+#define B64(n) B16(n), B16((n) + 16), B16((n) + 32), B16((n) + 48)
+    static const guint8 hdr_bytes[256] = {
+        B64(0), B64(64), B64(128), B64(192)
+    };
+#undef B64
+#undef B16
+#undef B4
+    NdefRecIov out;
+    NdefRec* rec;
+
+    memset(&out, 0, sizeof(out));
+    if (iov) {
+        out.iov = iov;
+        out.max_count = max_count;
+    }
+    for (rec = first; rec; rec = rec->next) {
+        const GUtilData* raw = &rec->raw;
+
+        if (raw->size) {
+            const guint8 hdr = raw->bytes[0];
+            const guint8 fixed = (hdr & ~(NDEF_HDR_MB | NDEF_HDR_ME)) |
+                ((rec == first) ? NDEF_HDR_MB : 0) |
+                (rec->next ? 0 : NDEF_HDR_ME);
+
+            if (hdr == fixed) {
+                ndef_rec_iov_add(&out, raw->bytes, raw->size);
+            } else {
+                ndef_rec_iov_add(&out, hdr_bytes + fixed, 1);
+                ndef_rec_iov_add(&out, raw->bytes + 1, raw->size - 1);
+            }
+        }
+    }
+    return out.count;
+}
+
+gsize
+ndef_rec_chain_size(
+    NdefRec* rec) /* Since 1.1.0 */
+{
+    gsize size = 0;
+
+    for (; rec; rec = rec->next) {
+        size += rec->raw.size;
+    }
+    return size;
+}
+
 gboolean
 ndef_valid_mediatype(
     const GUtilData* type,
@@ -444,6 +970,173 @@ ndef_valid_mediatype_str(
  * Internal interface
  *==========================================================================*/
 
+gboolean
+ndef_rec_parse(
+    GUtilData* block,
+    NdefData* ndef)
+{
+    if (block->size < 3) {
+        /* At least 3 bytes is required for anything meaningful */
+        GDEBUG("Block is too short to be an NDEF record");
+        return FALSE;
+    } else {
+        const guint8 hdr = block->bytes[0];
+        guint total_len = 1;
+
+        if (block->size < (((hdr & NDEF_HDR_SR) ? 3 : 6) +
+            ((hdr & NDEF_HDR_IL) ? 1 : 0))) {
+            GDEBUG("Truncated NDEF record header");
+            return FALSE;
+        }
+
+        memset(ndef, 0, sizeof(*ndef));
+        ndef->type_length = block->bytes[1];
+
+        /* Type */
+        total_len += 1 + ndef->type_length;
+        ndef->type_offset = 2;
+
+        /* Payload length */
+        if (hdr & NDEF_HDR_SR) {
+            /* Short record */
+            ndef->payload_length = block->bytes[ndef->type_offset++];
+            total_len += 1 + ndef->payload_length;
+        } else {
+            /* 4 bytes for length */
+            ndef->payload_length =
+                (((guint)block->bytes[ndef->type_offset]) << 24) |
+                (((guint)block->bytes[ndef->type_offset + 1]) << 16) |
+                (((guint)block->bytes[ndef->type_offset + 2]) << 8) |
+                ((guint)block->bytes[ndef->type_offset + 3]);
+            total_len += 4 + ndef->payload_length;
+            ndef->type_offset += 4;
+        }
+
+        /* ID Length */
+        if (hdr & NDEF_HDR_IL) {
+            ndef->id_length = block->bytes[ndef->type_offset++];
+            total_len += 1 + ndef->id_length;
+        }
+
+        /* Check for overflow */
+        if (ndef->payload_length < 0x80000000 && total_len <= block->size) {
+            /* Cut the garbage if there is any */
+            ndef->rec.bytes = block->bytes;
+            ndef->rec.size = total_len;
+            block->bytes += total_len;
+            block->size -= total_len;
+            return TRUE;
+        } else {
+            GDEBUG("Garbage (lengths don't add up)");
+        }
+        return FALSE;
+    }
+}
+
+/*
+ * Size of the record header (everything up to the TYPE field) and the
+ * header itself. SR flag is set if the payload is short enough, IL flag
+ * if the record has an ID (or if it's set by the caller).
+ */
+gsize
+ndef_rec_header_size(
+    guint8 hdr,
+    guint id_length,
+    guint payload_length)
+{
+    return ((payload_length <= 0xff) ? 3 : 6) +
+        (((hdr & NDEF_HDR_IL) || id_length) ? 1 : 0);
+}
+
+guint8*
+ndef_rec_write_header(
+    guint8* ptr,
+    guint8 hdr,
+    guint type_length,
+    guint id_length,
+    guint payload_length)
+{
+    hdr &= ~(NDEF_HDR_SR | NDEF_HDR_CF);
+    if (id_length) {
+        hdr |= NDEF_HDR_IL;
+    }
+    if (payload_length <= 0xff) {
+        /*
+         * If the SR flag is set, the PAYLOAD_LENGTH field is a single
+         * octet representing an 8-bit unsigned integer.
+         */
+        *ptr++ = hdr | NDEF_HDR_SR;
+        *ptr++ = (guint8)type_length;
+        *ptr++ = (guint8)payload_length;
+    } else {
+        /*
+         * If the SR flag is clear, the PAYLOAD_LENGTH field is four
+         * octets representing a 32-bit unsigned integer. Transmission
+         * order of the octets is MSB-first.
+         */
+        *ptr++ = hdr;
+        *ptr++ = (guint8)type_length;
+        *ptr++ = (guint8)(payload_length >> 24);
+        *ptr++ = (guint8)(payload_length >> 16);
+        *ptr++ = (guint8)(payload_length >> 8);
+        *ptr++ = (guint8)payload_length;
+    }
+    if (hdr & NDEF_HDR_IL) {
+        *ptr++ = (guint8)id_length;
+    }
+    return ptr;
+}
+
+guint8*
+ndef_rec_write_data(
+    guint8* ptr,
+    const GUtilData* data)
+{
+    if (data->size) {
+        memcpy(ptr, data->bytes, data->size);
+        ptr += data->size;
+    }
+    return ptr;
+}
+
+NDEF_TNF
+ndef_tnf(
+    const NdefData* ndef)
+{
+    const guint8 tnf = (ndef->rec.bytes[0] & NDEF_HDR_TNF_MASK);
+
+    return (tnf <= NDEF_TNF_MAX) ? (NDEF_TNF)tnf : NDEF_TNF_EMPTY;
+}
+
+/*
+ * TNF bits to write when re-encoding the record. Unlike rec->tnf, this
+ * preserves the TNF values which don't have NDEF_TNF counterparts
+ * (Unknown, Unchanged and Reserved).
+ */
+guint8
+ndef_rec_tnf_bits(
+    const NdefRec* rec)
+{
+    return rec->raw.size ? (rec->raw.bytes[0] & NDEF_HDR_TNF_MASK) :
+        (guint8)rec->tnf;
+}
+
+NDEF_REC_FLAGS
+ndef_flags(
+    const NdefData* ndef)
+{
+    const guint8 hdr = ndef->rec.bytes[0];
+    NDEF_REC_FLAGS flags = NDEF_REC_FLAGS_NONE;
+
+    if (hdr & NDEF_HDR_MB) {
+        flags |= NDEF_REC_FLAG_FIRST;
+    }
+    if (hdr & NDEF_HDR_ME) {
+        flags |= NDEF_REC_FLAG_LAST;
+    }
+    return flags;
+}
+
 gboolean
 ndef_type(
     const NdefData* ndef,
@@ -477,6 +1170,206 @@ ndef_payload(
     }
 }
 
+/*
+ * Upper estimate of how much space the records of the message need for
+ * their decoded data (URI, text etc.)
+ */
+gsize
+ndef_storage_size(
+    const GUtilData* block,
+    NdefParseState* state)
+{
+    GUtilData data = *block;
+    NdefData ndef;
+    gsize size = 0;
+
+    while (data.size > 0 && ndef_rec_parse(&data, &ndef)) {
+        if (!(ndef.rec.bytes[0] & NDEF_HDR_CF)) {
+            const struct ndef_rec_known_type* known =
+                ndef_rec_known_types + ndef_rec_rtd(&ndef);
+
+            ndef.state = state;
+            if (known->storage_size) {
+                size += known->storage_size(&ndef);
+            }
+        }
+    }
+    return size;
+}
+
+/*
+ * Allocates the memory from the shared storage if there's one and there's
+ * enough room left in it, otherwise from the heap. Either way, it has to
+ * be deallocated with ndef_rec_free_data()
+ */
+gpointer
+ndef_data_alloc(
+    const NdefData* ndef,
+    gsize size)
+{
+    NdefStorage* storage = ndef ? ndef->storage : NULL;
+
+    if (storage && size <= (gsize)(storage->end - storage->ptr)) {
+        gpointer ptr = storage->ptr;
+
+        storage->ptr += size;
+        return ptr;
+    }
+    NDEF_STATS_INC(allocs);
+    return g_malloc(size);
+}
+
+char*
+ndef_data_strndup(
+    const NdefData* ndef,
+    const char* str,
+    gsize len)
+{
+    char* copy = ndef_data_alloc(ndef, len + 1);
+
+    memcpy(copy, str, len);
+    copy[len] = 0;
+    return copy;
+}
+
+/*
+ * Moves heap allocated string to the shared storage if there's one.
+ * Otherwise returns the same string.
+ */
+char*
+ndef_data_move_string(
+    const NdefData* ndef,
+    char* str,
+    gsize len)
+{
+    if (ndef && ndef->storage) {
+        char* copy = ndef_data_strndup(ndef, str, len);
+
+        g_free(str);
+        return copy;
+    }
+    return str;
+}
+
+/*
+ * These two always use the shared storage, allocated by NdefBlockAlloc.
+ */
+NdefRec*
+ndef_rec_new_with_alloc(
+    const GUtilData* block,
+    NDEF_PARSE_FLAGS flags,
+    NdefBlockAlloc* alloc)
+{
+    return ndef_rec_new_message(block, NULL, flags |
+        NDEF_PARSE_FLAG_SHARED_STORAGE, alloc);
+}
+
+NdefRec*
+ndef_rec_new_from_tlv_with_alloc(
+    const GUtilData* tlv,
+    NDEF_PARSE_FLAGS flags,
+    NdefBlockAlloc* alloc)
+{
+    return ndef_rec_new_tlv_block(tlv, NULL, flags |
+        NDEF_PARSE_FLAG_SHARED_STORAGE, alloc);
+}
+
+/*
+ * Parses a part of the message. The limits and the accounting are carried
+ * over from the previous parts of the same message.
+ */
+NdefRec*
+ndef_rec_new_with_state(
+    const GUtilData* block,
+    NDEF_PARSE_FLAGS flags,
+    NdefParseState* state)
+{
+    return ndef_rec_new_message_with_state(block, NULL, flags, NULL, state);
+}
+
+/*
+ * Parses the payload of the record as an NDEF message. The resulting
+ * records borrow the data from the parent, they don't copy it.
+ */
+NdefRec*
+ndef_rec_new_nested(
+    NdefRec* self,
+    const NdefData* ndef)
+{
+    NdefRecPriv* priv = self->priv;
+    const GUtilData* payload = &self->payload;
+    NdefParseState* state = ndef ? ndef->state : NULL;
+    NdefParseState lazy;
+    NdefRec* rec = NULL;
+
+    if (!state) {
+        /* Decoding on demand, the message has already been parsed */
+        ndef_parse_state_init(&lazy, NULL, priv->depth);
+        state = &lazy;
+    }
+
+    if (ndef_parse_state_enter(state)) {
+        if (ndef_parse_state_check(state, payload)) {
+            GBytes* bytes = priv->bytes ? g_bytes_ref(priv->bytes) :
+                g_bytes_new_static(payload->bytes, payload->size);
+
+            rec = ndef_rec_new_block(payload, bytes, ndef ? ndef->storage :
+                NULL, state, NDEF_PARSE_FLAGS_NONE);
+
+            /*
+             * If the parent doesn't hold a reference to GBytes, the
+             * static one only stays valid for as long as the parent is
+             * alive. That's fine because the nested records are only
+             * used during the lifetime of their parent.
+             */
+            g_bytes_unref(bytes);
+        }
+        ndef_parse_state_leave(state);
+    }
+    return rec;
+}
+
+/* Frees the data unless it belongs to the storage shared by the records */
+void
+ndef_rec_free_data(
+    NdefRec* self,
+    gpointer data)
+{
+    if (data) {
+        NdefRecPriv* priv = self->priv;
+
+        if (priv->bytes) {
+            gsize size;
+            const guint8* ptr = g_bytes_get_data(priv->bytes, &size);
+
+            if ((const guint8*)data >= ptr &&
+                (const guint8*)data < (ptr + size)) {
+                return;
+            }
+        }
+        g_free(data);
+    }
+}
+
+/*
+ * Position hint for ndef_msg_index_of(). The record may be shared by
+ * messages living on different threads, hence the atomic access.
+ */
+void
+ndef_rec_set_index(
+    NdefRec* self,
+    guint index)
+{
+    g_atomic_int_set(&self->priv->index, (gint)index);
+}
+
+guint
+ndef_rec_index(
+    const NdefRec* self)
+{
+    return (guint)g_atomic_int_get(&self->priv->index);
+}
+
 NdefRec*
 ndef_rec_new_well_known(
     GType gtype,
@@ -488,6 +1381,24 @@ ndef_rec_new_well_known(
         payload);
 }
 
+/*
+ * Allocates the buffer for the record with the given payload length,
+ * fills in the header and the type and invokes the fill function to
+ * write the payload directly into the record's own storage.
+ */
+NdefRec*
+ndef_rec_new_well_known_filled(
+    GType gtype,
+    NDEF_RTD rtd,
+    const GUtilData* type,
+    gsize payload_length,
+    NdefRecFillFunc fill,
+    gconstpointer user_data)
+{
+    return ndef_rec_new_filled(gtype, NDEF_TNF_WELL_KNOWN, rtd, type,
+        payload_length, fill, user_data);
+}
+
 NdefRec*
 ndef_rec_initialize(
     NdefRec* self,
@@ -495,47 +1406,17 @@ ndef_rec_initialize(
     const NdefData* ndef)
 {
     if (self && ndef) {
-        NdefRecPriv* priv = self->priv;
-        const GUtilData* rec = &ndef->rec;
-        const guint hdr = rec->bytes[0];
-        const guint8 tnf = (hdr & NDEF_HDR_TNF_MASK);
+        guint8* data = NULL;
 
-        if (tnf < NDEF_TNF_MAX) {
-            self->tnf = tnf;
-        }
-        if (hdr & NDEF_HDR_MB) {
-            self->flags |= NDEF_REC_FLAG_FIRST;
-        }
-        if (hdr & NDEF_HDR_ME) {
-            self->flags |= NDEF_REC_FLAG_LAST;
-        }
-        self->rtd = rtd;
-        self->raw.bytes = priv->data = gutil_memdup(rec->bytes, rec->size);
-        self->raw.size = rec->size;
-        self->type.bytes = self->raw.bytes + ndef->type_offset;
-        self->type.size = ndef->type_length;
-        if (ndef->id_length > 0) {
-            self->id.bytes = self->type.bytes + ndef->type_length;
-            self->id.size = ndef->id_length;
-        }
-        if (ndef->payload_length) {
-            self->payload.size = ndef->payload_length;
-            self->payload.bytes = self->type.bytes + ndef->type_length +
-                ndef->id_length;
+        if (!ndef->bytes) {
+            data = gutil_memdup(ndef->rec.bytes, ndef->rec.size);
+            NDEF_STATS_INC(allocs);
         }
+        ndef_rec_setup(self, rtd, ndef, data);
     }
     return self;
 }
 
-void
-ndef_rec_clear_flags(
-    NdefRec* self,
-    NDEF_REC_FLAGS flags)
-{
-    self->flags &= ~flags;
-    self->priv->data[0] &= ~ndef_rec_map_flags(flags);
-}
-
 /*==========================================================================*
  * Internals
  *==========================================================================*/
@@ -546,6 +1427,7 @@ ndef_rec_init(
     NdefRec* self)
 {
     self->priv = G_TYPE_INSTANCE_GET_PRIVATE(self, THIS_TYPE, NdefRecPriv);
+    NDEF_STATS_INC(allocs);
 }
 
 static
@@ -555,9 +1437,34 @@ ndef_rec_finalize(
 {
     NdefRec* self = THIS(object);
     NdefRecPriv* priv = self->priv;
+    NdefRec* next = self->next;
 
     g_free(priv->data);
-    ndef_rec_unref(self->next);
+    if (priv->bytes) {
+        g_bytes_unref(priv->bytes);
+    }
+
+    /*
+     * Release the rest of the chain iteratively rather than recursively,
+     * otherwise a message with many records could exhaust the stack.
+     * As long as we hold the last reference to the next record, nobody
+     * else can access it, and it's safe to detach the tail before
+     * dropping that reference.
+     */
+    self->next = NULL;
+    while (next) {
+        NdefRec* rec = next;
+        GObject* obj = G_OBJECT(rec);
+
+        if (g_atomic_int_get((volatile gint*)&obj->ref_count) == 1) {
+            next = rec->next;
+            rec->next = NULL;
+        } else {
+            /* Someone else is holding a reference, they own the tail */
+            next = NULL;
+        }
+        ndef_rec_unref(rec);
+    }
     G_OBJECT_CLASS(PARENT_CLASS)->finalize(object);
 }
 
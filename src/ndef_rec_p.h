@@ -43,10 +43,28 @@
 
 #include "ndef_types.h"
 #include "ndef_rec.h"
+#include "ndef_tlv.h"
 
-typedef struct ndef_rec_class {
-    GObjectClass parent;
-} NdefRecClass;
+/* Free space at the end of the shared message block */
+typedef struct ndef_storage {
+    guint8* ptr;
+    guint8* end;
+} NdefStorage;
+
+/* Allocates shared message blocks */
+typedef struct ndef_block_alloc NdefBlockAlloc;
+struct ndef_block_alloc {
+    GBytes* (*alloc)(NdefBlockAlloc* alloc, gsize size, guint8** data);
+};
+
+/* Limits and accounting of a single NDEF message */
+typedef struct ndef_parse_state {
+    NdefParseLimits limits;
+    gsize alloc;        /* Estimated amount of data allocated */
+    guint records;      /* Number of records seen so far */
+    guint depth;        /* Current nesting level */
+    gboolean failed;    /* A limit has been exceeded */
+} NdefParseState;
 
 /* Pre-parsed NDEF record */
 typedef struct ndef_data {
@@ -55,6 +73,10 @@ typedef struct ndef_data {
     guint type_length;
     guint id_length;
     guint payload_length;
+    GBytes* bytes; /* Optional, rec points inside and gets shared */
+    NdefStorage* storage; /* Optional, for the decoded data */
+    NdefParseState* state; /* Optional, limits and accounting */
+    NDEF_PARSE_FLAGS flags;
 } NdefData;
 
 #define NDEF_HDR_MB       (0x80)
@@ -64,10 +86,75 @@ typedef struct ndef_data {
 #define NDEF_HDR_IL       (0x08)
 #define NDEF_HDR_TNF_MASK (0x07)
 
+/* Middle and terminating record chunks */
+#define NDEF_TNF_UNCHANGED (0x06)
+
 extern const GUtilData ndef_rec_type_u G_GNUC_INTERNAL; /* "U" */
 extern const GUtilData ndef_rec_type_t G_GNUC_INTERNAL; /* "T" */
 extern const GUtilData ndef_rec_type_sp G_GNUC_INTERNAL; /* "Sp" */
 
+gboolean
+ndef_rec_parse(
+    GUtilData* block,
+    NdefData* ndef)
+    G_GNUC_INTERNAL;
+
+gsize
+ndef_rec_header_size(
+    guint8 hdr,
+    guint id_length,
+    guint payload_length)
+    G_GNUC_INTERNAL;
+
+guint8*
+ndef_rec_write_header(
+    guint8* ptr,
+    guint8 hdr,
+    guint type_length,
+    guint id_length,
+    guint payload_length)
+    G_GNUC_INTERNAL;
+
+guint8*
+ndef_rec_write_data(
+    guint8* ptr,
+    const GUtilData* data)
+    G_GNUC_INTERNAL;
+
+gsize
+ndef_tlv_size(
+    gsize msg_size,
+    const NdefTlvParams* params)
+    G_GNUC_INTERNAL;
+
+guint8*
+ndef_tlv_write_head(
+    guint8* ptr,
+    gsize msg_size,
+    const NdefTlvParams* params)
+    G_GNUC_INTERNAL;
+
+void
+ndef_tlv_write_tail(
+    guint8* ptr,
+    guint8* end)
+    G_GNUC_INTERNAL;
+
+NDEF_TNF
+ndef_tnf(
+    const NdefData* ndef)
+    G_GNUC_INTERNAL;
+
+guint8
+ndef_rec_tnf_bits(
+    const NdefRec* rec)
+    G_GNUC_INTERNAL;
+
+NDEF_REC_FLAGS
+ndef_flags(
+    const NdefData* ndef)
+    G_GNUC_INTERNAL;
+
 gboolean
 ndef_type(
     const NdefData* data,
@@ -80,17 +167,115 @@ ndef_payload(
     GUtilData* payload)
     G_GNUC_INTERNAL;
 
+gsize
+ndef_storage_size(
+    const GUtilData* block,
+    NdefParseState* state)
+    G_GNUC_INTERNAL;
+
+void
+ndef_parse_state_init(
+    NdefParseState* state,
+    const NdefParseLimits* limits,
+    guint depth)
+    G_GNUC_INTERNAL;
+
+gboolean
+ndef_parse_state_check(
+    NdefParseState* state,
+    const GUtilData* block)
+    G_GNUC_INTERNAL;
+
+gboolean
+ndef_parse_state_alloc(
+    NdefParseState* state,
+    gsize size)
+    G_GNUC_INTERNAL;
+
+gboolean
+ndef_parse_state_enter(
+    NdefParseState* state)
+    G_GNUC_INTERNAL;
+
+void
+ndef_parse_state_leave(
+    NdefParseState* state)
+    G_GNUC_INTERNAL;
+
+gpointer
+ndef_data_alloc(
+    const NdefData* ndef,
+    gsize size)
+    G_GNUC_INTERNAL;
+
+char*
+ndef_data_strndup(
+    const NdefData* ndef,
+    const char* str,
+    gsize len)
+    G_GNUC_INTERNAL;
+
+char*
+ndef_data_move_string(
+    const NdefData* ndef,
+    char* str,
+    gsize len)
+    G_GNUC_INTERNAL;
+
 NdefRec*
-ndef_rec_initialize(
+ndef_rec_new_with_alloc(
+    const GUtilData* block,
+    NDEF_PARSE_FLAGS flags,
+    NdefBlockAlloc* alloc)
+    G_GNUC_INTERNAL;
+
+NdefRec*
+ndef_rec_new_from_tlv_with_alloc(
+    const GUtilData* tlv,
+    NDEF_PARSE_FLAGS flags,
+    NdefBlockAlloc* alloc)
+    G_GNUC_INTERNAL;
+
+NdefRec*
+ndef_rec_new_with_state(
+    const GUtilData* block,
+    NDEF_PARSE_FLAGS flags,
+    NdefParseState* state)
+    G_GNUC_INTERNAL;
+
+NdefRec*
+ndef_registry_rec_new(
+    const NdefData* ndef)
+    G_GNUC_INTERNAL;
+
+NdefRec*
+ndef_rec_new_nested(
     NdefRec* rec,
-    NDEF_RTD rtd,
     const NdefData* ndef)
     G_GNUC_INTERNAL;
 
 void
-ndef_rec_clear_flags(
+ndef_rec_free_data(
     NdefRec* rec,
-    NDEF_REC_FLAGS flags)
+    gpointer data)
+    G_GNUC_INTERNAL;
+
+void
+ndef_rec_set_index(
+    NdefRec* rec,
+    guint index)
+    G_GNUC_INTERNAL;
+
+guint
+ndef_rec_index(
+    const NdefRec* rec)
+    G_GNUC_INTERNAL;
+
+NdefRec*
+ndef_rec_initialize(
+    NdefRec* rec,
+    NDEF_RTD rtd,
+    const NdefData* ndef)
     G_GNUC_INTERNAL;
 
 NdefRec*
@@ -101,11 +286,42 @@ ndef_rec_new_well_known(
     const GUtilData* payload)
     G_GNUC_INTERNAL;
 
+/* Writes the payload, returns the pointer past the end of it */
+typedef guint8* (*NdefRecFillFunc)(
+    guint8* ptr,
+    gconstpointer user_data);
+
+NdefRec*
+ndef_rec_new_well_known_filled(
+    GType gtype,
+    NDEF_RTD rtd,
+    const GUtilData* type,
+    gsize payload_length,
+    NdefRecFillFunc fill,
+    gconstpointer user_data)
+    G_GNUC_INTERNAL;
+
 NdefRecU*
 ndef_rec_u_new_from_data(
     const NdefData* ndef)
     G_GNUC_INTERNAL;
 
+gsize
+ndef_rec_u_storage_size(
+    const NdefData* ndef)
+    G_GNUC_INTERNAL;
+
+guint8
+ndef_rec_u_abbreviate(
+    const char* uri,
+    gsize* prefix_len)
+    G_GNUC_INTERNAL;
+
+const GUtilData*
+ndef_rec_u_prefix(
+    guint8 id)
+    G_GNUC_INTERNAL;
+
 char*
 ndef_rec_u_steal_uri(
     NdefRecU* ndef)
@@ -116,6 +332,22 @@ ndef_rec_t_new_from_data(
     const NdefData* ndef)
     G_GNUC_INTERNAL;
 
+gsize
+ndef_rec_t_storage_size(
+    const NdefData* ndef)
+    G_GNUC_INTERNAL;
+
+char*
+ndef_rec_t_system_lang(
+    void)
+    G_GNUC_INTERNAL;
+
+NDEF_LANG_MATCH
+ndef_rec_t_lang_tag_match(
+    const char* tag,
+    const NdefLanguage* lang)
+    G_GNUC_INTERNAL;
+
 char*
 ndef_rec_t_steal_lang(
     NdefRecT* self)
@@ -131,6 +363,11 @@ ndef_rec_sp_new_from_data(
     const NdefData* ndef)
     G_GNUC_INTERNAL;
 
+gsize
+ndef_rec_sp_storage_size(
+    const NdefData* ndef)
+    G_GNUC_INTERNAL;
+
 #endif /* NDEF_REC_PRIVATE_H */
 
 /*
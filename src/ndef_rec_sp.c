@@ -57,6 +57,7 @@ struct nfc_ndef_rec_sp_priv {
     char* lang;
     char* type;
     NdefMediaPriv* icon;
+    gsize decoded;
 };
 
 #define THIS(obj) NDEF_REC_SP(obj)
@@ -77,145 +78,215 @@ static const GUtilData ndef_rec_sp_type_t = { (const guint8*) "t", 1 };
 static
 NdefMediaPriv*
 ndef_rec_sp_media_new(
-    NdefRec* rec)
+    NdefRec* rec,
+    const NdefData* ndef)
 {
     NdefMediaPriv* media = g_slice_new0(NdefMediaPriv);
 
     media->pub.data.size = rec->payload.size;
-    media->pub.data.bytes = media->data = gutil_memdup
-        (rec->payload.bytes, rec->payload.size);
-    media->pub.type = media->type = g_strndup
-        ((char*)rec->type.bytes, rec->type.size);
+    if (rec->payload.size) {
+        media->pub.data.bytes = media->data = ndef_data_alloc(ndef,
+            rec->payload.size);
+        memcpy(media->data, rec->payload.bytes, rec->payload.size);
+    }
+    media->pub.type = media->type = ndef_data_strndup(ndef,
+        (char*)rec->type.bytes, rec->type.size);
     return media;
 }
 
+typedef struct ndef_rec_sp_enc_title {
+    const char* text;
+    gsize text_len;
+    const char* lang;
+    guint lang_len;
+} NdefRecSpEncTitle;
+
+typedef struct ndef_rec_sp_enc {
+    GUtilData uri;              /* Without the abbreviated prefix */
+    guint8 uri_prefix;
+    NdefRecSpEncTitle* titles;
+    guint n_titles;
+    GUtilData type;
+    guint size;
+    NDEF_SP_ACT act;
+    GUtilData icon_type;
+    GUtilData icon_data;
+    guint count;                /* Number of nested records */
+    gsize payload_length;
+} NdefRecSpEnc;
+
+#define NDEF_REC_T_LANG_MAX (0x3f)
+
 static
-NdefRec*
-ndef_rec_sp_append_well_known(
-    NdefRec* last,
+gsize
+ndef_rec_sp_enc_rec_size(
     const GUtilData* type,
-    const GUtilData* data)
+    gsize payload_length)
 {
-    NdefRec* rec = ndef_rec_new_well_known(THIS_TYPE, NDEF_RTD_UNKNOWN,
-        type, data);
+    return ndef_rec_header_size(0, 0, payload_length) + type->size +
+        payload_length;
+}
 
-    ndef_rec_clear_flags(rec, NDEF_REC_FLAG_FIRST);
-    ndef_rec_clear_flags(last, NDEF_REC_FLAG_LAST);
-    last->next = rec;
-    return rec;
+static
+void
+ndef_rec_sp_enc_add(
+    NdefRecSpEnc* enc,
+    const GUtilData* type,
+    gsize payload_length)
+{
+    enc->payload_length += ndef_rec_sp_enc_rec_size(type, payload_length);
+    enc->count++;
 }
 
 static
-GBytes*
-ndef_rec_sp_payload_new(
-    NdefRecSpPriv* priv,
-    const char* uri,
-    const char* title,
-    const char* lang,
-    const char* type,
-    guint size,
-    NDEF_SP_ACT act,
-    const NdefMedia* icon)
+guint8*
+ndef_rec_sp_enc_write_header(
+    guint8* ptr,
+    NDEF_TNF tnf,
+    const GUtilData* type,
+    gsize payload_length,
+    guint* index,
+    guint count)
 {
-    GByteArray* buf = g_byte_array_new();
-    NdefRecU* rec_U = ndef_rec_u_new(uri);
-    NdefRec* last = &rec_U->rec;
-    NdefRec* rec_T;
-    NdefRec* rec_act;
-    NdefRec* rec_s;
-    NdefRec* rec_t;
-    NdefRec* rec_icon;
-
-    priv->uri = ndef_rec_u_steal_uri(rec_U);
-    if (title) {
-        NdefRecT* trec = ndef_rec_t_new(title, lang);
-
-        rec_T = &trec->rec;
-        priv->title = ndef_rec_t_steal_text(trec);
-        priv->lang = ndef_rec_t_steal_lang(trec);
-        ndef_rec_clear_flags(rec_T, NDEF_REC_FLAG_FIRST);
-        ndef_rec_clear_flags(last, NDEF_REC_FLAG_LAST);
-        last->next = rec_T;
-        last = rec_T;
-    } else {
-        rec_T = NULL;
-    }
-    if (act != NDEF_SP_ACT_DEFAULT) {
-        const guint8 value = (guint8)act;
-        GUtilData data;
+    const guint i = (*index)++;
+    const guint8 hdr = (guint8)tnf |
+        (i ? 0 : NDEF_HDR_MB) |
+        ((i == count - 1) ? NDEF_HDR_ME : 0);
 
-        data.bytes = &value;
-        data.size = sizeof(value);
-        rec_act = last = ndef_rec_sp_append_well_known(last,
-            &ndef_rec_sp_type_act, &data);
-    } else {
-        rec_act = NULL;
-    }
-    if (size) {
-        const guint32 value = GUINT32_TO_BE(size);
-        GUtilData data;
+    ptr = ndef_rec_write_header(ptr, hdr, type->size, 0, payload_length);
+    return ndef_rec_write_data(ptr, type);
+}
 
-        data.bytes = (guint8*)&value;
-        data.size = sizeof(value);
-        rec_s = last = ndef_rec_sp_append_well_known(last,
-            &ndef_rec_sp_type_s, &data);
-    } else {
-        rec_s = NULL;
+/*
+ * Writes the nested Smart Poster message directly into the payload of
+ * the record being created.
+ */
+static
+guint8*
+ndef_rec_sp_enc_fill(
+    guint8* ptr,
+    gconstpointer user_data)
+{
+    const NdefRecSpEnc* enc = user_data;
+    guint i, index = 0;
+
+    /* URI */
+    ptr = ndef_rec_sp_enc_write_header(ptr, NDEF_TNF_WELL_KNOWN,
+        &ndef_rec_type_u, enc->uri.size + 1, &index, enc->count);
+    *ptr++ = enc->uri_prefix;
+    ptr = ndef_rec_write_data(ptr, &enc->uri);
+
+    /* Titles (UTF-8) */
+    for (i = 0; i < enc->n_titles; i++) {
+        const NdefRecSpEncTitle* t = enc->titles + i;
+
+        ptr = ndef_rec_sp_enc_write_header(ptr, NDEF_TNF_WELL_KNOWN,
+            &ndef_rec_type_t, 1 + t->lang_len + t->text_len, &index,
+            enc->count);
+        *ptr++ = (guint8)t->lang_len;
+        memcpy(ptr, t->lang, t->lang_len);
+        ptr += t->lang_len;
+        if (t->text_len) {
+            memcpy(ptr, t->text, t->text_len);
+            ptr += t->text_len;
+        }
     }
-    if (type) {
-        GUtilData data;
 
-        data.bytes = (guint8*)type;
-        data.size = strlen(type);
-        priv->type = gutil_memdup(type, data.size + 1);
-        rec_t = last = ndef_rec_sp_append_well_known(last,
-            &ndef_rec_sp_type_t, &data);
-    } else {
-        rec_t = NULL;
-    }
-    if (icon && icon->type) {
-        GUtilData media_type;
-
-        media_type.bytes = (guint8*)icon->type;
-        media_type.size = strlen(icon->type);
-        rec_icon = ndef_rec_new_mediatype(&media_type, &icon->data);
-        priv->icon = ndef_rec_sp_media_new(rec_icon);
-        ndef_rec_clear_flags(rec_icon, NDEF_REC_FLAG_FIRST);
-        ndef_rec_clear_flags(last, NDEF_REC_FLAG_LAST);
-        last->next = rec_icon;
-        last = rec_icon;
-    } else {
-        rec_icon = NULL;
+    /* Action */
+    if (enc->act != NDEF_SP_ACT_DEFAULT) {
+        ptr = ndef_rec_sp_enc_write_header(ptr, NDEF_TNF_WELL_KNOWN,
+            &ndef_rec_sp_type_act, 1, &index, enc->count);
+        *ptr++ = (guint8)enc->act;
     }
 
-    g_byte_array_append(buf, rec_U->rec.raw.bytes, rec_U->rec.raw.size);
-    if (rec_T) {
-        g_byte_array_append(buf, rec_T->raw.bytes, rec_T->raw.size);
-    }
-    if (rec_act) {
-        g_byte_array_append(buf, rec_act->raw.bytes, rec_act->raw.size);
+    /* Size (big endian) */
+    if (enc->size) {
+        ptr = ndef_rec_sp_enc_write_header(ptr, NDEF_TNF_WELL_KNOWN,
+            &ndef_rec_sp_type_s, 4, &index, enc->count);
+        *ptr++ = (guint8)(enc->size >> 24);
+        *ptr++ = (guint8)(enc->size >> 16);
+        *ptr++ = (guint8)(enc->size >> 8);
+        *ptr++ = (guint8)enc->size;
     }
-    if (rec_s) {
-        g_byte_array_append(buf, rec_s->raw.bytes, rec_s->raw.size);
+
+    /* Type */
+    if (enc->type.bytes) {
+        ptr = ndef_rec_sp_enc_write_header(ptr, NDEF_TNF_WELL_KNOWN,
+            &ndef_rec_sp_type_t, enc->type.size, &index, enc->count);
+        ptr = ndef_rec_write_data(ptr, &enc->type);
     }
-    if (rec_t) {
-        g_byte_array_append(buf, rec_t->raw.bytes, rec_t->raw.size);
+
+    /* Icon */
+    if (enc->icon_type.size) {
+        ptr = ndef_rec_sp_enc_write_header(ptr, NDEF_TNF_MEDIA_TYPE,
+            &enc->icon_type, enc->icon_data.size, &index, enc->count);
+        ptr = ndef_rec_write_data(ptr, &enc->icon_data);
     }
-    if (rec_icon) {
-        g_byte_array_append(buf, rec_icon->raw.bytes, rec_icon->raw.size);
+
+    GASSERT(index == enc->count);
+    return ptr;
+}
+
+/* Picks the title which ndef_rec_sp_parse() would pick */
+static
+guint
+ndef_rec_sp_enc_best_title(
+    const NdefRecSpEnc* enc)
+{
+    guint best = 0;
+
+    if (enc->n_titles > 1) {
+        NdefLanguage* lang = ndef_system_language();
+
+        if (lang) {
+            NDEF_LANG_MATCH best_match = ndef_rec_t_lang_tag_match(
+                enc->titles[0].lang, lang);
+            guint i;
+
+            for (i = 1; i < enc->n_titles; i++) {
+                const NDEF_LANG_MATCH match = ndef_rec_t_lang_tag_match(
+                    enc->titles[i].lang, lang);
+
+                /* The first one wins in case of a tie */
+                if (match > best_match) {
+                    best_match = match;
+                    best = i;
+                }
+            }
+            g_free(lang);
+        }
     }
+    return best;
+}
 
-    ndef_rec_unref(&rec_U->rec);
-    return g_byte_array_free_to_bytes(buf);
+/*
+ * Title records are inserted into the list in the order in which they
+ * appear in the message, i.e. the new one always goes after the ones
+ * which are already there. Unlike ndef_rec_t_lang_compare(), there's
+ * no need to walk the chain to figure out the natural order.
+ */
+static
+gint
+ndef_rec_sp_title_compare(
+    gconstpointer a,   /* NdefRecT* being inserted */
+    gconstpointer b,   /* NdefRecT* already in the list */
+    gpointer user_data /* NdefLanguage* */)
+{
+    const NdefLanguage* lang = user_data;
+    const NDEF_LANG_MATCH m1 = ndef_rec_t_lang_match(NDEF_REC_T(a), lang);
+    const NDEF_LANG_MATCH m2 = ndef_rec_t_lang_match(NDEF_REC_T(b), lang);
+
+    return (m1 != m2) ? ((gint)m2 - (gint)m1) : 1;
 }
 
 static
 gboolean
 ndef_rec_sp_parse(
-    NdefRecSp* self)
+    NdefRecSp* self,
+    const NdefData* data)
 {
     /* The content of a Smart Poster payload is an NDEF message */
-    NdefRec* content = ndef_rec_new(&self->rec.payload);
+    NdefRec* content = ndef_rec_new_nested(&self->rec, data);
     NdefRecSpPriv* priv = self->priv;
     NdefLanguage* lang = NULL;
     NdefRecU* uri = NULL;
@@ -247,7 +318,7 @@ ndef_rec_sp_parse(
                 }
                 if (lang) {
                     title = g_slist_insert_sorted_with_data(title, ndef,
-                        ndef_rec_t_lang_compare, lang);
+                        ndef_rec_sp_title_compare, lang);
                 } else {
                     title = g_slist_append(title, ndef);
                 }
@@ -318,11 +389,11 @@ ndef_rec_sp_parse(
                 self->title = priv->title = ndef_rec_t_steal_text(trec);
             }
             if (type) {
-                self->type = priv->type = g_strndup
-                    ((char*)type->payload.bytes, type->payload.size);
+                self->type = priv->type = ndef_data_strndup(data,
+                    (char*)type->payload.bytes, type->payload.size);
             }
             if (icon) {
-                NdefMediaPriv* media = ndef_rec_sp_media_new(icon);
+                NdefMediaPriv* media = ndef_rec_sp_media_new(icon, data);
 
                 self->icon = &media->pub;
                 priv->icon = media;
@@ -338,6 +409,26 @@ ndef_rec_sp_parse(
     return ok;
 }
 
+static
+NdefRecSp*
+ndef_rec_sp_decode(
+    NdefRecSp* self)
+{
+    NdefRecSpPriv* priv = self->priv;
+
+    if (g_once_init_enter(&priv->decoded)) {
+        /* Lazily created record hasn't been decoded yet */
+        if (!self->uri && self->rec.payload.size &&
+            !ndef_rec_sp_parse(self, NULL)) {
+            /* Drop whatever has been picked up before the failure */
+            self->size = 0;
+            self->act = NDEF_SP_ACT_DEFAULT;
+        }
+        g_once_init_leave(&priv->decoded, TRUE);
+    }
+    return self;
+}
+
 /*==========================================================================*
  * Interface
  *==========================================================================*/
@@ -353,7 +444,9 @@ ndef_rec_sp_new_from_data(
         NdefRec* rec = &self->rec;
 
         ndef_rec_initialize(rec, NDEF_RTD_SMART_POSTER, ndef);
-        if (ndef_rec_sp_parse(self)) {
+        if ((ndef->flags & NDEF_PARSE_FLAG_LAZY) ||
+            ndef_rec_sp_parse(self, ndef)) {
+            /* In lazy mode, the content is parsed on demand */
             return self;
         }
         ndef_rec_unref(rec);
@@ -361,6 +454,29 @@ ndef_rec_sp_new_from_data(
     return NULL;
 }
 
+gsize
+ndef_rec_sp_storage_size(
+    const NdefData* ndef)
+{
+    NdefParseState* state = ndef->state;
+    GUtilData payload;
+
+    if (ndef_payload(ndef, &payload)) {
+        /*
+         * The nested records plus the type and the icon which are
+         * copied from the payload (with NULL terminators for strings)
+         */
+        gsize size = payload.size + 2;
+
+        if (ndef_parse_state_enter(state)) {
+            size += ndef_storage_size(&payload, state);
+            ndef_parse_state_leave(state);
+        }
+        return size;
+    }
+    return 0;
+}
+
 NdefRecSp*
 ndef_rec_sp_new(
     const char* uri,
@@ -371,33 +487,186 @@ ndef_rec_sp_new(
     NDEF_SP_ACT act,
     const NdefMedia* icon)
 {
-    if (G_LIKELY(uri)) {
-        GBytes* payload_bytes;
-        GUtilData payload;
-        NdefRecSpPriv priv;
-        NdefRecSp* self;
-
-        memset(&priv, 0, sizeof(priv));
-        payload_bytes = ndef_rec_sp_payload_new(&priv, uri,
-            title, lang, type, size, act, icon);
-        self = THIS(ndef_rec_new_well_known(THIS_TYPE,
-            NDEF_RTD_SMART_POSTER, &ndef_rec_type_sp,
-            gutil_data_from_bytes(&payload, payload_bytes)));
-
-        *(self->priv) = priv;
-        self->uri = priv.uri;
-        self->title = priv.title;
-        self->lang = priv.lang;
-        self->type = priv.type;
+    NdefSpTitle t;
+
+    t.title = title;
+    t.lang = lang;
+    return ndef_rec_sp_new_full(uri, &t, title ? 1 : 0, type, size, act,
+        icon);
+}
+
+NdefRecSp*
+ndef_rec_sp_new_full(
+    const char* uri,
+    const NdefSpTitle* titles,
+    guint n_titles,
+    const char* type,
+    guint size,
+    NDEF_SP_ACT act,
+    const NdefMedia* icon) /* Since 1.1.0 */
+{
+    static const char lang_default[] = "en";
+    NdefRecSp* self = NULL;
+    char* system_lang = NULL;
+    gboolean system_lang_known = FALSE;
+    gboolean ok = TRUE;
+    NdefRecSpEnc enc;
+    gsize skip;
+    guint i;
+
+    if (G_UNLIKELY(!uri) || G_UNLIKELY(n_titles && !titles)) {
+        return NULL;
+    }
+
+    /* Calculate the layout of the nested message */
+    memset(&enc, 0, sizeof(enc));
+    enc.uri_prefix = ndef_rec_u_abbreviate(uri, &skip);
+    gutil_data_from_string(&enc.uri, uri + skip);
+    ndef_rec_sp_enc_add(&enc, &ndef_rec_type_u, enc.uri.size + 1);
+
+    enc.titles = g_new(NdefRecSpEncTitle, n_titles);
+    enc.n_titles = n_titles;
+    for (i = 0; i < n_titles && ok; i++) {
+        NdefRecSpEncTitle* t = enc.titles + i;
+        const char* lang = titles[i].lang;
+
+        if (!lang) {
+            if (!system_lang_known) {
+                system_lang = ndef_rec_t_system_lang();
+                system_lang_known = TRUE;
+            }
+            lang = system_lang ? system_lang : lang_default;
+        }
+        t->text = titles[i].title ? titles[i].title : "";
+        t->text_len = strlen(t->text);
+        t->lang = lang;
+        t->lang_len = strlen(lang);
+        if (t->lang_len > NDEF_REC_T_LANG_MAX) {
+            GWARN("Language code too long: %s", lang);
+            ok = FALSE;
+        } else {
+            ndef_rec_sp_enc_add(&enc, &ndef_rec_type_t, 1 + t->lang_len +
+                t->text_len);
+        }
+    }
+
+    enc.act = act;
+    if (act != NDEF_SP_ACT_DEFAULT) {
+        ndef_rec_sp_enc_add(&enc, &ndef_rec_sp_type_act, 1);
+    }
+    enc.size = size;
+    if (size) {
+        ndef_rec_sp_enc_add(&enc, &ndef_rec_sp_type_s, 4);
+    }
+    if (type) {
+        gutil_data_from_string(&enc.type, type);
+        ndef_rec_sp_enc_add(&enc, &ndef_rec_sp_type_t, enc.type.size);
+    }
+    if (icon && icon->type) {
+        GUtilData icon_type;
+
+        gutil_data_from_string(&icon_type, icon->type);
+        if (icon_type.size <= 0xff &&
+            ndef_valid_mediatype(&icon_type, FALSE)) {
+            enc.icon_type = icon_type;
+            enc.icon_data = icon->data;
+            ndef_rec_sp_enc_add(&enc, &icon_type, icon->data.size);
+        } else {
+            GWARN("Invalid icon type: %s", icon->type);
+        }
+    }
+
+    /* Write the whole thing in one go */
+    if (ok) {
+        self = THIS(ndef_rec_new_well_known_filled(THIS_TYPE,
+            NDEF_RTD_SMART_POSTER, &ndef_rec_type_sp, enc.payload_length,
+            ndef_rec_sp_enc_fill, &enc));
+    }
+    if (self) {
+        NdefRecSpPriv* priv = self->priv;
+        const NdefRec* rec = &self->rec;
+
+        self->uri = priv->uri = g_strdup(uri);
+        if (n_titles) {
+            const NdefRecSpEncTitle* t = enc.titles +
+                ndef_rec_sp_enc_best_title(&enc);
+
+            self->title = priv->title = g_strndup(t->text, t->text_len);
+            self->lang = priv->lang = g_strndup(t->lang, t->lang_len);
+        }
+        if (type) {
+            self->type = priv->type = g_strdup(type);
+        }
         self->size = size;
         self->act = act;
-        if (priv.icon) {
-            self->icon = &priv.icon->pub;
+        if (enc.icon_type.size) {
+            NdefMediaPriv* media = g_slice_new0(NdefMediaPriv);
+
+            /* The icon record is the last one, no need to copy the data */
+            media->pub.type = media->type = g_strdup(icon->type);
+            media->pub.data.size = enc.icon_data.size;
+            if (enc.icon_data.size) {
+                media->pub.data.bytes = rec->payload.bytes +
+                    rec->payload.size - enc.icon_data.size;
+            }
+            self->icon = &media->pub;
+            priv->icon = media;
         }
-        g_bytes_unref(payload_bytes);
-        return self;
     }
-    return NULL;
+
+    g_free(system_lang);
+    g_free(enc.titles);
+    return self;
+}
+
+const char*
+ndef_rec_sp_uri(
+    NdefRecSp* self) /* Since 1.1.0 */
+{
+    return G_LIKELY(self) ? ndef_rec_sp_decode(self)->uri : NULL;
+}
+
+const char*
+ndef_rec_sp_title(
+    NdefRecSp* self) /* Since 1.1.0 */
+{
+    return G_LIKELY(self) ? ndef_rec_sp_decode(self)->title : NULL;
+}
+
+const char*
+ndef_rec_sp_lang(
+    NdefRecSp* self) /* Since 1.1.0 */
+{
+    return G_LIKELY(self) ? ndef_rec_sp_decode(self)->lang : NULL;
+}
+
+const char*
+ndef_rec_sp_type(
+    NdefRecSp* self) /* Since 1.1.0 */
+{
+    return G_LIKELY(self) ? ndef_rec_sp_decode(self)->type : NULL;
+}
+
+guint
+ndef_rec_sp_size(
+    NdefRecSp* self) /* Since 1.1.0 */
+{
+    return G_LIKELY(self) ? ndef_rec_sp_decode(self)->size : 0;
+}
+
+NDEF_SP_ACT
+ndef_rec_sp_act(
+    NdefRecSp* self) /* Since 1.1.0 */
+{
+    return G_LIKELY(self) ? ndef_rec_sp_decode(self)->act :
+        NDEF_SP_ACT_DEFAULT;
+}
+
+const NdefMedia*
+ndef_rec_sp_icon(
+    NdefRecSp* self) /* Since 1.1.0 */
+{
+    return G_LIKELY(self) ? ndef_rec_sp_decode(self)->icon : NULL;
 }
 
 /*==========================================================================*
@@ -422,13 +691,13 @@ ndef_rec_sp_finalize(
     NdefRecSpPriv* priv = self->priv;
     NdefMediaPriv* icon = priv->icon;
 
-    g_free(priv->uri);
-    g_free(priv->title);
-    g_free(priv->lang);
-    g_free(priv->type);
+    ndef_rec_free_data(&self->rec, priv->uri);
+    ndef_rec_free_data(&self->rec, priv->title);
+    ndef_rec_free_data(&self->rec, priv->lang);
+    ndef_rec_free_data(&self->rec, priv->type);
     if (icon) {
-        g_free(icon->type);
-        g_free(icon->data);
+        ndef_rec_free_data(&self->rec, icon->type);
+        ndef_rec_free_data(&self->rec, icon->data);
         g_slice_free1(sizeof(*icon), icon);
     }
     G_OBJECT_CLASS(PARENT_CLASS)->finalize(object);
@@ -38,6 +38,7 @@
  */
 
 #include "ndef_rec_p.h"
+#include "ndef_stats_p.h"
 #include "ndef_util_p.h"
 #include "ndef_log.h"
 
@@ -48,6 +49,7 @@
 struct nfc_ndef_rec_t_priv {
     char* lang;
     char* text;
+    gsize decoded;
 };
 
 #define THIS(obj) NDEF_REC_T(obj)
@@ -117,6 +119,7 @@ ndef_rec_t_build(
         g_free(enc_text_tmp);
         return g_byte_array_free_to_bytes(buf);
     } else {
+        NDEF_STATS_INC(text_errors);
         if (err) {
             GWARN("Failed to encode Text record: %s", err->message);
             g_error_free(err);
@@ -127,6 +130,136 @@ ndef_rec_t_build(
     }
 }
 
+static
+gboolean
+ndef_rec_t_lang_valid(
+    const GUtilData* payload)
+{
+    const guint lang_len = (payload->bytes[0] & STATUS_LANG_LEN_MASK);
+
+    /* Empty or ASCII (at least UTF-8) */
+    return lang_len < payload->size && (!lang_len ||
+        g_utf8_validate((char*)payload->bytes + 1, lang_len, NULL));
+}
+
+static
+gboolean
+ndef_rec_t_parse(
+    const NdefData* ndef,
+    const GUtilData* payload,
+    char** lang_out,
+    const char** text_out,
+    char** text_buf_out)
+{
+    const guint8 status_byte = payload->bytes[0];
+    const guint lang_len = (status_byte & STATUS_LANG_LEN_MASK);
+    const char* lang = (char*)payload->bytes + 1;
+
+    if (ndef_rec_t_lang_valid(payload)) {
+        const char* text = (char*)payload->bytes + lang_len + 1;
+        const guint text_len = payload->size - lang_len - 1;
+        const char* utf8;
+        gsize utf8_len;
+        char* utf8_buf;
+
+        if (status_byte & STATUS_ENC_UTF16) {
+            GError* err = NULL;
+            if (text_len >= sizeof(UTF16_BOM_BE) &&
+                !memcmp(text, UTF16_BOM_BE, sizeof(UTF16_BOM_BE))) {
+                utf8_buf = g_convert(text + sizeof(UTF16_BOM_BE),
+                    text_len - sizeof(UTF16_BOM_BE), ENC_UTF8,
+                    ENC_UTF16_BE, NULL, &utf8_len, &err);
+            } else if (text_len >= sizeof(UTF16_BOM_LE) &&
+                !memcmp(text, UTF16_BOM_LE, sizeof(UTF16_BOM_LE))) {
+                utf8_buf = g_convert(text + sizeof(UTF16_BOM_LE),
+                    text_len - sizeof(UTF16_BOM_LE), ENC_UTF8,
+                    ENC_UTF16_LE, NULL, &utf8_len, &err);
+            } else {
+                /*
+                 * 3.4 UTF-16 Byte Order
+                 *
+                 * ... If the BOM is omitted, the byte order shall be
+                 * big-endian (UTF-16 BE).
+                 */
+                utf8_buf = g_convert(text, text_len, ENC_UTF8,
+                    ENC_UTF16_BE, NULL, &utf8_len, &err);
+            }
+            if (err) {
+                GWARN("Failed to decode Text record: %s", err->message);
+                NDEF_STATS_INC(text_errors);
+                g_free(utf8_buf); /* Should be NULL already */
+                g_error_free(err);
+                utf8 = NULL;
+            } else {
+                utf8 = utf8_buf = ndef_data_move_string(ndef, utf8_buf,
+                    utf8_len);
+            }
+        } else if (!text_len) {
+            utf8 = "";
+            utf8_buf = NULL;
+        } else if (g_utf8_validate(text, text_len, NULL)) {
+            utf8 = utf8_buf = ndef_data_strndup(ndef, text, text_len);
+            utf8_len = text_len;
+        } else {
+            GDEBUG("Text record is not valid UTF-8");
+            NDEF_STATS_INC(text_errors);
+            utf8 = NULL;
+        }
+
+        if (utf8) {
+            *text_out = utf8;
+            *text_buf_out = utf8_buf;
+            *lang_out = lang_len ? ndef_data_strndup(ndef, lang, lang_len) :
+                NULL;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static
+void
+ndef_rec_t_set_decoded(
+    NdefRecT* self,
+    char* lang,
+    const char* text,
+    char* text_buf)
+{
+    NdefRecTPriv* priv = self->priv;
+
+    self->text = text;
+    priv->text = text_buf;
+    if (lang) {
+        self->lang = priv->lang = lang;
+    } else {
+        self->lang = "";
+    }
+}
+
+static
+void
+ndef_rec_t_decode(
+    NdefRecT* self)
+{
+    NdefRecTPriv* priv = self->priv;
+
+    if (g_once_init_enter(&priv->decoded)) {
+        const GUtilData* payload = &self->rec.payload;
+
+        /* Lazily created record hasn't been decoded yet */
+        if (!self->text && payload->size) {
+            const char* text;
+            char* text_buf;
+            char* lang;
+
+            if (ndef_rec_t_parse(NULL, payload, &lang, &text, &text_buf)) {
+                ndef_rec_t_set_decoded(self, lang, text, text_buf);
+            }
+        }
+        g_once_init_leave(&priv->decoded, TRUE);
+    }
+}
+
 /*==========================================================================*
  * Interface
  *==========================================================================*/
@@ -138,77 +271,54 @@ ndef_rec_t_new_from_data(
     GUtilData payload;
 
     if (ndef_payload(ndef, &payload)) {
-        const guint8 status_byte = payload.bytes[0];
-        const guint lang_len = (status_byte & STATUS_LANG_LEN_MASK);
-        const char* lang = (char*)payload.bytes + 1;
-
-        if ((lang_len < payload.size) && /* Empty or ASCII (at least UTF-8) */
-            (!lang_len || g_utf8_validate(lang, lang_len, NULL))) {
-            const char* text = (char*)payload.bytes + lang_len + 1;
-            const guint text_len = payload.size - lang_len - 1;
-            const char* utf8;
-            gsize utf8_len;
-            char* utf8_buf;
-
-            if (status_byte & STATUS_ENC_UTF16) {
-                GError* err = NULL;
-                if (text_len >= sizeof(UTF16_BOM_BE) &&
-                    !memcmp(text, UTF16_BOM_BE, sizeof(UTF16_BOM_BE))) {
-                    utf8_buf = g_convert(text + sizeof(UTF16_BOM_BE),
-                        text_len - sizeof(UTF16_BOM_BE), ENC_UTF8,
-                        ENC_UTF16_BE, NULL, &utf8_len, &err);
-                } else if (text_len >= sizeof(UTF16_BOM_LE) &&
-                    !memcmp(text, UTF16_BOM_LE, sizeof(UTF16_BOM_LE))) {
-                    utf8_buf = g_convert(text + sizeof(UTF16_BOM_LE),
-                        text_len - sizeof(UTF16_BOM_LE), ENC_UTF8,
-                        ENC_UTF16_LE, NULL, &utf8_len, &err);
-                } else {
-                    /*
-                     * 3.4 UTF-16 Byte Order
-                     *
-                     * ... If the BOM is omitted, the byte order shall be
-                     * big-endian (UTF-16 BE).
-                     */
-                    utf8_buf = g_convert(text, text_len, ENC_UTF8,
-                        ENC_UTF16_BE, NULL, &utf8_len, &err);
-                }
-                if (err) {
-                    GWARN("Failed to decode Text record: %s", err->message);
-                    g_free(utf8_buf); /* Should be NULL already */
-                    g_error_free(err);
-                    utf8 = NULL;
-                } else {
-                    utf8 = utf8_buf;
-                }
-            } else if (!text_len) {
-                utf8 = "";
-                utf8_buf = NULL;
-            } else if (g_utf8_validate(text, text_len, NULL)) {
-                utf8 = utf8_buf = g_strndup(text, text_len);
-                utf8_len = text_len;
-            } else {
-                utf8 = NULL;
-            }
-
-            if (utf8) {
+        const char* text;
+        char* text_buf;
+        char* lang;
+
+        if (ndef->flags & NDEF_PARSE_FLAG_LAZY) {
+            /*
+             * Decoding of the text is postponed until text or language
+             * is requested but the language code is checked right away.
+             */
+            if (ndef_rec_t_lang_valid(&payload)) {
                 NdefRecT* self = g_object_new(THIS_TYPE, NULL);
-                NdefRecTPriv* priv = self->priv;
 
                 ndef_rec_initialize(&self->rec, NDEF_RTD_TEXT, ndef);
-                self->text = utf8;
-                priv->text = utf8_buf;
-                if (lang_len) {
-                    self->lang = priv->lang = g_strndup(lang, lang_len);
-                } else {
-                    self->lang = "";
-                }
                 return self;
             }
+            GDEBUG("Invalid Text record language code");
+        } else if (ndef_rec_t_parse(ndef, &payload, &lang, &text,
+            &text_buf)) {
+            NdefRecT* self = g_object_new(THIS_TYPE, NULL);
+
+            ndef_rec_initialize(&self->rec, NDEF_RTD_TEXT, ndef);
+            ndef_rec_t_set_decoded(self, lang, text, text_buf);
+            return self;
         }
     }
     return NULL;
 }
 
+gsize
+ndef_rec_t_storage_size(
+    const NdefData* ndef)
+{
+    GUtilData payload;
+
+    if (ndef_payload(ndef, &payload)) {
+        const guint lang_len = (payload.bytes[0] & STATUS_LANG_LEN_MASK);
+
+        if (lang_len < payload.size) {
+            const gsize text_len = payload.size - lang_len - 1;
+
+            /* Each UTF-16 code unit takes up to 3 bytes in UTF-8 */
+            return lang_len + 1 + 1 + ((payload.bytes[0] & STATUS_ENC_UTF16) ?
+                (text_len / 2 * 3) : text_len);
+        }
+    }
+    return 0;
+}
+
 NdefRecT*
 ndef_rec_t_new_enc(
     const char* text,
@@ -221,15 +331,7 @@ ndef_rec_t_new_enc(
     static const char text_default[] = "";
 
     if (!lang) {
-        NdefLanguage* system = ndef_system_language();
-
-        if (system) {
-            lang = lang_tmp = system->territory ?
-                g_strconcat(system->language, "-", system->territory, NULL) :
-                g_strdup(system->language);
-            g_free(system);
-            GDEBUG("System language: %s", lang);
-        }
+        lang = lang_tmp = ndef_rec_t_system_lang();
     }
 
     payload_bytes = ndef_rec_t_build(text ? text : text_default,
@@ -258,34 +360,35 @@ ndef_rec_t_new_enc(
     return NULL;
 }
 
+const char*
+ndef_rec_t_lang(
+    NdefRecT* self) /* Since 1.1.0 */
+{
+    if (G_LIKELY(self)) {
+        ndef_rec_t_decode(self);
+        return self->lang;
+    }
+    return NULL;
+}
+
+const char*
+ndef_rec_t_text(
+    NdefRecT* self) /* Since 1.1.0 */
+{
+    if (G_LIKELY(self)) {
+        ndef_rec_t_decode(self);
+        return self->text;
+    }
+    return NULL;
+}
+
 NDEF_LANG_MATCH
 ndef_rec_t_lang_match(
     NdefRecT* rec,
     const NdefLanguage* lang)
 {
-    NDEF_LANG_MATCH match = NDEF_LANG_MATCH_NONE;
-
-    if (G_LIKELY(rec) && G_LIKELY(lang) && G_LIKELY(lang->language)) {
-        const char* sep = strchr(rec->lang, '-');
-
-        if (sep) {
-            const gsize lang_len = sep - rec->lang;
-
-            if (strlen(lang->language) == lang_len &&
-                !g_ascii_strncasecmp(rec->lang, lang->language, lang_len)) {
-                match |= NDEF_LANG_MATCH_LANGUAGE;
-            }
-            if (lang->territory && lang->territory[0] &&
-                !g_ascii_strcasecmp(sep + 1, lang->territory)) {
-                match |= NDEF_LANG_MATCH_TERRITORY;
-            }
-        } else {
-            if (!g_ascii_strcasecmp(rec->lang, lang->language)) {
-                match |= NDEF_LANG_MATCH_LANGUAGE;
-            }
-        }
-    }
-    return match;
+    return G_LIKELY(rec) ? ndef_rec_t_lang_tag_match(ndef_rec_t_lang(rec),
+        lang) : NDEF_LANG_MATCH_NONE;
 }
 
 gint
@@ -326,6 +429,55 @@ ndef_rec_t_lang_compare(
     }
 }
 
+/* Returns the language tag for the system locale, NULL if unknown */
+char*
+ndef_rec_t_system_lang(
+    void)
+{
+    NdefLanguage* system = ndef_system_language();
+
+    if (system) {
+        char* lang = system->territory ?
+            g_strconcat(system->language, "-", system->territory, NULL) :
+            g_strdup(system->language);
+
+        g_free(system);
+        GDEBUG("System language: %s", lang);
+        return lang;
+    }
+    return NULL;
+}
+
+NDEF_LANG_MATCH
+ndef_rec_t_lang_tag_match(
+    const char* tag,
+    const NdefLanguage* lang)
+{
+    NDEF_LANG_MATCH match = NDEF_LANG_MATCH_NONE;
+
+    if (G_LIKELY(tag) && G_LIKELY(lang) && G_LIKELY(lang->language)) {
+        const char* sep = strchr(tag, '-');
+
+        if (sep) {
+            const gsize lang_len = sep - tag;
+
+            if (strlen(lang->language) == lang_len &&
+                !g_ascii_strncasecmp(tag, lang->language, lang_len)) {
+                match |= NDEF_LANG_MATCH_LANGUAGE;
+            }
+            if (lang->territory && lang->territory[0] &&
+                !g_ascii_strcasecmp(sep + 1, lang->territory)) {
+                match |= NDEF_LANG_MATCH_TERRITORY;
+            }
+        } else {
+            if (!g_ascii_strcasecmp(tag, lang->language)) {
+                match |= NDEF_LANG_MATCH_LANGUAGE;
+            }
+        }
+    }
+    return match;
+}
+
 char*
 ndef_rec_t_steal_lang(
     NdefRecT* self)
@@ -376,8 +528,8 @@ ndef_rec_t_finalize(
     NdefRecT* self = THIS(object);
     NdefRecTPriv* priv = self->priv;
 
-    g_free(priv->lang);
-    g_free(priv->text);
+    ndef_rec_free_data(&self->rec, priv->lang);
+    ndef_rec_free_data(&self->rec, priv->text);
     G_OBJECT_CLASS(PARENT_CLASS)->finalize(object);
 }
 
@@ -40,12 +40,12 @@
 #include "ndef_rec_p.h"
 #include "ndef_log.h"
 
-#include <gutil_misc.h>
-
 /* NFCForum-TS-RTD_URI_1.0 */
 
 struct nfc_ndef_rec_u_priv {
     char* uri;
+    gsize decoded;
+    NdefUriParts parts;
 };
 
 #define THIS(obj) NDEF_REC_U(obj)
@@ -95,62 +95,168 @@ static const GUtilData ndef_rec_u_abbreviation_table[] = {
     /* 0x20 */ { (const guint8*) "urn:epc:pat:", 12 },
     /* 0x21 */ { (const guint8*) "urn:epc:raw:", 12 },
     /* 0x22 */ { (const guint8*) "urn:epc:", 8 },
-    /* 0x23 */ { (const guint8*) "urn:nfc:", 7 },
+    /* 0x23 */ { (const guint8*) "urn:nfc:", 8 },
+};
+
+/*
+ * Identifier codes indexed by the first character of the prefix (all
+ * of them start with a lowercase letter). Longer prefixes come first,
+ * so the first match is the longest one and the search stops there.
+ */
+static const char* const ndef_rec_u_abbreviation_index['z' - 'a' + 1] = {
+    /* a */ NULL,
+    /* b */ "\x19\x1a\x18",
+    /* c */ NULL,
+    /* d */ "\x0e",
+    /* e */ NULL,
+    /* f */ "\x07\x08\x1d\x09\x0d",
+    /* g */ NULL,
+    /* h */ "\x02\x01\x04\x03",
+    /* i */ "\x1c\x11",
+    /* j */ NULL,
+    /* k */ NULL,
+    /* l */ NULL,
+    /* m */ "\x06",
+    /* n */ "\x0c\x0f",
+    /* o */ NULL,
+    /* p */ "\x14",
+    /* q */ NULL,
+    /* r */ "\x12",
+    /* s */ "\x0a\x0b\x16\x15",
+    /* t */ "\x1b\x10\x17\x05",
+    /* u */ "\x1f\x20\x21\x1e\x22\x23\x13",
+    /* v */ NULL,
+    /* w */ NULL,
+    /* x */ NULL,
+    /* y */ NULL,
+    /* z */ NULL
 };
 
+typedef struct ndef_rec_u_enc {
+    const char* rest;
+    gsize rest_len;
+    guint8 prefix;
+} NdefRecUEnc;
+
 static
-GBytes*
-ndef_rec_u_build(
-    const char* uri)
+guint8*
+ndef_rec_u_enc_fill(
+    guint8* ptr,
+    gconstpointer user_data)
+{
+    const NdefRecUEnc* enc = user_data;
+
+    *ptr++ = enc->prefix;
+    memcpy(ptr, enc->rest, enc->rest_len);
+    return ptr + enc->rest_len;
+}
+
+static
+void
+ndef_rec_u_span(
+    NdefUriSpan* span,
+    const char* uri,
+    const char* start,
+    const char* end)
+{
+    span->offset = start - uri;
+    span->length = end - start;
+}
+
+/* RFC 3986, section 3 "Syntax Components" */
+static
+void
+ndef_rec_u_split(
+    NdefUriParts* parts,
+    const char* uri,
+    gsize len,
+    guint8 prefix)
 {
-    GByteArray* buf = g_byte_array_new();
-    gsize len = strlen(uri);
-    guint8 i;
-
-    /* Skip the first one, the one that means "no abbreviation" */
-    for (i = 1; i < G_N_ELEMENTS(ndef_rec_u_abbreviation_table); i++) {
-        const GUtilData* abbr = ndef_rec_u_abbreviation_table + i;
-
-        if (len >= abbr->size && !memcmp(uri, abbr->bytes, abbr->size)) {
-            g_byte_array_append(buf, &i, 1);
-            uri += abbr->size;
-            len -= abbr->size;
-            break;
+    const char* end = uri + len;
+    const char* ptr = uri;
+    const char* p;
+
+    memset(parts, 0, sizeof(*parts));
+    parts->prefix = prefix;
+    if (prefix) {
+        /* All prefixes include the scheme, no need to look for it */
+        const GUtilData* abbr = ndef_rec_u_abbreviation_table + prefix;
+        const guint8* colon = memchr(abbr->bytes, ':', abbr->size);
+
+        ptr += colon - abbr->bytes;
+    } else if (ptr < end && g_ascii_isalpha(*ptr)) {
+        /* scheme = ALPHA *( ALPHA / DIGIT / "+" / "-" / "." ) */
+        for (p = ptr + 1; p < end && (g_ascii_isalnum(*p) || *p == '+' ||
+            *p == '-' || *p == '.'); p++);
+        if (p < end && *p == ':') {
+            ptr = p;
         }
     }
+    if (ptr > uri) {
+        ndef_rec_u_span(&parts->scheme, uri, uri, ptr);
+        ptr++; /* Skip the colon */
+    }
+
+    /* authority = [ userinfo "@" ] host [ ":" port ] */
+    if (end - ptr >= 2 && ptr[0] == '/' && ptr[1] == '/') {
+        const char* host;
 
-    if (!buf->len) {
-        /* No abbreviation */
-        i = 0;
-        g_byte_array_append(buf, &i, 1);
+        ptr += 2;
+        for (p = ptr; p < end && *p != '/' && *p != '?' && *p != '#'; p++);
+        ndef_rec_u_span(&parts->authority, uri, ptr, p);
+        for (host = p; host > ptr && host[-1] != '@'; host--);
+        if (host > ptr) {
+            ndef_rec_u_span(&parts->userinfo, uri, ptr, host - 1);
+        }
+        ptr = p;
+        if (host < ptr && *host == '[') {
+            /* IP-literal, the brackets are not included */
+            for (p = ++host; p < ptr && *p != ']'; p++);
+            ndef_rec_u_span(&parts->host, uri, host, p);
+            if (p < ptr) {
+                p++;
+            }
+        } else {
+            for (p = host; p < ptr && *p != ':'; p++);
+            ndef_rec_u_span(&parts->host, uri, host, p);
+        }
+        if (p < ptr && *p == ':') {
+            ndef_rec_u_span(&parts->port, uri, p + 1, ptr);
+        }
     }
 
-    /* Append the rest */
-    g_byte_array_append(buf, (const guint8*)uri, len);
-    return g_byte_array_free_to_bytes(buf);
+    for (p = ptr; p < end && *p != '?' && *p != '#'; p++);
+    ndef_rec_u_span(&parts->path, uri, ptr, p);
+    ptr = p;
+    if (ptr < end && *ptr == '?') {
+        for (p = ++ptr; p < end && *p != '#'; p++);
+        ndef_rec_u_span(&parts->query, uri, ptr, p);
+        ptr = p;
+    }
+    if (ptr < end && *ptr == '#') {
+        ptr++;
+        ndef_rec_u_span(&parts->fragment, uri, ptr, end);
+    }
 }
 
 static
 char*
 ndef_rec_u_parse(
-    const GUtilData* payload)
+    const NdefData* ndef,
+    const GUtilData* payload,
+    NdefUriParts* parts)
 {
-    /* ndef_payload() makes sure that payload length > 0 */
-    const guint8 prefix_id = payload->bytes[0];
+    const gsize size = ndef_rec_u_decode(payload, NULL, 0);
 
-    if (prefix_id < G_N_ELEMENTS(ndef_rec_u_abbreviation_table)) {
-        const GUtilData* abbr = ndef_rec_u_abbreviation_table + prefix_id;
-        guint len = abbr->size + payload->size - 1;
-        char* uri = g_malloc(len + 1);
+    if (size) {
+        char* uri = ndef_data_alloc(ndef, size);
 
-        if (abbr->size) {
-            memcpy(uri, abbr->bytes, abbr->size);
-        }
-        memcpy(uri + abbr->size, payload->bytes + 1, payload->size - 1);
-        uri[len] = 0;
+        ndef_rec_u_decode(payload, uri, size);
+        ndef_rec_u_split(parts, uri, size - 1, payload->bytes[0]);
         return uri;
     } else {
-        GDEBUG("Unknown URI Record prefix 0x02%x", prefix_id);
+        /* ndef_payload() makes sure that payload length > 0 */
+        GDEBUG("Unknown URI Record prefix 0x%02x", payload->bytes[0]);
         return NULL;
     }
 }
@@ -164,24 +270,127 @@ ndef_rec_u_new(
     const char* uri)
 {
     if (G_LIKELY(uri)) {
-        GUtilData payload;
-        GBytes* payload_bytes = ndef_rec_u_build(uri);
-        NdefRecU* self = THIS(ndef_rec_new_well_known(THIS_TYPE,
-            NDEF_RTD_URI, &ndef_rec_type_u,
-            gutil_data_from_bytes(&payload, payload_bytes)));
-        NdefRecUPriv* priv = self->priv;
-
+        NdefRecU* self;
+        NdefRecUPriv* priv;
+        NdefRecUEnc enc;
+        gsize skip;
+
+        /* Write the payload directly into the record */
+        enc.prefix = ndef_rec_u_abbreviate(uri, &skip);
+        enc.rest = uri + skip;
+        enc.rest_len = strlen(enc.rest);
+        self = THIS(ndef_rec_new_well_known_filled(THIS_TYPE, NDEF_RTD_URI,
+            &ndef_rec_type_u, enc.rest_len + 1, ndef_rec_u_enc_fill, &enc));
+        priv = self->priv;
         self->uri = priv->uri = g_strdup(uri);
-        g_bytes_unref(payload_bytes);
+        ndef_rec_u_split(&priv->parts, priv->uri, skip + enc.rest_len,
+            enc.prefix);
         return self;
     }
     return NULL;
 }
 
+gsize
+ndef_rec_u_decode(
+    const GUtilData* payload,
+    char* buf,
+    gsize size) /* Since 1.1.0 */
+{
+    if (G_LIKELY(payload) && payload->size &&
+        payload->bytes[0] < G_N_ELEMENTS(ndef_rec_u_abbreviation_table)) {
+        const GUtilData* abbr = ndef_rec_u_abbreviation_table +
+            payload->bytes[0];
+        const gsize len = abbr->size + payload->size - 1;
+
+        if (!buf) {
+            return len + 1;
+        } else if (size > len) {
+            if (abbr->size) {
+                memcpy(buf, abbr->bytes, abbr->size);
+            }
+            memcpy(buf + abbr->size, payload->bytes + 1, payload->size - 1);
+            buf[len] = 0;
+            return len + 1;
+        }
+    }
+    return 0;
+}
+
+const char*
+ndef_rec_u_uri(
+    NdefRecU* self) /* Since 1.1.0 */
+{
+    if (G_LIKELY(self)) {
+        NdefRecUPriv* priv = self->priv;
+
+        if (g_once_init_enter(&priv->decoded)) {
+            /* Lazily created record hasn't been decoded yet */
+            if (!self->uri && self->rec.payload.size) {
+                self->uri = priv->uri = ndef_rec_u_parse(NULL,
+                    &self->rec.payload, &priv->parts);
+            }
+            g_once_init_leave(&priv->decoded, TRUE);
+        }
+        return self->uri;
+    }
+    return NULL;
+}
+
+const NdefUriParts*
+ndef_rec_u_parts(
+    NdefRecU* self) /* Since 1.1.0 */
+{
+    /* The parts are filled in when the URI gets decoded */
+    return ndef_rec_u_uri(self) ? &self->priv->parts : NULL;
+}
+
 /*==========================================================================*
  * Internal interface
  *==========================================================================*/
 
+/*
+ * Returns the URI identifier code (zero if the URI can't be abbreviated)
+ * and the length of the prefix it replaces. Some prefixes are prefixes
+ * of the others (e.g. "urn:" and "urn:epc:id:") so the longest match
+ * wins, that gives the shortest payload.
+ */
+guint8
+ndef_rec_u_abbreviate(
+    const char* uri,
+    gsize* prefix_len)
+{
+    const guchar c = uri[0];
+
+    if (c >= 'a' && c <= 'z') {
+        const char* ids = ndef_rec_u_abbreviation_index[c - 'a'];
+
+        if (ids) {
+            for (; *ids; ids++) {
+                const guint8 id = (guint8) *ids;
+                const GUtilData* abbr = ndef_rec_u_abbreviation_table + id;
+
+                /* The first character is already known to match */
+                if (!strncmp(uri + 1, (const char*)abbr->bytes + 1,
+                    abbr->size - 1)) {
+                    *prefix_len = abbr->size;
+                    return id;
+                }
+            }
+        }
+    }
+    *prefix_len = 0;
+    return 0;
+}
+
+/* Returns NULL if the URI identifier code is unknown */
+const GUtilData*
+ndef_rec_u_prefix(
+    guint8 id)
+{
+    return (id < G_N_ELEMENTS(ndef_rec_u_abbreviation_table)) ?
+        (ndef_rec_u_abbreviation_table + id) : NULL;
+}
+
 NdefRecU*
 ndef_rec_u_new_from_data(
     const NdefData* ndef)
@@ -189,20 +398,51 @@ ndef_rec_u_new_from_data(
     GUtilData payload;
 
     if (ndef_payload(ndef, &payload)) {
-        char* uri = ndef_rec_u_parse(&payload);
-
-        if (uri) {
-            NdefRecU* self = g_object_new(THIS_TYPE, NULL);
-            NdefRecUPriv* priv = self->priv;
-
-            ndef_rec_initialize(&self->rec, NDEF_RTD_URI, ndef);
-            self->uri = priv->uri = uri;
-            return self;
+        if (ndef->flags & NDEF_PARSE_FLAG_LAZY) {
+            /*
+             * Decoding is postponed until ndef_rec_u_uri() is called
+             * but the prefix is checked right away, to end up with the
+             * same kind of record as the eager parsing.
+             */
+            if (ndef_rec_u_prefix(payload.bytes[0])) {
+                NdefRecU* self = g_object_new(THIS_TYPE, NULL);
+
+                ndef_rec_initialize(&self->rec, NDEF_RTD_URI, ndef);
+                return self;
+            }
+            GDEBUG("Unknown URI Record prefix 0x%02x", payload.bytes[0]);
+        } else {
+            NdefUriParts parts;
+            char* uri = ndef_rec_u_parse(ndef, &payload, &parts);
+
+            if (uri) {
+                NdefRecU* self = g_object_new(THIS_TYPE, NULL);
+                NdefRecUPriv* priv = self->priv;
+
+                ndef_rec_initialize(&self->rec, NDEF_RTD_URI, ndef);
+                self->uri = priv->uri = uri;
+                priv->parts = parts;
+                return self;
+            }
         }
     }
     return NULL;
 }
 
+gsize
+ndef_rec_u_storage_size(
+    const NdefData* ndef)
+{
+    GUtilData payload;
+
+    if (ndef_payload(ndef, &payload) &&
+        payload.bytes[0] < G_N_ELEMENTS(ndef_rec_u_abbreviation_table)) {
+        return ndef_rec_u_abbreviation_table[payload.bytes[0]].size +
+            payload.size;
+    }
+    return 0;
+}
+
 char*
 ndef_rec_u_steal_uri(
     NdefRecU* self)
@@ -238,7 +478,7 @@ ndef_rec_u_finalize(
     NdefRecU* self = THIS(object);
     NdefRecUPriv* priv = self->priv;
 
-    g_free(priv->uri);
+    ndef_rec_free_data(&self->rec, priv->uri);
     G_OBJECT_CLASS(PARENT_CLASS)->finalize(object);
 }
 
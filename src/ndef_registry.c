@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "ndef_rec_p.h"
+#include "ndef_log.h"
+
+#include <gutil_misc.h>
+
+/* Types registered by the application */
+
+typedef struct ndef_registry_entry {
+    gint ref_count;
+    guint id;
+    guint tnf;
+    GUtilData type;
+    GType gtype;
+    NdefRecInitFunc init;
+    gpointer user_data;
+    GDestroyNotify destroy;
+} NdefRegistryEntry;
+
+/*
+ * The table is never modified after it has been published. Registering
+ * and unregistering handlers builds a new table, swaps the pointer and
+ * waits until the readers which may still be looking at the old table
+ * are done with it (which doesn't take long, they only do a lookup).
+ * Readers don't take any locks, they only bump the counter for the
+ * current epoch. The lock serializes the writers.
+ */
+G_LOCK_DEFINE_STATIC(ndef_registry);
+static GHashTable* ndef_registry_table = NULL;
+static guint ndef_registry_last_id = 0;
+static gint ndef_registry_epoch = 0;
+static gint ndef_registry_readers[2];
+
+static
+guint
+ndef_registry_hash(
+    gconstpointer key)
+{
+    const NdefRegistryEntry* entry = key;
+    const guint8* ptr = entry->type.bytes;
+    const guint8* end = ptr + entry->type.size;
+    guint h = 5381 + entry->tnf;
+
+    while (ptr < end) {
+        h = (h << 5) + h + *ptr++;
+    }
+    return h;
+}
+
+static
+gboolean
+ndef_registry_equal(
+    gconstpointer a,
+    gconstpointer b)
+{
+    const NdefRegistryEntry* e1 = a;
+    const NdefRegistryEntry* e2 = b;
+
+    return e1->tnf == e2->tnf && gutil_data_equal(&e1->type, &e2->type);
+}
+
+static
+void
+ndef_registry_entry_unref(
+    gpointer data)
+{
+    NdefRegistryEntry* entry = data;
+
+    if (g_atomic_int_dec_and_test(&entry->ref_count)) {
+        if (entry->destroy) {
+            entry->destroy(entry->user_data);
+        }
+        g_free(entry);
+    }
+}
+
+/* Copies the table except for the entry with the specified id */
+static
+GHashTable*
+ndef_registry_table_copy(
+    GHashTable* table,
+    guint skip_id)
+{
+    GHashTable* copy = g_hash_table_new_full(ndef_registry_hash,
+        ndef_registry_equal, NULL, ndef_registry_entry_unref);
+
+    if (table) {
+        GHashTableIter it;
+        gpointer value;
+
+        g_hash_table_iter_init(&it, table);
+        while (g_hash_table_iter_next(&it, NULL, &value)) {
+            NdefRegistryEntry* entry = value;
+
+            if (entry->id != skip_id) {
+                g_atomic_int_inc(&entry->ref_count);
+                g_hash_table_insert(copy, entry, entry);
+            }
+        }
+    }
+    return copy;
+}
+
+/*
+ * Publishes the new table and returns the old one, once it's no longer
+ * used by the readers. Must be called under the lock. Switching the
+ * epoch twice makes sure that we have waited for both counters, i.e.
+ * for all the readers which have seen the old table.
+ */
+static
+GHashTable*
+ndef_registry_table_replace(
+    GHashTable* table)
+{
+    GHashTable* old = ndef_registry_table;
+    guint i;
+
+    if (table && !g_hash_table_size(table)) {
+        /* Restore the fast path */
+        g_hash_table_destroy(table);
+        table = NULL;
+    }
+    g_atomic_pointer_set(&ndef_registry_table, table);
+    for (i = 0; i < 2; i++) {
+        const gint epoch = ndef_registry_epoch;
+
+        g_atomic_int_set(&ndef_registry_epoch, !epoch);
+        while (g_atomic_int_get(ndef_registry_readers + epoch)) {
+            g_thread_yield();
+        }
+    }
+    return old;
+}
+
+/*==========================================================================*
+ * Interface
+ *==========================================================================*/
+
+guint
+ndef_rec_type_register(
+    NDEF_TNF tnf,
+    const GUtilData* type,
+    GType gtype,
+    NdefRecInitFunc init,
+    gpointer user_data,
+    GDestroyNotify destroy) /* Since 1.1.0 */
+{
+    const gsize type_size = type ? type->size : 0;
+
+    if (!gtype) {
+        gtype = NDEF_TYPE_REC;
+    }
+    if (tnf <= NDEF_TNF_MAX && type_size <= 0xff &&
+        g_type_is_a(gtype, NDEF_TYPE_REC)) {
+        NdefRegistryEntry* entry = g_malloc(sizeof(NdefRegistryEntry) +
+            type_size);
+        guint8* type_bytes = (guint8*)(entry + 1);
+        GHashTable* table;
+        guint id;
+
+        if (type_size) {
+            memcpy(type_bytes, type->bytes, type_size);
+        }
+        entry->ref_count = 1;
+        entry->tnf = tnf;
+        entry->type.bytes = type_bytes;
+        entry->type.size = type_size;
+        entry->gtype = gtype;
+        entry->init = init;
+        entry->user_data = user_data;
+        entry->destroy = destroy;
+
+        G_LOCK(ndef_registry);
+        id = entry->id = ++ndef_registry_last_id;
+        if (!id) {
+            id = entry->id = ++ndef_registry_last_id;
+        }
+        table = ndef_registry_table_copy(ndef_registry_table, 0);
+        /* Replaces (and unrefs) the previously registered entry */
+        g_hash_table_remove(table, entry);
+        g_hash_table_insert(table, entry, entry);
+        table = ndef_registry_table_replace(table);
+        G_UNLOCK(ndef_registry);
+        if (table) {
+            g_hash_table_destroy(table);
+        }
+        /* The entry may be already gone */
+        return id;
+    }
+    return 0;
+}
+
+void
+ndef_rec_type_unregister(
+    guint id) /* Since 1.1.0 */
+{
+    if (G_LIKELY(id)) {
+        GHashTable* table = NULL;
+
+        G_LOCK(ndef_registry);
+        if (ndef_registry_table) {
+            table = ndef_registry_table_copy(ndef_registry_table, id);
+            table = ndef_registry_table_replace(table);
+        }
+        G_UNLOCK(ndef_registry);
+        if (table) {
+            g_hash_table_destroy(table);
+        }
+    }
+}
+
+/*==========================================================================*
+ * Internal interface
+ *==========================================================================*/
+
+NdefRec*
+ndef_registry_rec_new(
+    const NdefData* ndef)
+{
+    NdefRegistryEntry* entry = NULL;
+
+    /* Quick check without touching the counters */
+    if (g_atomic_pointer_get(&ndef_registry_table)) {
+        const gint epoch = g_atomic_int_get(&ndef_registry_epoch);
+        GHashTable* table;
+        NdefRegistryEntry key;
+
+        memset(&key, 0, sizeof(key));
+        key.tnf = ndef->rec.bytes[0] & NDEF_HDR_TNF_MASK;
+        ndef_type(ndef, &key.type);
+
+        /* The table can't be freed while we are counted as a reader */
+        g_atomic_int_inc(ndef_registry_readers + epoch);
+        table = g_atomic_pointer_get(&ndef_registry_table);
+        if (table) {
+            entry = g_hash_table_lookup(table, &key);
+            if (entry) {
+                g_atomic_int_inc(&entry->ref_count);
+            }
+        }
+        g_atomic_int_add(ndef_registry_readers + epoch, -1);
+    }
+
+    if (entry) {
+        NdefRec* rec = ndef_rec_initialize(g_object_new(entry->gtype, NULL),
+            NDEF_RTD_UNKNOWN, ndef);
+
+        if (entry->init && !entry->init(rec, entry->user_data)) {
+            ndef_rec_unref(rec);
+            rec = NULL;
+        }
+        ndef_registry_entry_unref(entry);
+        return rec;
+    }
+    return NULL;
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
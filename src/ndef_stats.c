@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "ndef_stats_p.h"
+#include "ndef_rec_p.h"
+
+/* NdefStats is nothing but a bunch of counters, 40 of them */
+#define NDEF_STATS_COUNT (sizeof(NdefStats) / sizeof(guint))
+G_STATIC_ASSERT(sizeof(NdefStats) == NDEF_STATS_COUNT * sizeof(guint));
+G_STATIC_ASSERT(NDEF_STATS_COUNT == 40);
+G_STATIC_ASSERT(NDEF_RTD_SMART_POSTER < NDEF_STATS_RTD_COUNT);
+G_STATIC_ASSERT(NDEF_HDR_TNF_MASK < NDEF_STATS_TNF_COUNT);
+
+gint ndef_stats_on = 0;
+static gint ndef_stats_counters[NDEF_STATS_COUNT];
+
+/*==========================================================================*
+ * Interface
+ *==========================================================================*/
+
+void
+ndef_stats_enable(
+    gboolean enable) /* Since 1.1.0 */
+{
+    g_atomic_int_set(&ndef_stats_on, enable ? 1 : 0);
+}
+
+gboolean
+ndef_stats_enabled(
+    void) /* Since 1.1.0 */
+{
+    return g_atomic_int_get(&ndef_stats_on) != 0;
+}
+
+void
+ndef_stats_get(
+    NdefStats* stats) /* Since 1.1.0 */
+{
+    if (G_LIKELY(stats)) {
+        guint* out = (guint*)stats;
+        guint i;
+
+        for (i = 0; i < NDEF_STATS_COUNT; i++) {
+            out[i] = (guint)g_atomic_int_get(ndef_stats_counters + i);
+        }
+    }
+}
+
+void
+ndef_stats_reset(
+    void) /* Since 1.1.0 */
+{
+    guint i;
+
+    for (i = 0; i < NDEF_STATS_COUNT; i++) {
+        g_atomic_int_set(ndef_stats_counters + i, 0);
+    }
+}
+
+/*==========================================================================*
+ * Internal interface
+ *==========================================================================*/
+
+void
+ndef_stats_add(
+    guint index,
+    guint n)
+{
+    g_atomic_int_add(ndef_stats_counters + index, n);
+}
+
+void
+ndef_stats_rec(
+    const NdefRec* rec)
+{
+    ndef_stats_add(NDEF_STATS_INDEX(rec_tnf) + ndef_rec_tnf_bits(rec), 1);
+    if ((guint)rec->rtd < NDEF_STATS_RTD_COUNT) {
+        ndef_stats_add(NDEF_STATS_INDEX(rec_rtd) + rec->rtd, 1);
+    }
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#ifndef NDEF_STATS_PRIVATE_H
+#define NDEF_STATS_PRIVATE_H
+
+#include "ndef_types.h"
+#include "ndef_stats.h"
+
+/* Non-zero if the statistics is being collected */
+extern gint ndef_stats_on G_GNUC_INTERNAL;
+
+#define NDEF_STATS_ACTIVE G_UNLIKELY(g_atomic_int_get(&ndef_stats_on))
+#define NDEF_STATS_INDEX(field) \
+    (G_STRUCT_OFFSET(NdefStats, field) / sizeof(guint))
+#define NDEF_STATS_ADD(field,n) G_STMT_START { \
+    if (NDEF_STATS_ACTIVE) ndef_stats_add(NDEF_STATS_INDEX(field), n); \
+    } G_STMT_END
+#define NDEF_STATS_INC(field) NDEF_STATS_ADD(field, 1)
+#define NDEF_STATS_REC(rec) G_STMT_START { \
+    if (NDEF_STATS_ACTIVE) ndef_stats_rec(rec); \
+    } G_STMT_END
+
+void
+ndef_stats_add(
+    guint index,
+    guint n)
+    G_GNUC_INTERNAL;
+
+void
+ndef_stats_rec(
+    const NdefRec* rec)
+    G_GNUC_INTERNAL;
+
+#endif /* NDEF_STATS_PRIVATE_H */
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -38,6 +38,241 @@
  */
 
 #include "ndef_tlv.h"
+#include "ndef_rec_p.h"
+
+#define NDEF_TLV_MAX_LENGTH (0xfffe)
+
+typedef struct ndef_tlv_msg {
+    const GUtilData* data;      /* Either raw message */
+    NdefRec* rec;               /* or a chain of records */
+    gsize size;
+} NdefTlvMsg;
+
+static
+gsize
+ndef_tlv_block_size(
+    gsize len)
+{
+    /* Type, length (1 or 3 bytes) and value */
+    return ((len < 0xff) ? 2 : 4) + len;
+}
+
+static
+guint8*
+ndef_tlv_write_block_header(
+    guint8* ptr,
+    guint type,
+    gsize len)
+{
+    *ptr++ = (guint8)type;
+    if (len < 0xff) {
+        *ptr++ = (guint8)len;
+    } else {
+        /* Three consecutive bytes format, big endian */
+        *ptr++ = 0xff;
+        *ptr++ = (guint8)(len >> 8);
+        *ptr++ = (guint8)len;
+    }
+    return ptr;
+}
+
+static
+guint8*
+ndef_tlv_write_blocks(
+    guint8* ptr,
+    guint type,
+    const GUtilData* values,
+    guint count)
+{
+    guint i;
+
+    for (i = 0; i < count; i++) {
+        const GUtilData* value = values + i;
+
+        ptr = ndef_tlv_write_block_header(ptr, type, value->size);
+        if (value->size) {
+            memcpy(ptr, value->bytes, value->size);
+            ptr += value->size;
+        }
+    }
+    return ptr;
+}
+
+static
+gboolean
+ndef_tlv_blocks_size(
+    const GUtilData* values,
+    guint count,
+    gsize* size)
+{
+    guint i;
+
+    for (i = 0; i < count; i++) {
+        if (values[i].size > NDEF_TLV_MAX_LENGTH) {
+            return FALSE;
+        }
+        *size += ndef_tlv_block_size(values[i].size);
+    }
+    return TRUE;
+}
+
+static
+gboolean
+ndef_tlv_msg_init_rec(
+    NdefTlvMsg* msg,
+    NdefRec* rec)
+{
+    memset(msg, 0, sizeof(*msg));
+    msg->rec = rec;
+    for (; rec; rec = rec->next) {
+        msg->size += ndef_rec_header_size(0, rec->id.size, rec->payload.size)
+            + rec->type.size + rec->id.size + rec->payload.size;
+        if (msg->size > NDEF_TLV_MAX_LENGTH) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static
+guint8*
+ndef_tlv_msg_write(
+    const NdefTlvMsg* msg,
+    guint8* ptr)
+{
+    if (msg->data) {
+        if (msg->size) {
+            memcpy(ptr, msg->data->bytes, msg->size);
+            ptr += msg->size;
+        }
+    } else {
+        NdefRec* rec;
+
+        for (rec = msg->rec; rec; rec = rec->next) {
+            const guint8 hdr = ndef_rec_tnf_bits(rec) |
+                ((rec == msg->rec) ? NDEF_HDR_MB : 0) |
+                (rec->next ? 0 : NDEF_HDR_ME);
+
+            ptr = ndef_rec_write_header(ptr, hdr, rec->type.size,
+                rec->id.size, rec->payload.size);
+            ptr = ndef_rec_write_data(ptr, &rec->type);
+            ptr = ndef_rec_write_data(ptr, &rec->id);
+            ptr = ndef_rec_write_data(ptr, &rec->payload);
+        }
+    }
+    return ptr;
+}
+
+static
+gsize
+ndef_tlv_msg_encode(
+    const NdefTlvMsg* msg,
+    const NdefTlvParams* params,
+    guint8* buf,
+    gsize bufsize)
+{
+    const gsize size = ndef_tlv_size(msg->size, params);
+
+    if (!buf || !size) {
+        return size;
+    } else if (bufsize < size) {
+        return 0;
+    } else {
+        guint8* ptr = ndef_tlv_write_head(buf, msg->size, params);
+
+        ndef_tlv_write_tail(ndef_tlv_msg_write(msg, ptr), buf + size);
+        return size;
+    }
+}
+
+static
+gsize
+ndef_tlv_msg_append(
+    GByteArray* out,
+    const NdefTlvMsg* msg,
+    const NdefTlvParams* params)
+{
+    const gsize size = ndef_tlv_msg_encode(msg, params, NULL, 0);
+
+    if (size) {
+        const guint off = out->len;
+
+        g_byte_array_set_size(out, off + size);
+        return ndef_tlv_msg_encode(msg, params, out->data + off, size);
+    }
+    return 0;
+}
+
+static
+gboolean
+ndef_tlv_msg_init_data(
+    NdefTlvMsg* msg,
+    const GUtilData* data)
+{
+    memset(msg, 0, sizeof(*msg));
+    msg->data = data;
+    msg->size = data->size;
+    return msg->size <= NDEF_TLV_MAX_LENGTH;
+}
+
+/*==========================================================================*
+ * Internal interface
+ *==========================================================================*/
+
+/*
+ * Exact size of the TLV sequence wrapping the message of the given size,
+ * including the terminator and the padding. Zero if it can't be encoded.
+ */
+gsize
+ndef_tlv_size(
+    gsize msg_size,
+    const NdefTlvParams* params)
+{
+    gsize size = ndef_tlv_block_size(msg_size) + 1;
+
+    if (msg_size > NDEF_TLV_MAX_LENGTH || (params &&
+        (!ndef_tlv_blocks_size(params->lock_control,
+        params->lock_control_count, &size) ||
+        !ndef_tlv_blocks_size(params->memory_control,
+        params->memory_control_count, &size)))) {
+        return 0;
+    }
+    if (params && params->page_size) {
+        size += (params->page_size - size % params->page_size) %
+            params->page_size;
+    }
+    return size;
+}
+
+/* Writes the control TLVs and the NDEF Message TLV header */
+guint8*
+ndef_tlv_write_head(
+    guint8* ptr,
+    gsize msg_size,
+    const NdefTlvParams* params)
+{
+    if (params) {
+        ptr = ndef_tlv_write_blocks(ptr, TLV_LOCK_CONTROL,
+            params->lock_control, params->lock_control_count);
+        ptr = ndef_tlv_write_blocks(ptr, TLV_MEMORY_CONTROL,
+            params->memory_control, params->memory_control_count);
+    }
+    return ndef_tlv_write_block_header(ptr, TLV_NDEF_MESSAGE, msg_size);
+}
+
+/* Writes the terminator and pads the rest of the buffer */
+void
+ndef_tlv_write_tail(
+    guint8* ptr,
+    guint8* end)
+{
+    *ptr++ = TLV_TERMINATOR;
+    memset(ptr, TLV_NULL, end - ptr);
+}
+
+/*==========================================================================*
+ * Interface
+ *==========================================================================*/
 
 /*
  * TLV iterator. Usage:
@@ -129,6 +364,58 @@ ndef_tlv_check(
     return 0;
 }
 
+gsize
+ndef_tlv_encode(
+    const GUtilData* data,
+    const NdefTlvParams* params,
+    void* buf,
+    gsize size) /* Since 1.1.0 */
+{
+    NdefTlvMsg msg;
+
+    return (G_LIKELY(data) && ndef_tlv_msg_init_data(&msg, data)) ?
+        ndef_tlv_msg_encode(&msg, params, buf, size) : 0;
+}
+
+gsize
+ndef_tlv_encode_rec(
+    NdefRec* rec,
+    const NdefTlvParams* params,
+    void* buf,
+    gsize size) /* Since 1.1.0 */
+{
+    NdefTlvMsg msg;
+
+    return (G_LIKELY(rec) && ndef_tlv_msg_init_rec(&msg, rec)) ?
+        ndef_tlv_msg_encode(&msg, params, buf, size) : 0;
+}
+
+gsize
+ndef_tlv_append(
+    GByteArray* out,
+    const GUtilData* data,
+    const NdefTlvParams* params) /* Since 1.1.0 */
+{
+    NdefTlvMsg msg;
+
+    return (G_LIKELY(out) && G_LIKELY(data) &&
+        ndef_tlv_msg_init_data(&msg, data)) ?
+        ndef_tlv_msg_append(out, &msg, params) : 0;
+}
+
+gsize
+ndef_tlv_append_rec(
+    GByteArray* out,
+    NdefRec* rec,
+    const NdefTlvParams* params) /* Since 1.1.0 */
+{
+    NdefTlvMsg msg;
+
+    return (G_LIKELY(out) && G_LIKELY(rec) &&
+        ndef_tlv_msg_init_rec(&msg, rec)) ?
+        ndef_tlv_msg_append(out, &msg, params) : 0;
+}
+
 /*
  * Local Variables:
  * mode: C
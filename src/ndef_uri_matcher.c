@@ -0,0 +1,414 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "ndef_uri_matcher.h"
+#include "ndef_rec_p.h"
+#include "ndef_log.h"
+
+/*
+ * The patterns are compiled into an NFA, which is a trie of pattern
+ * characters (so that patterns sharing a prefix share the states), and
+ * then into a DFA by the subset construction. Bytes which no pattern
+ * distinguishes from each other share a single column of the transition
+ * table. Since every URI prefix is a known string, the state reached
+ * after each of them is computed upfront, and matching an abbreviated
+ * payload starts from that state.
+ */
+
+#define TOKEN_STAR (0x100)      /* Any sequence without '/' */
+#define TOKEN_ANY (0x101)       /* Any sequence */
+#define TOKEN_ROOT (0x102)      /* Beginning of the URI */
+
+#define STATE_DEAD (0)
+#define MAX_STATES (0x10000)
+
+struct ndef_uri_matcher {
+    guint8 cls[256];            /* Byte classes */
+    guint n_classes;
+    guint* next;                /* State transitions, indexed by class */
+    gint* accept;               /* Matching pattern (or -1) per state */
+    guint start;
+    guint* prefix_state;        /* State after each URI prefix */
+    guint n_prefixes;
+};
+
+typedef struct ndef_uri_matcher_node {
+    guint16 tok;                /* Token leading to this node */
+    gint accept;                /* Pattern ending here (or -1) */
+    guint child;                /* First child (zero if none) */
+    guint sibling;              /* Next sibling (zero if none) */
+} NdefUriMatcherNode;
+
+typedef struct ndef_uri_matcher_compiler {
+    GArray* nodes;              /* NdefUriMatcherNode, the root is #0 */
+    guint* mark;                /* Nodes already in the set */
+    guint stamp;
+    GArray* set;                /* Nodes being collected */
+    GPtrArray* sets;            /* GBytes per state */
+    GHashTable* states;         /* Set => state + 1 */
+    GArray* next;
+    GArray* accept;
+    guint n_classes;
+} NdefUriMatcherCompiler;
+
+#define NODE(c,i) g_array_index((c)->nodes, NdefUriMatcherNode, i)
+
+static
+guint
+ndef_uri_matcher_child(
+    NdefUriMatcherCompiler* c,
+    guint parent,
+    guint16 tok)
+{
+    NdefUriMatcherNode node;
+    guint i;
+
+    for (i = NODE(c, parent).child; i; i = NODE(c, i).sibling) {
+        if (NODE(c, i).tok == tok) {
+            return i;
+        }
+    }
+    node.tok = tok;
+    node.accept = -1;
+    node.child = 0;
+    node.sibling = NODE(c, parent).child;
+    i = c->nodes->len;
+    g_array_append_vals(c->nodes, &node, 1);
+    NODE(c, parent).child = i;
+    return i;
+}
+
+static
+void
+ndef_uri_matcher_parse(
+    NdefUriMatcherCompiler* c,
+    const char* pattern,
+    guint index)
+{
+    const char* p;
+    guint node = 0;
+
+    for (p = pattern; *p; p++) {
+        guint16 tok;
+
+        if (*p == '*') {
+            if (p[1] == '*') {
+                while (p[1] == '*') {
+                    p++;
+                }
+                tok = TOKEN_ANY;
+            } else {
+                tok = TOKEN_STAR;
+            }
+        } else {
+            if (*p == '\\' && p[1]) {
+                p++;
+            }
+            tok = (guchar) *p;
+        }
+        node = ndef_uri_matcher_child(c, node, tok);
+    }
+    if (NODE(c, node).accept < 0) {
+        NODE(c, node).accept = index;
+    }
+}
+
+/* Adds the node and the wildcards following it (they may be empty) */
+static
+void
+ndef_uri_matcher_add_node(
+    NdefUriMatcherCompiler* c,
+    guint node)
+{
+    if (c->mark[node] != c->stamp) {
+        guint i;
+
+        c->mark[node] = c->stamp;
+        g_array_append_vals(c->set, &node, 1);
+        for (i = NODE(c, node).child; i; i = NODE(c, i).sibling) {
+            const guint16 tok = NODE(c, i).tok;
+
+            if (tok == TOKEN_STAR || tok == TOKEN_ANY) {
+                ndef_uri_matcher_add_node(c, i);
+            }
+        }
+    }
+}
+
+static
+gint
+ndef_uri_matcher_compare_node(
+    gconstpointer a,
+    gconstpointer b)
+{
+    const guint na = *(const guint*)a;
+    const guint nb = *(const guint*)b;
+
+    return (na < nb) ? -1 : (na > nb) ? 1 : 0;
+}
+
+/* Turns the collected set into a state. Returns FALSE if too many */
+static
+gboolean
+ndef_uri_matcher_state(
+    NdefUriMatcherCompiler* c,
+    guint* state)
+{
+    GBytes* set;
+    gpointer value;
+
+    g_array_sort(c->set, ndef_uri_matcher_compare_node);
+    set = g_bytes_new(c->set->data, c->set->len * sizeof(guint));
+    value = g_hash_table_lookup(c->states, set);
+    if (value) {
+        g_bytes_unref(set);
+        *state = GPOINTER_TO_UINT(value) - 1;
+    } else if (c->sets->len < MAX_STATES) {
+        gint accept = -1;
+        guint i;
+
+        /* Patterns registered earlier take precedence */
+        for (i = 0; i < c->set->len; i++) {
+            const gint index = NODE(c, g_array_index(c->set, guint,
+                i)).accept;
+
+            if (index >= 0 && (accept < 0 || index < accept)) {
+                accept = index;
+            }
+        }
+        *state = c->sets->len;
+        g_ptr_array_add(c->sets, set);
+        g_hash_table_insert(c->states, set, GUINT_TO_POINTER(*state + 1));
+        g_array_append_vals(c->accept, &accept, 1);
+        g_array_set_size(c->next, c->next->len + c->n_classes);
+    } else {
+        g_bytes_unref(set);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static
+gboolean
+ndef_uri_matcher_build(
+    NdefUriMatcher* self,
+    NdefUriMatcherCompiler* c)
+{
+    const guint n = c->nodes->len;
+    guint8 rep[256];
+    guint i, s, k;
+
+    /* Each literal and the slash get their own class, the rest share #0 */
+    memset(rep, 0, sizeof(rep));
+    self->cls['/'] = 1;
+    rep[1] = '/';
+    self->n_classes = 2;
+    for (i = 1; i < n; i++) {
+        const guint16 tok = NODE(c, i).tok;
+
+        if (tok < 0x100 && !self->cls[tok]) {
+            rep[self->n_classes] = (guint8)tok;
+            self->cls[tok] = self->n_classes++;
+        }
+    }
+    for (i = 0; i < 256 && self->cls[i]; i++);
+    rep[0] = (guint8)i;
+    c->n_classes = self->n_classes;
+
+    /* The dead state (empty set) is #0 */
+    c->stamp++;
+    ndef_uri_matcher_state(c, &s);
+
+    /* Start state */
+    c->stamp++;
+    g_array_set_size(c->set, 0);
+    ndef_uri_matcher_add_node(c, 0);
+    ndef_uri_matcher_state(c, &self->start);
+
+    /* Subset construction */
+    for (s = 1; s < c->sets->len; s++) {
+        gsize size;
+        const guint* set = g_bytes_get_data(c->sets->pdata[s], &size);
+        const guint count = size / sizeof(guint);
+
+        for (k = 0; k < c->n_classes; k++) {
+            const guint8 b = rep[k];
+            guint next;
+
+            c->stamp++;
+            g_array_set_size(c->set, 0);
+            for (i = 0; i < count; i++) {
+                const guint node = set[i];
+                const guint16 tok = NODE(c, node).tok;
+                guint j;
+
+                /* Wildcard loops */
+                if (tok == TOKEN_ANY || (tok == TOKEN_STAR && b != '/')) {
+                    ndef_uri_matcher_add_node(c, node);
+                }
+                for (j = NODE(c, node).child; j; j = NODE(c, j).sibling) {
+                    if (NODE(c, j).tok == b) {
+                        ndef_uri_matcher_add_node(c, j);
+                    }
+                }
+            }
+            if (!ndef_uri_matcher_state(c, &next)) {
+                GWARN("URI patterns are too complex");
+                return FALSE;
+            }
+            g_array_index(c->next, guint, s * c->n_classes + k) = next;
+        }
+    }
+    return TRUE;
+}
+
+static
+guint
+ndef_uri_matcher_run(
+    const NdefUriMatcher* self,
+    guint state,
+    const guint8* ptr,
+    gsize len)
+{
+    const guint8* end = ptr + len;
+    const guint n = self->n_classes;
+
+    while (ptr < end && state != STATE_DEAD) {
+        state = self->next[state * n + self->cls[*ptr++]];
+    }
+    return state;
+}
+
+/*==========================================================================*
+ * Interface
+ *==========================================================================*/
+
+NdefUriMatcher*
+ndef_uri_matcher_new(
+    const char* const* patterns) /* Since 1.1.0 */
+{
+    NdefUriMatcher* self = g_slice_new0(NdefUriMatcher);
+    NdefUriMatcherCompiler c;
+    gboolean ok;
+    guint i;
+
+    memset(&c, 0, sizeof(c));
+    c.nodes = g_array_sized_new(FALSE, TRUE, sizeof(NdefUriMatcherNode), 1);
+    g_array_set_size(c.nodes, 1);
+    NODE(&c, 0).tok = TOKEN_ROOT;
+    NODE(&c, 0).accept = -1;
+    c.set = g_array_new(FALSE, FALSE, sizeof(guint));
+    c.sets = g_ptr_array_new_with_free_func((GDestroyNotify) g_bytes_unref);
+    c.states = g_hash_table_new(g_bytes_hash, g_bytes_equal);
+    c.next = g_array_new(FALSE, TRUE, sizeof(guint));
+    c.accept = g_array_new(FALSE, FALSE, sizeof(gint));
+    for (i = 0; patterns && patterns[i]; i++) {
+        ndef_uri_matcher_parse(&c, patterns[i], i);
+    }
+    c.mark = g_new0(guint, c.nodes->len);
+
+    ok = ndef_uri_matcher_build(self, &c);
+    g_hash_table_destroy(c.states);
+    g_ptr_array_free(c.sets, TRUE);
+    g_array_free(c.nodes, TRUE);
+    g_array_free(c.set, TRUE);
+    g_free(c.mark);
+    self->next = (guint*)g_array_free(c.next, !ok);
+    self->accept = (gint*)g_array_free(c.accept, !ok);
+    if (ok) {
+        const GUtilData* prefix;
+
+        /* Where each URI prefix leads */
+        for (i = 0; ndef_rec_u_prefix(i); i++);
+        self->n_prefixes = i;
+        self->prefix_state = g_new(guint, i);
+        for (i = 0; (prefix = ndef_rec_u_prefix(i)) != NULL; i++) {
+            self->prefix_state[i] = ndef_uri_matcher_run(self, self->start,
+                prefix->bytes, prefix->size);
+        }
+        return self;
+    }
+    g_slice_free(NdefUriMatcher, self);
+    return NULL;
+}
+
+void
+ndef_uri_matcher_free(
+    NdefUriMatcher* self) /* Since 1.1.0 */
+{
+    if (G_LIKELY(self)) {
+        g_free(self->next);
+        g_free(self->accept);
+        g_free(self->prefix_state);
+        g_slice_free(NdefUriMatcher, self);
+    }
+}
+
+gint
+ndef_uri_matcher_match(
+    const NdefUriMatcher* self,
+    const GUtilData* payload) /* Since 1.1.0 */
+{
+    if (G_LIKELY(self) && G_LIKELY(payload) && payload->size &&
+        payload->bytes[0] < self->n_prefixes) {
+        return self->accept[ndef_uri_matcher_run(self,
+            self->prefix_state[payload->bytes[0]], payload->bytes + 1,
+            payload->size - 1)];
+    }
+    return -1;
+}
+
+gint
+ndef_uri_matcher_match_uri(
+    const NdefUriMatcher* self,
+    const char* uri) /* Since 1.1.0 */
+{
+    if (G_LIKELY(self) && G_LIKELY(uri)) {
+        return self->accept[ndef_uri_matcher_run(self, self->start,
+            (const guint8*)uri, strlen(uri))];
+    }
+    return -1;
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -83,6 +83,78 @@ ndef_hexdump_data(
     }
 }
 
+/* xxHash32, see https://github.com/Cyan4973/xxHash */
+
+#define NDEF_XXH32_P1 (0x9E3779B1u)
+#define NDEF_XXH32_P2 (0x85EBCA77u)
+#define NDEF_XXH32_P3 (0xC2B2AE3Du)
+#define NDEF_XXH32_P4 (0x27D4EB2Fu)
+#define NDEF_XXH32_P5 (0x165667B1u)
+#define NDEF_XXH32_ROTL(x,r) (((x) << (r)) | ((x) >> (32 - (r))))
+#define NDEF_XXH32_LE32(p) (((guint32)(p)[0]) | (((guint32)(p)[1]) << 8) | \
+    (((guint32)(p)[2]) << 16) | (((guint32)(p)[3]) << 24))
+
+static inline
+guint32
+ndef_xxh32_round(
+    guint32 acc,
+    guint32 input)
+{
+    acc += input * NDEF_XXH32_P2;
+    acc = NDEF_XXH32_ROTL(acc, 13);
+    return acc * NDEF_XXH32_P1;
+}
+
+guint32
+ndef_hash(
+    const void* data,
+    gsize len,
+    guint32 seed)
+{
+    const guint8* ptr = data;
+    const guint8* end = ptr + len;
+    guint32 h;
+
+    if (len >= 16) {
+        const guint8* limit = end - 16;
+        guint32 v1 = seed + NDEF_XXH32_P1 + NDEF_XXH32_P2;
+        guint32 v2 = seed + NDEF_XXH32_P2;
+        guint32 v3 = seed;
+        guint32 v4 = seed - NDEF_XXH32_P1;
+
+        do {
+            v1 = ndef_xxh32_round(v1, NDEF_XXH32_LE32(ptr));
+            v2 = ndef_xxh32_round(v2, NDEF_XXH32_LE32(ptr + 4));
+            v3 = ndef_xxh32_round(v3, NDEF_XXH32_LE32(ptr + 8));
+            v4 = ndef_xxh32_round(v4, NDEF_XXH32_LE32(ptr + 12));
+            ptr += 16;
+        } while (ptr <= limit);
+        h = NDEF_XXH32_ROTL(v1, 1) + NDEF_XXH32_ROTL(v2, 7) +
+            NDEF_XXH32_ROTL(v3, 12) + NDEF_XXH32_ROTL(v4, 18);
+    } else {
+        h = seed + NDEF_XXH32_P5;
+    }
+
+    h += (guint32)len;
+    while (ptr + 4 <= end) {
+        h += NDEF_XXH32_LE32(ptr) * NDEF_XXH32_P3;
+        h = NDEF_XXH32_ROTL(h, 17) * NDEF_XXH32_P4;
+        ptr += 4;
+    }
+    while (ptr < end) {
+        h += (*ptr++) * NDEF_XXH32_P5;
+        h = NDEF_XXH32_ROTL(h, 11) * NDEF_XXH32_P1;
+    }
+
+    /* Avalanche */
+    h ^= h >> 15;
+    h *= NDEF_XXH32_P2;
+    h ^= h >> 13;
+    h *= NDEF_XXH32_P3;
+    h ^= h >> 16;
+    return h;
+}
+
 NdefLanguage*
 ndef_system_language(
     void)
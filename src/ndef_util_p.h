@@ -53,6 +53,13 @@ ndef_hexdump_data(
     const GUtilData* data)
     G_GNUC_INTERNAL;
 
+guint32
+ndef_hash(
+    const void* data,
+    gsize len,
+    guint32 seed)
+    G_GNUC_INTERNAL;
+
 const char*
 ndef_system_locale(
     void)
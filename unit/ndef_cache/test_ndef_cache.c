@@ -0,0 +1,334 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "test_common.h"
+
+#include "ndef_cache.h"
+#include "ndef_tlv.h"
+
+#include <gutil_misc.h>
+
+static TestOpt test_opt;
+
+static const guint8 test_uri_rec[] = {
+    0xd1,           /* NDEF record header (MB,ME,SR,TNF=0x01) */
+    0x01,           /* Length of the record type */
+    0x0a,           /* Length of the record payload */
+    'U',            /* Record type: 'U' (URI) */
+    0x02,           /* "https://www." */
+    'j', 'o', 'l', 'l', 'a', '.', 'c', 'o', 'm'
+};
+
+static const guint8 test_text_rec[] = {
+    0xd1,           /* NDEF record header (MB,ME,SR,TNF=0x01) */
+    0x01,           /* Length of the record type */
+    0x05,           /* Length of the record payload */
+    'T',            /* Record type: 'T' (Text) */
+    0x02,           /* Status byte: UTF-8, language code length 2 */
+    'e', 'n',
+    'h', 'i'
+};
+
+#define TEST_URI "https://www.jolla.com"
+
+static
+void
+test_check_stats(
+    NdefParseCache* cache,
+    guint hits,
+    guint misses,
+    guint entries)
+{
+    NdefParseCacheStats stats;
+
+    ndef_parse_cache_get_stats(cache, &stats);
+    g_assert_cmpuint(stats.hits, == ,hits);
+    g_assert_cmpuint(stats.misses, == ,misses);
+    g_assert_cmpuint(stats.entries, == ,entries);
+}
+
+/*==========================================================================*
+ * null
+ *==========================================================================*/
+
+static
+void
+test_null(
+    void)
+{
+    GUtilData block;
+    NdefRec* rec;
+
+    ndef_parse_cache_free(NULL);
+    ndef_parse_cache_clear(NULL);
+    ndef_parse_cache_get_stats(NULL, NULL);
+    test_check_stats(NULL, 0, 0, 0);
+    g_assert(!ndef_parse_cache_rec_new(NULL, NULL, NDEF_PARSE_FLAGS_NONE));
+    g_assert(!ndef_parse_cache_rec_new_from_tlv(NULL, NULL,
+        NDEF_PARSE_FLAGS_NONE));
+
+    /* Without cache */
+    TEST_BYTES_SET(block, test_uri_rec);
+    rec = ndef_parse_cache_rec_new(NULL, &block, NDEF_PARSE_FLAGS_NONE);
+    g_assert(NDEF_IS_REC_U(rec));
+    ndef_rec_unref(rec);
+    g_assert(!ndef_parse_cache_rec_new_from_tlv(NULL, &block,
+        NDEF_PARSE_FLAGS_NONE));
+}
+
+/*==========================================================================*
+ * basic
+ *==========================================================================*/
+
+static
+void
+test_basic(
+    void)
+{
+    NdefParseCache* cache = ndef_parse_cache_new(0);
+    guint8* copy = gutil_memdup(test_uri_rec, sizeof(test_uri_rec));
+    GUtilData block;
+    NdefRec* rec1;
+    NdefRec* rec2;
+
+    TEST_BYTES_SET(block, test_uri_rec);
+    rec1 = ndef_parse_cache_rec_new(cache, &block, NDEF_PARSE_FLAGS_NONE);
+    g_assert(NDEF_IS_REC_U(rec1));
+    g_assert_cmpstr(NDEF_REC_U(rec1)->uri, == ,TEST_URI);
+    test_check_stats(cache, 0, 1, 1);
+
+    /* Same content at a different address */
+    block.bytes = copy;
+    rec2 = ndef_parse_cache_rec_new(cache, &block, NDEF_PARSE_FLAGS_NONE);
+    g_assert(rec2 == rec1);
+    test_check_stats(cache, 1, 1, 1);
+    ndef_rec_unref(rec2);
+
+    /* Different flags make a different entry, lazy or not */
+    rec2 = ndef_parse_cache_rec_new(cache, &block,
+        NDEF_PARSE_FLAG_SHARED_STORAGE | NDEF_PARSE_FLAG_LAZY);
+    g_assert(rec2 != rec1);
+    g_assert_cmpstr(NDEF_REC_U(rec2)->uri, == ,TEST_URI);
+    ndef_rec_unref(rec2);
+    rec2 = ndef_parse_cache_rec_new(cache, &block,
+        NDEF_PARSE_FLAG_SHARED_STORAGE);
+    g_assert(rec2 != rec1);
+    test_check_stats(cache, 2, 2, 2);
+    ndef_rec_unref(rec2);
+
+    /* Garbage is not cached */
+    block.size--;
+    g_assert(!ndef_parse_cache_rec_new(cache, &block, NDEF_PARSE_FLAGS_NONE));
+    test_check_stats(cache, 2, 3, 2);
+
+    /* The record survives clearing the cache */
+    ndef_parse_cache_clear(cache);
+    test_check_stats(cache, 2, 3, 0);
+    g_assert_cmpstr(NDEF_REC_U(rec1)->uri, == ,TEST_URI);
+    ndef_rec_unref(rec1);
+
+    ndef_parse_cache_free(cache);
+    g_free(copy);
+}
+
+/*==========================================================================*
+ * lru
+ *==========================================================================*/
+
+static
+void
+test_lru(
+    void)
+{
+    NdefParseCache* cache = ndef_parse_cache_new(2);
+    GUtilData uri, text, empty;
+    NdefRec* rec;
+
+    TEST_BYTES_SET(uri, test_uri_rec);
+    TEST_BYTES_SET(text, test_text_rec);
+    empty.bytes = NULL;
+    empty.size = 0;
+
+    ndef_rec_unref(ndef_parse_cache_rec_new(cache, &uri, 0));
+    ndef_rec_unref(ndef_parse_cache_rec_new(cache, &text, 0));
+    test_check_stats(cache, 0, 2, 2);
+
+    /* Touch the URI, then the empty message evicts the text */
+    ndef_rec_unref(ndef_parse_cache_rec_new(cache, &uri, 0));
+    rec = ndef_parse_cache_rec_new(cache, &empty, 0);
+    g_assert(rec);
+    g_assert(!rec->raw.size);
+    ndef_rec_unref(rec);
+    test_check_stats(cache, 1, 3, 2);
+
+    ndef_rec_unref(ndef_parse_cache_rec_new(cache, &uri, 0));
+    test_check_stats(cache, 2, 3, 2);
+    rec = ndef_parse_cache_rec_new(cache, &text, 0);
+    g_assert(NDEF_IS_REC_T(rec));
+    g_assert_cmpstr(NDEF_REC_T(rec)->text, == ,"hi");
+    ndef_rec_unref(rec);
+    test_check_stats(cache, 2, 4, 2);
+
+    /* Entries are released together with the cache */
+    ndef_parse_cache_free(cache);
+}
+
+/*==========================================================================*
+ * tlv
+ *==========================================================================*/
+
+static
+void
+test_tlv(
+    void)
+{
+    static const guint8 tlv[] = {
+        TLV_NDEF_MESSAGE, /* Value type */
+        0x04,             /* Value length */
+        0xd1,             /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,             /* Length of the record type */
+        0x00,             /* Length of the record payload */
+        'x',              /* Record type: 'x' */
+        TLV_TERMINATOR    /* Terminator record */
+    };
+    NdefParseCache* cache = ndef_parse_cache_new(0);
+    GUtilData block, value;
+    NdefRec* rec1;
+    NdefRec* rec2;
+
+    TEST_BYTES_SET(block, tlv);
+    rec1 = ndef_parse_cache_rec_new_from_tlv(cache, &block, 0);
+    rec2 = ndef_parse_cache_rec_new_from_tlv(cache, &block, 0);
+    g_assert(rec1);
+    g_assert(rec1 == rec2);
+    ndef_rec_unref(rec2);
+    test_check_stats(cache, 1, 1, 1);
+
+    /* Bare NDEF and TLV are cached separately */
+    value.bytes = tlv + 2;
+    value.size = 4;
+    rec2 = ndef_parse_cache_rec_new(cache, &value, 0);
+    g_assert(rec2);
+    g_assert(rec1 != rec2);
+    test_check_stats(cache, 1, 2, 2);
+    ndef_rec_unref(rec1);
+    ndef_rec_unref(rec2);
+    ndef_parse_cache_free(cache);
+}
+
+/*==========================================================================*
+ * threads
+ *==========================================================================*/
+
+#define TEST_THREADS (4)
+#define TEST_THREAD_LOOPS (1000)
+
+static
+gpointer
+test_threads_proc(
+    gpointer cache)
+{
+    GUtilData uri, text;
+    guint i;
+
+    TEST_BYTES_SET(uri, test_uri_rec);
+    TEST_BYTES_SET(text, test_text_rec);
+    for (i = 0; i < TEST_THREAD_LOOPS; i++) {
+        NdefRec* rec = ndef_parse_cache_rec_new(cache, (i & 1) ? &uri :
+            &text, NDEF_PARSE_FLAGS_NONE);
+
+        g_assert(NDEF_IS_REC_U(rec) || NDEF_IS_REC_T(rec));
+        ndef_rec_unref(rec);
+        if (!(i % 100)) {
+            ndef_parse_cache_clear(cache);
+        }
+    }
+    return NULL;
+}
+
+static
+void
+test_threads(
+    void)
+{
+    NdefParseCache* cache = ndef_parse_cache_new(1);
+    GThread* threads[TEST_THREADS];
+    NdefParseCacheStats stats;
+    guint i;
+
+    for (i = 0; i < TEST_THREADS; i++) {
+        threads[i] = g_thread_new("test", test_threads_proc, cache);
+    }
+    for (i = 0; i < TEST_THREADS; i++) {
+        g_thread_join(threads[i]);
+    }
+    ndef_parse_cache_get_stats(cache, &stats);
+    g_assert_cmpuint(stats.hits + stats.misses, == ,
+        TEST_THREADS * TEST_THREAD_LOOPS);
+    g_assert_cmpuint(stats.entries, <= ,1);
+    ndef_parse_cache_free(cache);
+}
+
+/*==========================================================================*
+ * Common
+ *==========================================================================*/
+
+#define TEST_(t) "/ndef_cache/" t
+
+int main(int argc, char* argv[])
+{
+    G_GNUC_BEGIN_IGNORE_DEPRECATIONS;
+    g_type_init();
+    G_GNUC_END_IGNORE_DEPRECATIONS;
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func(TEST_("null"), test_null);
+    g_test_add_func(TEST_("basic"), test_basic);
+    g_test_add_func(TEST_("lru"), test_lru);
+    g_test_add_func(TEST_("tlv"), test_tlv);
+    g_test_add_func(TEST_("threads"), test_threads);
+    test_init(&test_opt, argc, argv);
+    return g_test_run();
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,586 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "test_common.h"
+
+#include "ndef_context.h"
+#include "ndef_tlv.h"
+
+#include <unistd.h>
+
+static TestOpt test_opt;
+
+static const guint8 test_uri_rec[] = {
+    0xd1,           /* NDEF record header (MB,ME,SR,TNF=0x01) */
+    0x01,           /* Length of the record type */
+    0x0a,           /* Length of the record payload */
+    'U',            /* Record type: 'U' (URI) */
+    0x02,           /* "https://www." */
+    'j', 'o', 'l', 'l', 'a', '.', 'c', 'o', 'm'
+};
+
+#define TEST_URI "https://www.jolla.com"
+
+/*==========================================================================*
+ * null
+ *==========================================================================*/
+
+static
+void
+test_null(
+    void)
+{
+    NdefParseContext* ctx = ndef_parse_context_new(0);
+    GUtilData data;
+    NdefRec* rec;
+
+    /* NULL tolerance */
+    ndef_parse_context_free(NULL);
+    ndef_parse_context_reset(NULL);
+    g_assert(!ndef_parse_context_rec_new(NULL, NULL, 0));
+    g_assert(!ndef_parse_context_rec_new(ctx, NULL, 0));
+    g_assert(!ndef_parse_context_rec_new_from_tlv(NULL, NULL, 0));
+    g_assert(!ndef_parse_context_rec_new_from_tlv(ctx, NULL, 0));
+
+    /* Context is optional */
+    TEST_BYTES_SET(data, test_uri_rec);
+    rec = ndef_parse_context_rec_new(NULL, &data, NDEF_PARSE_FLAGS_NONE);
+    g_assert(NDEF_IS_REC_U(rec));
+    g_assert_cmpstr(NDEF_REC_U(rec)->uri, == ,TEST_URI);
+    ndef_rec_unref(rec);
+    ndef_parse_context_free(ctx);
+}
+
+/*==========================================================================*
+ * basic
+ *==========================================================================*/
+
+static
+void
+test_basic(
+    void)
+{
+    NdefParseContext* ctx = ndef_parse_context_new(0);
+    GUtilData data;
+    NdefRec* rec1;
+    NdefRec* rec2;
+    const char* uri1;
+    const char* uri2;
+
+    TEST_BYTES_SET(data, test_uri_rec);
+    rec1 = ndef_parse_context_rec_new(ctx, &data, NDEF_PARSE_FLAGS_NONE);
+    rec2 = ndef_parse_context_rec_new(ctx, &data, NDEF_PARSE_FLAGS_NONE);
+    g_assert(NDEF_IS_REC_U(rec1));
+    g_assert(NDEF_IS_REC_U(rec2));
+    uri1 = NDEF_REC_U(rec1)->uri;
+    uri2 = NDEF_REC_U(rec2)->uri;
+    g_assert_cmpstr(uri1, == ,TEST_URI);
+    g_assert_cmpstr(uri2, == ,TEST_URI);
+
+    /* The raw data is followed by the URI, then goes the next record */
+    g_assert(rec1->raw.bytes != data.bytes);
+    g_assert((const guint8*)uri1 == rec1->raw.bytes + rec1->raw.size);
+    g_assert((const guint8*)uri2 == rec2->raw.bytes + rec2->raw.size);
+    g_assert(rec2->raw.bytes > (const guint8*)uri1);
+    g_assert(rec2->raw.bytes < (const guint8*)uri1 + 32);
+
+    /* Empty block */
+    data.size = 0;
+    ndef_rec_unref(rec1);
+    rec1 = ndef_parse_context_rec_new(ctx, &data, NDEF_PARSE_FLAGS_NONE);
+    g_assert(rec1);
+    g_assert(!rec1->raw.size);
+    ndef_rec_unref(rec1);
+
+    ndef_rec_unref(rec2);
+    ndef_parse_context_free(ctx);
+}
+
+/*==========================================================================*
+ * reuse
+ *==========================================================================*/
+
+static
+void
+test_reuse(
+    void)
+{
+    NdefParseContext* ctx = ndef_parse_context_new(64);
+    GUtilData data;
+    NdefRec* rec;
+    const guint8* ptr;
+
+    TEST_BYTES_SET(data, test_uri_rec);
+    rec = ndef_parse_context_rec_new(ctx, &data, NDEF_PARSE_FLAGS_NONE);
+    ptr = rec->raw.bytes;
+    ndef_rec_unref(rec);
+
+    /* The chunk is rewound once it's no longer in use */
+    rec = ndef_parse_context_rec_new(ctx, &data, NDEF_PARSE_FLAGS_NONE);
+    g_assert(rec->raw.bytes == ptr);
+    ndef_rec_unref(rec);
+
+    /* And reused after reset */
+    ndef_parse_context_reset(ctx);
+    rec = ndef_parse_context_rec_new(ctx, &data, NDEF_PARSE_FLAGS_NONE);
+    g_assert(rec->raw.bytes == ptr);
+    ndef_rec_unref(rec);
+    ndef_parse_context_free(ctx);
+}
+
+/*==========================================================================*
+ * reset
+ *==========================================================================*/
+
+static
+void
+test_reset(
+    void)
+{
+    NdefParseContext* ctx = ndef_parse_context_new(64);
+    GUtilData data;
+    NdefRec* rec[4];
+    guint i;
+
+    /* More than fits into one chunk */
+    TEST_BYTES_SET(data, test_uri_rec);
+    for (i = 0; i < G_N_ELEMENTS(rec); i++) {
+        rec[i] = ndef_parse_context_rec_new(ctx, &data,
+            NDEF_PARSE_FLAGS_NONE);
+        g_assert(NDEF_IS_REC_U(rec[i]));
+    }
+
+    /* Records survive the reset */
+    ndef_parse_context_reset(ctx);
+    for (i = 0; i < G_N_ELEMENTS(rec); i++) {
+        g_assert_cmpstr(NDEF_REC_U(rec[i])->uri, == ,TEST_URI);
+    }
+
+    /* And the context itself */
+    ndef_parse_context_free(ctx);
+    for (i = 0; i < G_N_ELEMENTS(rec); i++) {
+        g_assert_cmpstr(NDEF_REC_U(rec[i])->uri, == ,TEST_URI);
+        ndef_rec_unref(rec[i]);
+    }
+}
+
+/*==========================================================================*
+ * reset_threads
+ *==========================================================================*/
+
+#define TEST_RESET_RECS (16)
+#define TEST_RESET_LOOPS (200)
+
+static
+gpointer
+test_reset_threads_proc(
+    gpointer data)
+{
+    NdefRec** rec = data;
+    guint i;
+
+    for (i = 0; i < TEST_RESET_RECS; i++) {
+        g_assert_cmpstr(NDEF_REC_U(rec[i])->uri, == ,TEST_URI);
+        ndef_rec_unref(rec[i]);
+    }
+    return NULL;
+}
+
+static
+void
+test_reset_threads(
+    void)
+{
+    NdefParseContext* ctx = ndef_parse_context_new(64);
+    NdefRec* rec[TEST_RESET_RECS];
+    GUtilData data;
+    guint i, k;
+
+    /* Records are released by another thread while the context is reset */
+    TEST_BYTES_SET(data, test_uri_rec);
+    for (k = 0; k < TEST_RESET_LOOPS; k++) {
+        GThread* thread;
+
+        for (i = 0; i < TEST_RESET_RECS; i++) {
+            rec[i] = ndef_parse_context_rec_new(ctx, &data,
+                NDEF_PARSE_FLAGS_NONE);
+        }
+        thread = g_thread_new("test", test_reset_threads_proc, rec);
+        ndef_parse_context_reset(ctx);
+        for (i = 0; i < TEST_RESET_RECS; i++) {
+            NdefRec* tmp = ndef_parse_context_rec_new(ctx, &data,
+                NDEF_PARSE_FLAGS_NONE);
+
+            g_assert_cmpstr(NDEF_REC_U(tmp)->uri, == ,TEST_URI);
+            ndef_rec_unref(tmp);
+        }
+        g_thread_join(thread);
+    }
+    ndef_parse_context_free(ctx);
+}
+
+/*==========================================================================*
+ * large
+ *==========================================================================*/
+
+static
+void
+test_large(
+    void)
+{
+    NdefParseContext* ctx = ndef_parse_context_new(16);
+    GUtilData data;
+    NdefRec* rec;
+
+    /* The block is larger than the chunk */
+    TEST_BYTES_SET(data, test_uri_rec);
+    rec = ndef_parse_context_rec_new(ctx, &data, NDEF_PARSE_FLAGS_NONE);
+    g_assert(NDEF_IS_REC_U(rec));
+    g_assert_cmpstr(NDEF_REC_U(rec)->uri, == ,TEST_URI);
+    ndef_parse_context_reset(ctx);
+    ndef_rec_unref(rec);
+
+    rec = ndef_parse_context_rec_new(ctx, &data, NDEF_PARSE_FLAGS_NONE);
+    g_assert_cmpstr(NDEF_REC_U(rec)->uri, == ,TEST_URI);
+    ndef_rec_unref(rec);
+    ndef_parse_context_reset(ctx);
+    ndef_parse_context_free(ctx);
+}
+
+/*==========================================================================*
+ * lazy
+ *==========================================================================*/
+
+static
+void
+test_lazy(
+    void)
+{
+    NdefParseContext* ctx = ndef_parse_context_new(0);
+    GUtilData data;
+    NdefRec* rec;
+
+    TEST_BYTES_SET(data, test_uri_rec);
+    rec = ndef_parse_context_rec_new(ctx, &data, NDEF_PARSE_FLAG_LAZY);
+    g_assert(NDEF_IS_REC_U(rec));
+    g_assert(!NDEF_REC_U(rec)->uri);
+    ndef_parse_context_free(ctx);
+    g_assert_cmpstr(ndef_rec_u_uri(NDEF_REC_U(rec)), == ,TEST_URI);
+    ndef_rec_unref(rec);
+}
+
+/*==========================================================================*
+ * tlv
+ *==========================================================================*/
+
+static
+void
+test_tlv(
+    void)
+{
+    static const guint8 tlv[] = {
+        TLV_NDEF_MESSAGE, /* Value type */
+        0x04,             /* Value length */
+        0xd1,                 /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,                 /* Length of the record type */
+        0x00,                 /* Length of the record payload */
+        'x',                  /* Record type: 'x' */
+        TLV_NDEF_MESSAGE, /* Value type */
+        0x04,             /* Value length */
+        0xd1,                 /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,                 /* Length of the record type */
+        0x00,                 /* Length of the record payload */
+        'y',                  /* Record type: 'y' */
+        TLV_TERMINATOR    /* Terminator record */
+    };
+    NdefParseContext* ctx = ndef_parse_context_new(0);
+    GUtilData data;
+    NdefRec* rec;
+
+    TEST_BYTES_SET(data, tlv);
+    rec = ndef_parse_context_rec_new_from_tlv(ctx, &data,
+        NDEF_PARSE_FLAGS_NONE);
+    g_assert(rec);
+    g_assert(rec->next);
+    g_assert(!rec->next->next);
+    g_assert(rec->raw.bytes != tlv + 2);
+    g_assert_cmpuint(rec->type.bytes[0], == ,'x');
+    g_assert_cmpuint(rec->next->type.bytes[0], == ,'y');
+    ndef_rec_unref(rec);
+
+    /* Without context */
+    rec = ndef_parse_context_rec_new_from_tlv(NULL, &data,
+        NDEF_PARSE_FLAGS_NONE);
+    g_assert(rec);
+    g_assert(rec->next);
+    g_assert(!rec->next->next);
+    ndef_rec_unref(rec);
+    ndef_parse_context_free(ctx);
+}
+
+/*==========================================================================*
+ * batch
+ *==========================================================================*/
+
+#define TEST_BATCH_URI_PREFIX "https://www."
+
+/* Each message is a URI record with a unique URI */
+static
+GUtilData*
+test_batch_new(
+    guint count,
+    gboolean tlv)
+{
+    GUtilData* blocks = g_new(GUtilData, count);
+    guint i;
+
+    for (i = 0; i < count; i++) {
+        char* host = g_strdup_printf("jolla.com/%u", i);
+        const gsize len = strlen(host);
+        const gsize rec_len = 5 + len;
+        const gsize size = rec_len + (tlv ? 3 : 0);
+        guint8* buf = g_malloc(size);
+        guint8* ptr = buf;
+
+        g_assert(rec_len < 0xff);
+        if (tlv) {
+            *ptr++ = TLV_NDEF_MESSAGE;
+            *ptr++ = (guint8)rec_len;
+        }
+        *ptr++ = 0xd1;              /* NDEF record header (MB,ME,SR,TNF=1) */
+        *ptr++ = 0x01;              /* Length of the record type */
+        *ptr++ = (guint8)(len + 1); /* Length of the record payload */
+        *ptr++ = 'U';               /* Record type: 'U' (URI) */
+        *ptr++ = 0x02;              /* "https://www." */
+        memcpy(ptr, host, len);
+        ptr += len;
+        if (tlv) {
+            *ptr++ = TLV_TERMINATOR;
+        }
+        g_assert(ptr == buf + size);
+        blocks[i].bytes = buf;
+        blocks[i].size = size;
+        g_free(host);
+    }
+    return blocks;
+}
+
+static
+void
+test_batch_free(
+    GUtilData* blocks,
+    guint count)
+{
+    guint i;
+
+    for (i = 0; i < count; i++) {
+        g_free((gpointer)blocks[i].bytes);
+    }
+    g_free(blocks);
+}
+
+static
+void
+test_batch_check(
+    NdefRec** recs,
+    guint from,
+    guint to)
+{
+    guint i;
+
+    for (i = from; i < to; i++) {
+        NdefRec* rec = recs[i];
+        char* uri = g_strdup_printf(TEST_BATCH_URI_PREFIX "jolla.com/%u", i);
+
+        g_assert(rec);
+        g_assert(!rec->next);
+        g_assert(NDEF_IS_REC_U(rec));
+        g_assert_cmpstr(ndef_rec_u_uri(NDEF_REC_U(rec)), == ,uri);
+        g_free(uri);
+    }
+}
+
+static
+void
+test_batch_null(
+    void)
+{
+    GUtilData block;
+    NdefRec* rec = NULL;
+
+    TEST_BYTES_SET(block, test_uri_rec);
+    ndef_parse_batch(NULL, &rec, 1, NDEF_PARSE_FLAGS_NONE, 0);
+    ndef_parse_batch(&block, NULL, 1, NDEF_PARSE_FLAGS_NONE, 0);
+    ndef_parse_batch(&block, &rec, 0, NDEF_PARSE_FLAGS_NONE, 0);
+    ndef_parse_batch_tlv(NULL, &rec, 1, NDEF_PARSE_FLAGS_NONE, 0);
+    ndef_parse_batch_tlv(&block, NULL, 1, NDEF_PARSE_FLAGS_NONE, 0);
+    ndef_parse_batch_tlv(&block, &rec, 0, NDEF_PARSE_FLAGS_NONE, 0);
+    g_assert(!rec);
+}
+
+static
+void
+test_batch(
+    void)
+{
+    const guint count = 1000;
+    static const guint threads[] = { 1, 4, 0 };
+    GUtilData* blocks = test_batch_new(count, FALSE);
+    NdefRec** recs = g_new(NdefRec*, count);
+    guint i, k;
+
+    /* Broken message in the middle */
+    blocks[count/2].size--;
+
+    for (k = 0; k < G_N_ELEMENTS(threads); k++) {
+        memset(recs, 0, sizeof(recs[0]) * count);
+        ndef_parse_batch(blocks, recs, count, NDEF_PARSE_FLAGS_NONE,
+            threads[k]);
+        g_assert(!recs[count/2]);
+        test_batch_check(recs, 0, count/2);
+        test_batch_check(recs, count/2 + 1, count);
+        /* Released by another thread than the one which parsed them */
+        for (i = 0; i < count; i++) {
+            ndef_rec_unref(recs[i]);
+        }
+    }
+
+    /* More threads than blocks */
+    ndef_parse_batch(blocks, recs, 2, NDEF_PARSE_FLAG_LAZY, 8);
+    test_batch_check(recs, 0, 2);
+    ndef_rec_unref(recs[0]);
+    ndef_rec_unref(recs[1]);
+
+    g_free(recs);
+    test_batch_free(blocks, count);
+}
+
+static
+void
+test_batch_tlv(
+    void)
+{
+    const guint count = 100;
+    GUtilData* blocks = test_batch_new(count, TRUE);
+    NdefRec** recs = g_new0(NdefRec*, count);
+    guint i;
+
+    ndef_parse_batch_tlv(blocks, recs, count, NDEF_PARSE_FLAGS_NONE, 3);
+    test_batch_check(recs, 0, count);
+    for (i = 0; i < count; i++) {
+        ndef_rec_unref(recs[i]);
+    }
+    g_free(recs);
+    test_batch_free(blocks, count);
+}
+
+/*
+ * Throughput of the batch parser as a function of the number of threads.
+ * Only runs in the perf mode (-m perf).
+ */
+static
+void
+test_batch_perf(
+    void)
+{
+    const guint count = 200000;
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    const guint max_threads = (cpus > 0) ? (guint)cpus : 1;
+    GUtilData* blocks = test_batch_new(count, TRUE);
+    NdefRec** recs = g_new(NdefRec*, count);
+    gdouble base = 0;
+    guint n, i;
+
+    for (n = 1; n <= max_threads; n = (n < max_threads) ?
+        MIN(n * 2, max_threads) : (n + 1)) {
+        gdouble secs, rate;
+
+        g_test_timer_start();
+        ndef_parse_batch_tlv(blocks, recs, count, NDEF_PARSE_FLAGS_NONE, n);
+        secs = g_test_timer_elapsed();
+        rate = count / MAX(secs, 1e-6);
+        if (n == 1) {
+            base = rate;
+        }
+        g_test_maximized_result(rate, "%u thread(s): %.0f messages/sec "
+            "(x%.2f)", n, rate, rate / base);
+        for (i = 0; i < count; i++) {
+            ndef_rec_unref(recs[i]);
+        }
+    }
+    g_free(recs);
+    test_batch_free(blocks, count);
+}
+
+/*==========================================================================*
+ * Common
+ *==========================================================================*/
+
+#define TEST_(t) "/ndef_context/" t
+
+int main(int argc, char* argv[])
+{
+    G_GNUC_BEGIN_IGNORE_DEPRECATIONS;
+    g_type_init();
+    G_GNUC_END_IGNORE_DEPRECATIONS;
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func(TEST_("null"), test_null);
+    g_test_add_func(TEST_("basic"), test_basic);
+    g_test_add_func(TEST_("reuse"), test_reuse);
+    g_test_add_func(TEST_("reset"), test_reset);
+    g_test_add_func(TEST_("reset_threads"), test_reset_threads);
+    g_test_add_func(TEST_("large"), test_large);
+    g_test_add_func(TEST_("lazy"), test_lazy);
+    g_test_add_func(TEST_("tlv"), test_tlv);
+    g_test_add_func(TEST_("batch_null"), test_batch_null);
+    g_test_add_func(TEST_("batch"), test_batch);
+    g_test_add_func(TEST_("batch_tlv"), test_batch_tlv);
+    if (g_test_perf()) {
+        g_test_add_func(TEST_("batch_perf"), test_batch_perf);
+    }
+    test_init(&test_opt, argc, argv);
+    return g_test_run();
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,1472 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "test_common.h"
+
+#include "ndef_msg.h"
+
+#include <gutil_misc.h>
+
+static TestOpt test_opt;
+
+/*==========================================================================*
+ * msg_null
+ *==========================================================================*/
+
+static
+void
+test_msg_null(
+    void)
+{
+    static const guint8 garbage[] = { 0x00 };
+    GUtilData block;
+
+    TEST_BYTES_SET(block, garbage);
+    g_assert(!ndef_msg_new(NULL, NDEF_PARSE_FLAGS_NONE));
+    g_assert(!ndef_msg_new(&block, NDEF_PARSE_FLAGS_NONE));
+    g_assert(!ndef_msg_new_from_tlv(NULL, NDEF_PARSE_FLAGS_NONE));
+    g_assert(!ndef_msg_new_from_rec(NULL));
+    g_assert(!ndef_msg_ref(NULL));
+    g_assert(!ndef_msg_rec_at(NULL, 0));
+    g_assert(!ndef_msg_last(NULL));
+    g_assert_cmpint(ndef_msg_index_of(NULL, NULL), == ,-1);
+    ndef_msg_unref(NULL);
+}
+
+/*==========================================================================*
+ * msg_basic
+ *==========================================================================*/
+
+static
+void
+test_msg_basic(
+    void)
+{
+    static const guint8 data[] = {
+        0x91,           /* NDEF record header (MB,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x00,           /* Length of the record payload */
+        'x',            /* Record type: 'x' */
+        0x11,           /* NDEF record header (SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x00,           /* Length of the record payload */
+        'y',            /* Record type: 'y' */
+        0x51,           /* NDEF record header (ME,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x00,           /* Length of the record payload */
+        'z'             /* Record type: 'z' */
+    };
+    static const guint8 other[] = {
+        0xd1,           /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x00,           /* Length of the record payload */
+        'x'             /* Record type: 'x' */
+    };
+    NdefMsg* msg;
+    NdefMsg* other_msg;
+    GUtilData block;
+    guint i;
+
+    TEST_BYTES_SET(block, data);
+    msg = ndef_msg_new(&block, NDEF_PARSE_FLAGS_NONE);
+    g_assert(msg);
+    g_assert(ndef_msg_ref(msg) == msg);
+    ndef_msg_unref(msg);
+
+    g_assert_cmpuint(msg->count, == ,3);
+    for (i = 0; i < msg->count; i++) {
+        NdefRec* rec = ndef_msg_rec_at(msg, i);
+
+        g_assert(rec == msg->rec[i]);
+        g_assert_cmpuint(rec->type.size, == ,1);
+        g_assert_cmpuint(rec->type.bytes[0], == ,'x' + i);
+        g_assert_cmpint(ndef_msg_index_of(msg, rec), == ,i);
+
+        /* The chain is still there */
+        if (i + 1 < msg->count) {
+            g_assert(rec->next == msg->rec[i + 1]);
+        } else {
+            g_assert(!rec->next);
+        }
+    }
+    g_assert(!ndef_msg_rec_at(msg, msg->count));
+    g_assert(ndef_msg_last(msg) == msg->rec[2]);
+    g_assert(ndef_msg_last(msg)->flags & NDEF_REC_FLAG_LAST);
+
+    /* Record from another message */
+    TEST_BYTES_SET(block, other);
+    other_msg = ndef_msg_new(&block, NDEF_PARSE_FLAGS_NONE);
+    g_assert(other_msg);
+    g_assert_cmpuint(other_msg->count, == ,1);
+    g_assert_cmpint(ndef_msg_index_of(msg, other_msg->rec[0]), == ,-1);
+    g_assert_cmpint(ndef_msg_index_of(msg, NULL), == ,-1);
+    ndef_msg_unref(other_msg);
+
+    /* The same records shared by another message (at other positions) */
+    other_msg = ndef_msg_new_from_rec(msg->rec[1]);
+    g_assert(other_msg);
+    g_assert_cmpuint(other_msg->count, == ,2);
+    g_assert_cmpint(ndef_msg_index_of(other_msg, msg->rec[2]), == ,1);
+    g_assert_cmpint(ndef_msg_index_of(msg, msg->rec[2]), == ,2);
+    g_assert_cmpint(ndef_msg_index_of(msg, msg->rec[1]), == ,1);
+    g_assert_cmpint(ndef_msg_index_of(other_msg, msg->rec[0]), == ,-1);
+    ndef_msg_unref(msg);
+
+    /* The records are still alive */
+    g_assert(ndef_msg_last(other_msg)->flags & NDEF_REC_FLAG_LAST);
+    ndef_msg_unref(other_msg);
+}
+
+/*==========================================================================*
+ * msg_tlv
+ *==========================================================================*/
+
+static
+void
+test_msg_tlv(
+    void)
+{
+    static const guint8 tlv[] = {
+        0x03,           /* NDEF TLV */
+        0x04,           /* Length */
+        0xd1,           /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x00,           /* Length of the record payload */
+        'x',            /* Record type: 'x' */
+        0x03,           /* NDEF TLV */
+        0x04,           /* Length */
+        0xd1,           /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x00,           /* Length of the record payload */
+        'y',            /* Record type: 'y' */
+        0xfe            /* Terminator */
+    };
+    NdefMsg* msg;
+    GUtilData block;
+
+    TEST_BYTES_SET(block, tlv);
+    msg = ndef_msg_new_from_tlv(&block, NDEF_PARSE_FLAGS_NONE);
+    g_assert(msg);
+    g_assert_cmpuint(msg->count, == ,2);
+    g_assert_cmpuint(msg->rec[0]->type.bytes[0], == ,'x');
+    g_assert_cmpuint(msg->rec[1]->type.bytes[0], == ,'y');
+    g_assert_cmpint(ndef_msg_index_of(msg, msg->rec[1]), == ,1);
+    ndef_msg_unref(msg);
+}
+
+/*==========================================================================*
+ * iter_null
+ *==========================================================================*/
+
+static
+void
+test_iter_null(
+    void)
+{
+    NdefRecIter it;
+    NdefRecView view;
+
+    /* NULL tolerance */
+    ndef_rec_iter_init(NULL, NULL);
+    g_assert(!ndef_rec_iter_next(NULL, NULL));
+    g_assert(!ndef_rec_iter_next(NULL, &view));
+    ndef_rec_iter_init(&it, NULL);
+    g_assert(!ndef_rec_iter_next(&it, &view));
+}
+
+/*==========================================================================*
+ * iter_empty
+ *==========================================================================*/
+
+static
+void
+test_iter_empty(
+    void)
+{
+    NdefRecIter it;
+    NdefRecView view;
+    GUtilData block;
+
+    memset(&block, 0, sizeof(block));
+    ndef_rec_iter_init(&it, &block);
+    g_assert(!ndef_rec_iter_next(&it, &view));
+    g_assert(!ndef_rec_iter_next(&it, &view));
+}
+
+/*==========================================================================*
+ * iter_basic
+ *==========================================================================*/
+
+static
+void
+test_iter_basic(
+    void)
+{
+    static const guint8 data[] = {
+        0x99,           /* NDEF record header (MB,SR,IL,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x02,           /* Length of the record payload */
+        0x01,           /* Length of the record ID */
+        'U',            /* Record type: 'U' (URI) */
+        'i',            /* Record ID */
+        0x00, 'x',      /* Payload */
+        0x02,           /* NDEF record header (TNF=0x02) */
+        0x03,           /* Length of the record type */
+        0x00, 0x00, 0x00, 0x01, /* Length of the record payload */
+        'a', '/', 'b',  /* Record type: 'a/b' */
+        0x2a,           /* Payload */
+        0x50,           /* NDEF record header (ME,SR,TNF=0x00) */
+        0x00,           /* Length of the record type */
+        0x00            /* Length of the record payload */
+    };
+    NdefRecIter it;
+    NdefRecView view;
+    GUtilData block;
+
+    TEST_BYTES_SET(block, data);
+    ndef_rec_iter_init(&it, &block);
+
+    g_assert(ndef_rec_iter_next(&it, &view));
+    g_assert_cmpint(view.tnf, == ,NDEF_TNF_WELL_KNOWN);
+    g_assert_cmpint(view.flags, == ,NDEF_REC_FLAG_FIRST);
+    g_assert(view.raw.bytes == data);
+    g_assert_cmpuint(view.raw.size, == ,8);
+    g_assert(view.type.bytes == data + 4);
+    g_assert_cmpuint(view.type.size, == ,1);
+    g_assert(view.id.bytes == data + 5);
+    g_assert_cmpuint(view.id.size, == ,1);
+    g_assert(view.payload.bytes == data + 6);
+    g_assert_cmpuint(view.payload.size, == ,2);
+
+    g_assert(ndef_rec_iter_next(&it, &view));
+    g_assert_cmpint(view.tnf, == ,NDEF_TNF_MEDIA_TYPE);
+    g_assert_cmpint(view.flags, == ,NDEF_REC_FLAGS_NONE);
+    g_assert(view.raw.bytes == data + 8);
+    g_assert_cmpuint(view.raw.size, == ,10);
+    g_assert(view.type.bytes == data + 14);
+    g_assert_cmpuint(view.type.size, == ,3);
+    g_assert(!view.id.bytes);
+    g_assert(!view.id.size);
+    g_assert(view.payload.bytes == data + 17);
+    g_assert_cmpuint(view.payload.size, == ,1);
+
+    g_assert(ndef_rec_iter_next(&it, &view));
+    g_assert_cmpint(view.tnf, == ,NDEF_TNF_EMPTY);
+    g_assert_cmpint(view.flags, == ,NDEF_REC_FLAG_LAST);
+    g_assert(view.raw.bytes == data + 18);
+    g_assert_cmpuint(view.raw.size, == ,3);
+    g_assert(!view.type.size);
+    g_assert(!view.id.size);
+    g_assert(!view.payload.bytes);
+    g_assert(!view.payload.size);
+
+    g_assert(!ndef_rec_iter_next(&it, &view));
+    g_assert(!ndef_rec_iter_next(&it, &view));
+
+    /* View is optional */
+    ndef_rec_iter_init(&it, &block);
+    g_assert(ndef_rec_iter_next(&it, NULL));
+    g_assert(ndef_rec_iter_next(&it, NULL));
+    g_assert(ndef_rec_iter_next(&it, NULL));
+    g_assert(!ndef_rec_iter_next(&it, NULL));
+}
+
+/*==========================================================================*
+ * iter_chunked
+ *==========================================================================*/
+
+static
+void
+test_iter_chunked(
+    void)
+{
+    static const guint8 data[] = {
+        0xb1,           /* NDEF record header (MB,CF,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x01,           /* Length of the record payload */
+        'x',            /* Record type: 'x' */
+        0x01,           /* Payload */
+        0x56,           /* NDEF record header (ME,SR,TNF=0x06) */
+        0x00,           /* Length of the record type */
+        0x01,           /* Length of the record payload */
+        0x02,           /* Payload */
+    };
+    static const guint8 data2[] = {
+        0xb1,           /* NDEF record header (MB,CF,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x01,           /* Length of the record payload */
+        'x',            /* Record type: 'x' */
+        0x01,           /* Payload */
+        0x36,           /* NDEF record header (CF,SR,TNF=0x06) */
+        0x00,           /* Length of the record type */
+        0x01,           /* Length of the record payload */
+        0x02,           /* Payload */
+        0x16,           /* NDEF record header (SR,TNF=0x06) */
+        0x00,           /* Length of the record type */
+        0x01,           /* Length of the record payload */
+        0x03,           /* Payload */
+        0x51,           /* NDEF record header (ME,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x01,           /* Length of the record payload */
+        'y',            /* Record type: 'y' */
+        0x04            /* Payload */
+    };
+    NdefRecIter it;
+    NdefRecView view;
+    GUtilData block;
+
+    /* Chunked records are skipped, including the terminating chunk */
+    TEST_BYTES_SET(block, data);
+    ndef_rec_iter_init(&it, &block);
+    g_assert(!ndef_rec_iter_next(&it, &view));
+    g_assert(!ndef_rec_iter_next(&it, &view));
+
+    /* The record following the chunks is still there */
+    TEST_BYTES_SET(block, data2);
+    ndef_rec_iter_init(&it, &block);
+    g_assert(ndef_rec_iter_next(&it, &view));
+    g_assert(view.raw.bytes == data2 + 13);
+    g_assert_cmpint(view.tnf, == ,NDEF_TNF_WELL_KNOWN);
+    g_assert_cmpint(view.flags, == ,NDEF_REC_FLAG_LAST);
+    g_assert_cmpuint(view.type.size, == ,1);
+    g_assert_cmpuint(view.type.bytes[0], == ,'y');
+    g_assert_cmpuint(view.payload.size, == ,1);
+    g_assert_cmpuint(view.payload.bytes[0], == ,0x04);
+    g_assert(!ndef_rec_iter_next(&it, &view));
+
+    /* Reinitializing resets the chunk state */
+    TEST_BYTES_SET(block, data2);
+    ndef_rec_iter_init(&it, &block);
+    g_assert(ndef_rec_iter_next(&it, NULL));
+    g_assert(!ndef_rec_iter_next(&it, NULL));
+}
+
+/*==========================================================================*
+ * iter_stray
+ *==========================================================================*/
+
+static
+void
+test_iter_stray(
+    void)
+{
+    static const guint8 data[] = {
+        0x91,           /* NDEF record header (MB,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x00,           /* Length of the record payload */
+        'x',            /* Record type: 'x' */
+        0x16,           /* NDEF record header (SR,TNF=0x06) */
+        0x00,           /* Length of the record type */
+        0x01,           /* Length of the record payload */
+        0x01,           /* Payload */
+        0x36,           /* NDEF record header (CF,SR,TNF=0x06) */
+        0x00,           /* Length of the record type */
+        0x01,           /* Length of the record payload */
+        0x02,           /* Payload */
+        0x11,           /* NDEF record header (SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x00,           /* Length of the record payload */
+        'y',            /* Record type: 'y' */
+        0x31,           /* NDEF record header (CF,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x01,           /* Length of the record payload */
+        'z',            /* Record type: 'z' */
+        0x03,           /* Payload */
+        0x51,           /* NDEF record header (ME,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x01,           /* Length of the record payload */
+        'w',            /* Record type: 'w' (not a valid chunk) */
+        0x04            /* Payload */
+    };
+    static const guint8 expected_types[] = { 'x', 'y', 'w' };
+    NdefRecIter it;
+    NdefRecView view;
+    GUtilData block;
+    NdefRec* chain;
+    NdefRec* rec;
+    guint i;
+
+    /* Iterator yields the same records as ndef_rec_new() */
+    TEST_BYTES_SET(block, data);
+    chain = ndef_rec_new(&block);
+    ndef_rec_iter_init(&it, &block);
+    for (rec = chain, i = 0; rec; rec = rec->next, i++) {
+        g_assert(ndef_rec_iter_next(&it, &view));
+        g_assert_cmpuint(i, < ,sizeof(expected_types));
+        g_assert_cmpuint(view.type.size, == ,1);
+        g_assert_cmpuint(view.type.bytes[0], == ,expected_types[i]);
+        g_assert_cmpint(view.tnf, == ,rec->tnf);
+        g_assert_cmpuint(view.raw.size, == ,rec->raw.size);
+        g_assert(!memcmp(view.raw.bytes, rec->raw.bytes, rec->raw.size));
+    }
+    g_assert_cmpuint(i, == ,sizeof(expected_types));
+    g_assert(!ndef_rec_iter_next(&it, &view));
+    ndef_rec_unref(chain);
+}
+
+/*==========================================================================*
+ * iter_garbage
+ *==========================================================================*/
+
+static
+void
+test_iter_garbage(
+    void)
+{
+    static const guint8 data[] = {
+        0x91,           /* NDEF record header (MB,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x00,           /* Length of the record payload */
+        'x',            /* Record type: 'x' */
+        0x51,           /* NDEF record header (ME,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x05,           /* Length of the record payload (too long) */
+        'y',            /* Record type: 'y' */
+        0x00
+    };
+    NdefRecIter it;
+    NdefRecView view;
+    GUtilData block;
+
+    TEST_BYTES_SET(block, data);
+    ndef_rec_iter_init(&it, &block);
+    g_assert(ndef_rec_iter_next(&it, &view));
+    g_assert(view.raw.bytes == data);
+    g_assert_cmpuint(view.raw.size, == ,4);
+    g_assert(!ndef_rec_iter_next(&it, &view));
+    g_assert(!ndef_rec_iter_next(&it, &view));
+}
+
+/*==========================================================================*
+ * check_null
+ *==========================================================================*/
+
+static
+void
+test_check_null(
+    void)
+{
+    static const guint8 data[] = { 0x00 };
+    NdefMsgInfo info;
+    GUtilData block;
+
+    g_assert_cmpuint(ndef_msg_check(NULL, NULL), == ,0);
+    memset(&info, 0xaa, sizeof(info));
+    g_assert_cmpuint(ndef_msg_check(NULL, &info), == ,0);
+    g_assert_cmpuint(info.count, == ,0);
+    g_assert_cmpuint(info.size, == ,0);
+    g_assert_cmpuint(info.flags, == ,NDEF_MSG_CHECK_FLAGS_NONE);
+
+    /* Empty block */
+    block.bytes = data;
+    block.size = 0;
+    g_assert_cmpuint(ndef_msg_check(&block, &info), == ,0);
+    g_assert_cmpuint(info.count, == ,0);
+    g_assert_cmpuint(info.flags, == ,NDEF_MSG_CHECK_FLAGS_NONE);
+}
+
+/*==========================================================================*
+ * check_basic
+ *==========================================================================*/
+
+static
+void
+test_check_basic(
+    void)
+{
+    static const guint8 data[] = {
+        0x91,           /* NDEF record header (MB,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x00,           /* Length of the record payload */
+        'x',            /* Record type: 'x' */
+        0x19,           /* NDEF record header (SR,IL,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x01,           /* Length of the record payload */
+        0x01,           /* Length of the id */
+        'y',            /* Record type: 'y' */
+        'i',            /* Id */
+        0x00,           /* Payload */
+        0x42,                   /* NDEF record header (ME,TNF=0x02) */
+        0x03,                   /* Length of the record type */
+        0x00, 0x00, 0x00, 0x01, /* Length of the record payload */
+        'a', '/', 'b',          /* Record type */
+        0x00,                   /* Payload */
+        /* Ignored */
+        0x00, 0x00
+    };
+    NdefMsgInfo info;
+    GUtilData block;
+
+    TEST_BYTES_SET(block, data);
+    g_assert_cmpuint(ndef_msg_check(&block, &info), == ,sizeof(data) - 2);
+    g_assert_cmpuint(info.count, == ,3);
+    g_assert_cmpuint(info.size, == ,sizeof(data) - 2);
+    g_assert_cmpuint(info.flags, == ,NDEF_MSG_CHECK_FLAGS_NONE);
+    g_assert_cmpuint(ndef_msg_check(&block, NULL), == ,sizeof(data) - 2);
+}
+
+/*==========================================================================*
+ * check_chunked
+ *==========================================================================*/
+
+static
+void
+test_check_chunked(
+    void)
+{
+    static const guint8 data[] = {
+        0xb1,           /* NDEF record header (MB,CF,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x01,           /* Length of the record payload */
+        'x',            /* Record type: 'x' */
+        0x01,           /* Payload */
+        0x36,           /* NDEF record header (CF,SR,TNF=0x06) */
+        0x00,           /* Length of the record type */
+        0x01,           /* Length of the record payload */
+        0x02,           /* Payload */
+        0x16,           /* NDEF record header (SR,TNF=0x06) */
+        0x00,           /* Length of the record type */
+        0x01,           /* Length of the record payload */
+        0x03,           /* Payload */
+        0x51,           /* NDEF record header (ME,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x00,           /* Length of the record payload */
+        'y'             /* Record type: 'y' */
+    };
+    NdefMsgInfo info;
+    GUtilData block;
+
+    TEST_BYTES_SET(block, data);
+    g_assert_cmpuint(ndef_msg_check(&block, &info), == ,sizeof(data));
+    g_assert_cmpuint(info.count, == ,2);
+    g_assert_cmpuint(info.size, == ,sizeof(data));
+    g_assert_cmpuint(info.flags, == ,NDEF_MSG_CHECK_FLAG_CHUNKED);
+}
+
+/*==========================================================================*
+ * check_broken
+ *==========================================================================*/
+
+typedef struct test_check_broken_data {
+    const char* name;
+    GUtilData data;
+    guint count;
+    gsize size;
+    NDEF_MSG_CHECK_FLAGS flags;
+} TestCheckBrokenData;
+
+static const guint8 test_check_no_mb[] = {
+    0x51,           /* NDEF record header (ME,SR,TNF=0x01) */
+    0x01,           /* Length of the record type */
+    0x00,           /* Length of the record payload */
+    'x'             /* Record type: 'x' */
+};
+static const guint8 test_check_extra_mb[] = {
+    0x91,           /* NDEF record header (MB,SR,TNF=0x01) */
+    0x01,           /* Length of the record type */
+    0x00,           /* Length of the record payload */
+    'x',            /* Record type: 'x' */
+    0xd1,           /* NDEF record header (MB,ME,SR,TNF=0x01) */
+    0x01,           /* Length of the record type */
+    0x00,           /* Length of the record payload */
+    'y'             /* Record type: 'y' */
+};
+static const guint8 test_check_no_me[] = {
+    0x91,           /* NDEF record header (MB,SR,TNF=0x01) */
+    0x01,           /* Length of the record type */
+    0x00,           /* Length of the record payload */
+    'x'             /* Record type: 'x' */
+};
+static const guint8 test_check_unterminated[] = {
+    0xb1,           /* NDEF record header (MB,CF,SR,TNF=0x01) */
+    0x01,           /* Length of the record type */
+    0x00,           /* Length of the record payload */
+    'x'             /* Record type: 'x' */
+};
+static const guint8 test_check_me_in_chunk[] = {
+    0xf1,           /* NDEF record header (MB,ME,CF,SR,TNF=0x01) */
+    0x01,           /* Length of the record type */
+    0x00,           /* Length of the record payload */
+    'x',            /* Record type: 'x' */
+    0x16,           /* NDEF record header (SR,TNF=0x06) */
+    0x00,           /* Length of the record type */
+    0x00            /* Length of the record payload */
+};
+static const guint8 test_check_chunk_type[] = {
+    0xb1,           /* NDEF record header (MB,CF,SR,TNF=0x01) */
+    0x01,           /* Length of the record type */
+    0x00,           /* Length of the record payload */
+    'x',            /* Record type: 'x' */
+    0x56,           /* NDEF record header (ME,SR,TNF=0x06) */
+    0x01,           /* Length of the record type */
+    0x00,           /* Length of the record payload */
+    'x'             /* Record type: 'x' */
+};
+static const guint8 test_check_stray_chunk[] = {
+    0xd6,           /* NDEF record header (MB,ME,SR,TNF=0x06) */
+    0x00,           /* Length of the record type */
+    0x00            /* Length of the record payload */
+};
+static const guint8 test_check_garbage[] = {
+    0x91,           /* NDEF record header (MB,SR,TNF=0x01) */
+    0x01,           /* Length of the record type */
+    0x00,           /* Length of the record payload */
+    'x',            /* Record type: 'x' */
+    0x51,           /* NDEF record header (ME,SR,TNF=0x01) */
+    0x01,           /* Length of the record type */
+    0x05,           /* Length of the record payload (too long) */
+    'y'             /* Record type: 'y' */
+};
+static const guint8 test_check_truncated[] = {
+    0x91,           /* NDEF record header (MB,SR,TNF=0x01) */
+    0x01,           /* Length of the record type */
+    0x00,           /* Length of the record payload */
+    'x',            /* Record type: 'x' */
+    0x49,           /* NDEF record header (ME,IL,TNF=0x01) */
+    0x01,           /* Length of the record type */
+    0x00,           /* Truncated payload length */
+};
+
+static const TestCheckBrokenData test_check_broken_data[] = {
+    {
+        "no_mb", { TEST_ARRAY_AND_SIZE(test_check_no_mb) },
+        1, sizeof(test_check_no_mb), NDEF_MSG_CHECK_FLAG_BAD_MB
+    },{
+        "extra_mb", { TEST_ARRAY_AND_SIZE(test_check_extra_mb) },
+        2, sizeof(test_check_extra_mb), NDEF_MSG_CHECK_FLAG_BAD_MB
+    },{
+        "no_me", { TEST_ARRAY_AND_SIZE(test_check_no_me) },
+        1, sizeof(test_check_no_me), NDEF_MSG_CHECK_FLAG_BAD_ME
+    },{
+        "unterminated", { TEST_ARRAY_AND_SIZE(test_check_unterminated) },
+        1, sizeof(test_check_unterminated), NDEF_MSG_CHECK_FLAG_CHUNKED |
+        NDEF_MSG_CHECK_FLAG_BAD_CHUNK | NDEF_MSG_CHECK_FLAG_BAD_ME
+    },{
+        "me_in_chunk", { TEST_ARRAY_AND_SIZE(test_check_me_in_chunk) },
+        1, 4, NDEF_MSG_CHECK_FLAG_CHUNKED | NDEF_MSG_CHECK_FLAG_BAD_CHUNK
+    },{
+        "chunk_type", { TEST_ARRAY_AND_SIZE(test_check_chunk_type) },
+        1, sizeof(test_check_chunk_type), NDEF_MSG_CHECK_FLAG_CHUNKED |
+        NDEF_MSG_CHECK_FLAG_BAD_CHUNK
+    },{
+        "stray_chunk", { TEST_ARRAY_AND_SIZE(test_check_stray_chunk) },
+        0, sizeof(test_check_stray_chunk), NDEF_MSG_CHECK_FLAG_BAD_CHUNK
+    },{
+        "garbage", { TEST_ARRAY_AND_SIZE(test_check_garbage) },
+        1, 4, NDEF_MSG_CHECK_FLAG_GARBAGE | NDEF_MSG_CHECK_FLAG_BAD_ME
+    },{
+        "truncated", { TEST_ARRAY_AND_SIZE(test_check_truncated) },
+        1, 4, NDEF_MSG_CHECK_FLAG_GARBAGE | NDEF_MSG_CHECK_FLAG_BAD_ME
+    }
+};
+
+static
+void
+test_check_broken(
+    gconstpointer test_data)
+{
+    const TestCheckBrokenData* test = test_data;
+    NdefMsgInfo info;
+
+    g_assert_cmpuint(ndef_msg_check(&test->data, &info), == ,0);
+    g_assert_cmpuint(info.count, == ,test->count);
+    g_assert_cmpuint(info.size, == ,test->size);
+    g_assert_cmpuint(info.flags, == ,test->flags);
+}
+
+/*==========================================================================*
+ * builder_null
+ *==========================================================================*/
+
+static
+void
+test_builder_null(
+    void)
+{
+    NdefMsgBuilder* builder = ndef_msg_builder_new();
+    static const guint8 big[256] = { 0 };
+    GUtilData data;
+
+    TEST_BYTES_SET(data, big);
+    ndef_msg_builder_free(NULL);
+    g_assert(!ndef_msg_builder_add(NULL, NDEF_TNF_EMPTY, NULL, NULL, NULL));
+    g_assert(!ndef_msg_builder_add_rec(NULL, NULL));
+    g_assert(!ndef_msg_builder_add_rec(builder, NULL));
+    g_assert(!ndef_msg_builder_bytes(NULL));
+    g_assert(!ndef_msg_builder_build(NULL));
+    g_assert_cmpuint(ndef_msg_builder_size(NULL), == ,0);
+
+    /* Invalid records */
+    g_assert(!ndef_msg_builder_add(builder, (NDEF_TNF)(NDEF_TNF_MAX + 1),
+        NULL, NULL, NULL));
+    g_assert(!ndef_msg_builder_add(builder, NDEF_TNF_EMPTY, NULL, NULL,
+        &data));
+    g_assert(!ndef_msg_builder_add(builder, NDEF_TNF_WELL_KNOWN, &data,
+        NULL, NULL));
+    g_assert(!ndef_msg_builder_add(builder, NDEF_TNF_WELL_KNOWN, NULL,
+        &data, NULL));
+    g_assert_cmpuint(ndef_msg_builder_size(builder), == ,0);
+
+    ndef_msg_builder_free(builder);
+}
+
+/*==========================================================================*
+ * builder_basic
+ *==========================================================================*/
+
+static
+void
+test_builder_basic(
+    void)
+{
+    static const guint8 expected_head[] = {
+        0x91,           /* NDEF record header (MB,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x00,           /* Length of the record payload */
+        'x',            /* Record type: 'x' */
+        0x19,           /* NDEF record header (SR,IL,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x01,           /* Length of the record payload */
+        0x01,           /* Length of the id */
+        'y',            /* Record type: 'y' */
+        'i',            /* Id */
+        0x00,           /* Payload */
+        0x42,                   /* NDEF record header (ME,TNF=0x02) */
+        0x03,                   /* Length of the record type */
+        0x00, 0x00, 0x01, 0x00, /* Length of the record payload */
+        'a', '/', 'b'           /* Record type */
+    };
+    static const guint8 zero[] = { 0x00 };
+    static const guint8 big[256] = { 0 };
+    NdefMsgBuilder* builder = ndef_msg_builder_new();
+    GUtilData x, y, i, ab, payload, large;
+    const guint8* buf;
+    GBytes* bytes;
+    NdefRec* rec;
+    NdefRec* r;
+    gsize size;
+
+    gutil_data_from_string(&x, "x");
+    gutil_data_from_string(&y, "y");
+    gutil_data_from_string(&i, "i");
+    gutil_data_from_string(&ab, "a/b");
+    TEST_BYTES_SET(payload, zero);
+    TEST_BYTES_SET(large, big);
+
+    g_assert(ndef_msg_builder_add(builder, NDEF_TNF_WELL_KNOWN, &x, NULL,
+        NULL));
+    g_assert(ndef_msg_builder_add(builder, NDEF_TNF_WELL_KNOWN, &y, &i,
+        &payload));
+    g_assert(ndef_msg_builder_add(builder, NDEF_TNF_MEDIA_TYPE, &ab, NULL,
+        &large));
+    g_assert_cmpuint(ndef_msg_builder_size(builder), == ,
+        sizeof(expected_head) + sizeof(big));
+
+    bytes = ndef_msg_builder_bytes(builder);
+    g_assert_cmpuint(ndef_msg_builder_size(builder), == ,0);
+    buf = g_bytes_get_data(bytes, &size);
+    g_assert_cmpuint(size, == ,sizeof(expected_head) + sizeof(big));
+    g_assert(!memcmp(buf, expected_head, sizeof(expected_head)));
+    g_assert(!memcmp(buf + sizeof(expected_head), big, sizeof(big)));
+    g_bytes_unref(bytes);
+
+    /* The builder is reusable, records point into one buffer */
+    g_assert(ndef_msg_builder_add(builder, NDEF_TNF_WELL_KNOWN, &x, NULL,
+        NULL));
+    g_assert(ndef_msg_builder_add(builder, NDEF_TNF_MEDIA_TYPE, &ab, NULL,
+        &large));
+    rec = ndef_msg_builder_build(builder);
+    g_assert(rec);
+    g_assert_cmpuint(rec->tnf, == ,NDEF_TNF_WELL_KNOWN);
+    g_assert(gutil_data_equal(&rec->type, &x));
+    g_assert_cmpuint(rec->raw.size, == ,4);
+    r = rec->next;
+    g_assert(r);
+    g_assert(!r->next);
+    g_assert_cmpuint(r->tnf, == ,NDEF_TNF_MEDIA_TYPE);
+    g_assert(gutil_data_equal(&r->type, &ab));
+    g_assert(gutil_data_equal(&r->payload, &large));
+    g_assert(r->raw.bytes == rec->raw.bytes + rec->raw.size);
+    ndef_rec_unref(rec);
+    ndef_msg_builder_free(builder);
+}
+
+/*==========================================================================*
+ * builder_rec
+ *==========================================================================*/
+
+static
+void
+test_builder_rec(
+    void)
+{
+    static const guint8 unknown_rec[] = {
+        0xd5,           /* NDEF record header (MB,ME,SR,TNF=0x05) */
+        0x00,           /* Length of the record type */
+        0x02,           /* Length of the record payload */
+        0x01, 0x02      /* Payload */
+    };
+    NdefMsgBuilder* builder = ndef_msg_builder_new();
+    NdefRec* src = NDEF_REC(ndef_rec_t_new("Hello", "en"));
+    NdefRec* rec;
+    GBytes* bytes;
+    GUtilData data;
+    const guint8* buf;
+    gsize size;
+
+    /* The builder holds a reference, the data remains valid */
+    g_assert(ndef_msg_builder_add_rec(builder, src));
+    g_assert(ndef_msg_builder_add_rec(builder, src));
+    g_assert_cmpuint(ndef_msg_builder_size(builder), == ,2 * src->raw.size);
+    ndef_rec_unref(src);
+
+    bytes = ndef_msg_builder_bytes(builder);
+    buf = g_bytes_get_data(bytes, &size);
+    g_assert_cmpuint(size % 2, == ,0);
+    g_assert_cmpuint(buf[0], == ,0x91); /* MB,SR,TNF=0x01 */
+    g_assert_cmpuint(buf[size/2], == ,0x51); /* ME,SR,TNF=0x01 */
+    g_assert(!memcmp(buf + 1, buf + size/2 + 1, size/2 - 1));
+
+    rec = ndef_rec_new_bytes(bytes);
+    g_assert(NDEF_IS_REC_T(rec));
+    g_assert(NDEF_IS_REC_T(rec->next));
+    g_assert_cmpstr(NDEF_REC_T(rec->next)->text, == ,"Hello");
+    g_assert_cmpstr(NDEF_REC_T(rec->next)->lang, == ,"en");
+    ndef_rec_unref(rec);
+    g_bytes_unref(bytes);
+
+    /* Unknown TNF is preserved */
+    TEST_BYTES_SET(data, unknown_rec);
+    src = ndef_rec_new(&data);
+    g_assert(src);
+    g_assert_cmpint(src->tnf, == ,NDEF_TNF_EMPTY);
+    g_assert(ndef_msg_builder_add_rec(builder, src));
+    ndef_rec_unref(src);
+    bytes = ndef_msg_builder_bytes(builder);
+    buf = g_bytes_get_data(bytes, &size);
+    g_assert_cmpuint(size, == ,sizeof(unknown_rec));
+    g_assert(!memcmp(buf, unknown_rec, sizeof(unknown_rec)));
+    g_bytes_unref(bytes);
+
+    /* But the public API only accepts NDEF_TNF values */
+    g_assert(!ndef_msg_builder_add(builder, (NDEF_TNF)0x05, NULL, NULL,
+        &data));
+
+    /* Pending records are released by ndef_msg_builder_free() */
+    src = NDEF_REC(ndef_rec_t_new("Bye", "en"));
+    g_assert(ndef_msg_builder_add_rec(builder, src));
+    ndef_rec_unref(src);
+    ndef_msg_builder_free(builder);
+}
+
+/*==========================================================================*
+ * builder_empty
+ *==========================================================================*/
+
+static
+void
+test_builder_empty(
+    void)
+{
+    static const guint8 expected[] = { 0xd0, 0x00, 0x00 };
+    NdefMsgBuilder* builder = ndef_msg_builder_new();
+    GBytes* bytes = ndef_msg_builder_bytes(builder);
+    const guint8* buf;
+    NdefRec* rec;
+    gsize size;
+
+    /* Nothing was added */
+    g_assert(bytes);
+    g_assert_cmpuint(g_bytes_get_size(bytes), == ,0);
+    g_bytes_unref(bytes);
+
+    /* Which is parsed as an empty NDEF */
+    rec = ndef_msg_builder_build(builder);
+    g_assert(rec);
+    g_assert(!rec->next);
+    g_assert_cmpuint(rec->tnf, == ,NDEF_TNF_EMPTY);
+    ndef_rec_unref(rec);
+
+    /* Single empty record is MB, ME and SR */
+    g_assert(ndef_msg_builder_add(builder, NDEF_TNF_EMPTY, NULL, NULL,
+        NULL));
+    bytes = ndef_msg_builder_bytes(builder);
+    buf = g_bytes_get_data(bytes, &size);
+    g_assert_cmpuint(size, == ,sizeof(expected));
+    g_assert(!memcmp(buf, expected, sizeof(expected)));
+    g_bytes_unref(bytes);
+
+    g_assert(ndef_msg_builder_add(builder, NDEF_TNF_EMPTY, NULL, NULL,
+        NULL));
+    rec = ndef_msg_builder_build(builder);
+    g_assert(rec);
+    g_assert(!rec->next);
+    g_assert_cmpuint(rec->tnf, == ,NDEF_TNF_EMPTY);
+    ndef_rec_unref(rec);
+    ndef_msg_builder_free(builder);
+}
+
+/*==========================================================================*
+ * builder_uri
+ *==========================================================================*/
+
+static
+void
+test_builder_uri(
+    void)
+{
+    static const guint8 expected[] = {
+        0x91,           /* NDEF record header (MB,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x04,           /* Length of the record payload */
+        'U',            /* Record type: 'U' */
+        0x1e,           /* "urn:epc:id:" rather than "urn:" */
+        'f', 'o', 'o',
+        0x51,           /* NDEF record header (ME,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x04,           /* Length of the record payload */
+        'U',            /* Record type: 'U' */
+        0x00,           /* No abbreviation */
+        'f', 'o', 'o'
+    };
+    NdefMsgBuilder* builder = ndef_msg_builder_new();
+    GBytes* bytes;
+    NdefRec* rec;
+
+    g_assert(!ndef_msg_builder_add_uri(NULL, "foo"));
+    g_assert(!ndef_msg_builder_add_uri(builder, NULL));
+    g_assert(ndef_msg_builder_add_uri(builder, "urn:epc:id:foo"));
+    g_assert(ndef_msg_builder_add_uri(builder, "foo"));
+    g_assert_cmpuint(ndef_msg_builder_size(builder), == ,sizeof(expected));
+    bytes = ndef_msg_builder_bytes(builder);
+    g_assert_cmpuint(g_bytes_get_size(bytes), == ,sizeof(expected));
+    g_assert(!memcmp(g_bytes_get_data(bytes, NULL), expected,
+        sizeof(expected)));
+
+    rec = ndef_rec_new_bytes(bytes);
+    g_assert(NDEF_IS_REC_U(rec));
+    g_assert_cmpstr(NDEF_REC_U(rec)->uri, == ,"urn:epc:id:foo");
+    g_assert(NDEF_IS_REC_U(rec->next));
+    g_assert_cmpstr(NDEF_REC_U(rec->next)->uri, == ,"foo");
+    ndef_rec_unref(rec);
+    g_bytes_unref(bytes);
+    ndef_msg_builder_free(builder);
+}
+
+/*==========================================================================*
+ * builder_text
+ *==========================================================================*/
+
+static
+void
+test_builder_text(
+    void)
+{
+    static const guint8 expected_utf8[] = {
+        0xd1,           /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x05,           /* Length of the record payload */
+        'T',            /* Record type: 'T' */
+        0x02,           /* UTF-8, 2 bytes language */
+        'e', 'n',
+        'H', 'i'
+    };
+    static const guint8 expected_utf16[] = {
+        0xd1,           /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x07,           /* Length of the record payload */
+        'T',            /* Record type: 'T' */
+        0x82,           /* UTF-16, 2 bytes language */
+        'j', 'a',
+        0x65, 0xe5,     /* U+65E5 */
+        0x67, 0x2c      /* U+672C */
+    };
+    static const char text_ja[] = "\xe6\x97\xa5\xe6\x9c\xac";
+    static const char text_bom[] = "\xef\xbb\xbf\xef\xbb\xbf";
+    static const char text_smp[] = "\xf0\x9f\x98\x80\xf0\x9f\x98\x80";
+    NdefMsgBuilder* builder = ndef_msg_builder_new();
+    GBytes* bytes;
+    NdefRec* rec;
+
+    g_assert(!ndef_msg_builder_add_text(NULL, "Hi", "en"));
+    g_assert(!ndef_msg_builder_add_text(builder, NULL, "en"));
+    g_assert(!ndef_msg_builder_add_text(builder, "\xff", "en"));
+    g_assert(!ndef_msg_builder_add_text(builder, "Hi",
+        "0123456789012345678901234567890123456789012345678901234567890123"));
+    g_assert_cmpuint(ndef_msg_builder_size(builder), == ,0);
+
+    /* ASCII is shorter in UTF-8 */
+    g_assert(ndef_msg_builder_add_text(builder, "Hi", "en"));
+    bytes = ndef_msg_builder_bytes(builder);
+    g_assert_cmpuint(g_bytes_get_size(bytes), == ,sizeof(expected_utf8));
+    g_assert(!memcmp(g_bytes_get_data(bytes, NULL), expected_utf8,
+        sizeof(expected_utf8)));
+    g_bytes_unref(bytes);
+
+    /* CJK is shorter in UTF-16 */
+    g_assert(ndef_msg_builder_add_text(builder, text_ja, "ja"));
+    bytes = ndef_msg_builder_bytes(builder);
+    g_assert_cmpuint(g_bytes_get_size(bytes), == ,sizeof(expected_utf16));
+    g_assert(!memcmp(g_bytes_get_data(bytes, NULL), expected_utf16,
+        sizeof(expected_utf16)));
+    g_bytes_unref(bytes);
+
+    /* Text starting with U+FEFF needs the BOM and survives the trip */
+    g_assert(ndef_msg_builder_add_text(builder, text_bom, "en"));
+    g_assert(ndef_msg_builder_add_text(builder, text_ja, "ja"));
+    g_assert(ndef_msg_builder_add_text(builder, text_smp, "en"));
+    rec = ndef_msg_builder_build(builder);
+    g_assert(NDEF_IS_REC_T(rec));
+    g_assert_cmpuint(rec->payload.size, == ,1 + 2 + 2 + 4);
+    g_assert_cmpstr(ndef_rec_t_text(NDEF_REC_T(rec)), == ,text_bom);
+    g_assert(NDEF_IS_REC_T(rec->next));
+    g_assert_cmpstr(ndef_rec_t_text(NDEF_REC_T(rec->next)), == ,text_ja);
+    g_assert_cmpstr(ndef_rec_t_lang(NDEF_REC_T(rec->next)), == ,"ja");
+    g_assert(NDEF_IS_REC_T(rec->next->next));
+    g_assert_cmpstr(ndef_rec_t_text(NDEF_REC_T(rec->next->next)), == ,
+        text_smp);
+    ndef_rec_unref(rec);
+    ndef_msg_builder_free(builder);
+}
+
+/*==========================================================================*
+ * builder_tlv
+ *==========================================================================*/
+
+static
+void
+test_builder_tlv(
+    void)
+{
+    static const guint8 expected[] = {
+        TLV_NDEF_MESSAGE, 0x08,
+        0xd1, 0x01, 0x04, 'U', 0x04, 'a', '.', 'b',
+        TLV_TERMINATOR,
+        TLV_NULL
+    };
+    NdefMsgBuilder* builder = ndef_msg_builder_new();
+    NdefTlvParams params;
+    guint8 buf[sizeof(expected) + 1];
+    gsize overflow = 1;
+
+    memset(&params, 0, sizeof(params));
+    params.page_size = 4;
+    g_assert_cmpuint(ndef_msg_builder_tlv_size(NULL, NULL), == ,0);
+    g_assert_cmpuint(ndef_msg_builder_tlv(NULL, NULL, buf, sizeof(buf),
+        &overflow), == ,0);
+    g_assert_cmpuint(overflow, == ,0);
+
+    /* Empty message */
+    g_assert_cmpuint(ndef_msg_builder_tlv_size(builder, NULL), == ,3);
+
+    /* Prediction matches the output */
+    g_assert(ndef_msg_builder_add_uri(builder, "https://a.b"));
+    g_assert_cmpuint(ndef_msg_builder_tlv_size(builder, &params), == ,
+        sizeof(expected));
+
+    /* Doesn't fit, builder remains intact */
+    g_assert_cmpuint(ndef_msg_builder_tlv(builder, &params, buf, 10,
+        &overflow), == ,0);
+    g_assert_cmpuint(overflow, == ,sizeof(expected) - 10);
+    g_assert_cmpuint(ndef_msg_builder_tlv(builder, &params, NULL, 0,
+        &overflow), == ,0);
+    g_assert_cmpuint(overflow, == ,sizeof(expected));
+    g_assert_cmpuint(ndef_msg_builder_size(builder), == ,8);
+
+    /* Fits */
+    memset(buf, 0xaa, sizeof(buf));
+    g_assert_cmpuint(ndef_msg_builder_tlv(builder, &params, buf,
+        sizeof(buf), &overflow), == ,sizeof(expected));
+    g_assert_cmpuint(overflow, == ,0);
+    g_assert(!memcmp(buf, expected, sizeof(expected)));
+    g_assert_cmpuint(buf[sizeof(expected)], == ,0xaa);
+    g_assert_cmpuint(ndef_msg_builder_size(builder), == ,0);
+    ndef_msg_builder_free(builder);
+}
+
+/*==========================================================================*
+ * template_null
+ *==========================================================================*/
+
+static
+void
+test_template_null(
+    void)
+{
+    static const char* bad_slots[] = { "x", "", NULL };
+    static const guint8 data[] = { 0xd0, 0x00, 0x00 };
+    GUtilData bytes;
+    NdefRec* rec;
+    guint8 buf[4];
+
+    TEST_BYTES_SET(bytes, data);
+    rec = ndef_rec_new(&bytes);
+
+    g_assert(!ndef_msg_template_new(NULL, NULL));
+    g_assert(!ndef_msg_template_new(rec, bad_slots));
+    g_assert_cmpint(ndef_msg_template_slot(NULL, "x"), == ,-1);
+    g_assert_cmpuint(ndef_msg_template_encode(NULL, NULL, 0, buf,
+        sizeof(buf)), == ,0);
+    g_assert_cmpuint(ndef_msg_template_encode_tlv(NULL, NULL, 0, NULL, buf,
+        sizeof(buf)), == ,0);
+    ndef_msg_template_free(NULL);
+    ndef_rec_unref(rec);
+}
+
+/*==========================================================================*
+ * template_basic
+ *==========================================================================*/
+
+static
+void
+test_template_basic(
+    void)
+{
+    static const guint8 data[] = {
+        0xd1,           /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x00,           /* Length of the record payload */
+        'x'             /* Record type: 'x' */
+    };
+    static const guint8 unknown_data[] = {
+        0xd5,           /* NDEF record header (MB,ME,SR,TNF=0x05) */
+        0x00,           /* Length of the record type */
+        0x02,           /* Length of the record payload */
+        0x01, 0x02      /* Payload */
+    };
+    GUtilData bytes;
+    NdefRec* rec;
+    NdefMsgTemplate* tmpl;
+    guint8 buf[sizeof(unknown_data)];
+
+    TEST_BYTES_SET(bytes, data);
+    rec = ndef_rec_new(&bytes);
+    tmpl = ndef_msg_template_new(rec, NULL);
+
+    /* The source records may go away */
+    ndef_rec_unref(rec);
+
+    /* No slots, the message is reproduced as is */
+    g_assert(tmpl);
+    g_assert_cmpint(ndef_msg_template_slot(tmpl, NULL), == ,-1);
+    g_assert_cmpint(ndef_msg_template_slot(tmpl, "x"), == ,-1);
+    g_assert_cmpuint(ndef_msg_template_encode(tmpl, NULL, 0, NULL, 0), == ,
+        sizeof(data));
+    g_assert_cmpuint(ndef_msg_template_encode(tmpl, NULL, 0, buf,
+        sizeof(data) - 1), == ,0);
+    g_assert_cmpuint(ndef_msg_template_encode(tmpl, NULL, 0, buf,
+        sizeof(buf)), == ,sizeof(data));
+    g_assert(!memcmp(buf, data, sizeof(data)));
+    ndef_msg_template_free(tmpl);
+
+    /* Unknown TNF is preserved */
+    TEST_BYTES_SET(bytes, unknown_data);
+    rec = ndef_rec_new(&bytes);
+    g_assert_cmpint(rec->tnf, == ,NDEF_TNF_EMPTY);
+    tmpl = ndef_msg_template_new(rec, NULL);
+    ndef_rec_unref(rec);
+    g_assert(tmpl);
+    g_assert_cmpuint(ndef_msg_template_encode(tmpl, NULL, 0, buf,
+        sizeof(buf)), == ,sizeof(unknown_data));
+    g_assert(!memcmp(buf, unknown_data, sizeof(unknown_data)));
+    ndef_msg_template_free(tmpl);
+}
+
+/*==========================================================================*
+ * template_uri
+ *==========================================================================*/
+
+static
+void
+test_template_uri(
+    void)
+{
+    static const char* slots[] = { "$SN", "$Q", NULL };
+    static const guint8 expected[] = {
+        0xd1,           /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x0c,           /* Length of the record payload */
+        'U',            /* Record type: 'U' */
+        0x04,           /* "https://" */
+        'a', '.', 'b', '/', '4', '2', '?', 'q', '/', '4', '2'
+    };
+    NdefRecU* urec = ndef_rec_u_new("https://a.b/$SN?$Q/$SN");
+    NdefMsgTemplate* tmpl = ndef_msg_template_new(&urec->rec, slots);
+    GUtilData values[2];
+    GByteArray* buf = g_byte_array_new();
+    GUtilData data;
+    char* sn;
+    char* uri;
+    NdefRec* rec;
+    gsize size;
+
+    ndef_rec_unref(&urec->rec);
+    g_assert(tmpl);
+    g_assert_cmpint(ndef_msg_template_slot(tmpl, "$SN"), == ,0);
+    g_assert_cmpint(ndef_msg_template_slot(tmpl, "$Q"), == ,1);
+    g_assert_cmpint(ndef_msg_template_slot(tmpl, "$X"), == ,-1);
+
+    /* Short values */
+    gutil_data_from_string(values + 0, "42");
+    gutil_data_from_string(values + 1, "q");
+    size = ndef_msg_template_encode(tmpl, values, 2, NULL, 0);
+    g_assert_cmpuint(size, == ,sizeof(expected));
+    g_byte_array_set_size(buf, size);
+    g_assert_cmpuint(ndef_msg_template_encode(tmpl, values, 2, buf->data,
+        buf->len), == ,size);
+    g_assert(!memcmp(buf->data, expected, size));
+
+    /* Missing values disappear */
+    size = ndef_msg_template_encode(tmpl, values, 1, NULL, 0);
+    g_assert_cmpuint(size, == ,sizeof(expected) - 1);
+    g_byte_array_set_size(buf, size);
+    g_assert_cmpuint(ndef_msg_template_encode(tmpl, values, 1, buf->data,
+        buf->len), == ,size);
+    data.bytes = buf->data;
+    data.size = buf->len;
+    rec = ndef_rec_new(&data);
+    g_assert(NDEF_IS_REC_U(rec));
+    g_assert_cmpstr(NDEF_REC_U(rec)->uri, == ,"https://a.b/42?/42");
+    ndef_rec_unref(rec);
+
+    /* Long value switches to the long record and TLV formats */
+    sn = g_strnfill(200, '0');
+    uri = g_strconcat("https://a.b/", sn, "?q/", sn, NULL);
+    gutil_data_from_string(values + 0, sn);
+    size = ndef_msg_template_encode_tlv(tmpl, values, 2, NULL, NULL, 0);
+    g_assert_cmpuint(size, == ,4 + 6 + 1 + 1 + 4 + 200 + 3 + 200 + 1);
+    g_byte_array_set_size(buf, size);
+    g_assert_cmpuint(ndef_msg_template_encode_tlv(tmpl, values, 2, NULL,
+        buf->data, buf->len - 1), == ,0);
+    g_assert_cmpuint(ndef_msg_template_encode_tlv(tmpl, values, 2, NULL,
+        buf->data, buf->len), == ,size);
+    g_assert_cmpuint(buf->data[4], == ,0xc1); /* No SR */
+    data.bytes = buf->data;
+    data.size = buf->len;
+    rec = ndef_rec_new_from_tlv(&data);
+    g_assert(NDEF_IS_REC_U(rec));
+    g_assert_cmpstr(NDEF_REC_U(rec)->uri, == ,uri);
+    g_assert(!rec->next);
+    ndef_rec_unref(rec);
+
+    ndef_msg_template_free(tmpl);
+    g_byte_array_free(buf, TRUE);
+    g_free(sn);
+    g_free(uri);
+}
+
+/*==========================================================================*
+ * template_sp
+ *==========================================================================*/
+
+static
+void
+test_template_sp(
+    void)
+{
+    static const char* slots[] = { "<id>", NULL };
+    static const NdefTlvParams params = { NULL, 0, NULL, 0, 4 };
+    NdefRecSp* sp = ndef_rec_sp_new("https://a.b/<id>", "Item <id>", "en",
+        NULL, 0, NDEF_SP_ACT_DEFAULT, NULL);
+    static const guint8 empty[] = { 0xd0, 0x00, 0x00 };
+    NdefRec* first;
+    NdefMsgTemplate* tmpl;
+    GByteArray* buf = g_byte_array_new();
+    GUtilData value;
+    GUtilData data;
+    NdefRec* rec;
+    guint i;
+
+    /* Empty record followed by the Smart Poster */
+    TEST_BYTES_SET(data, empty);
+    first = ndef_rec_new(&data);
+    first->next = ndef_rec_ref(&sp->rec);
+    tmpl = ndef_msg_template_new(first, slots);
+    ndef_rec_unref(first);
+    ndef_rec_unref(&sp->rec);
+    g_assert(tmpl);
+
+    for (i = 0; i < 2; i++) {
+        char* id = g_strnfill(i ? 300 : 1, 'x');
+        char* uri = g_strconcat("https://a.b/", id, NULL);
+        char* title = g_strconcat("Item ", id, NULL);
+        gsize size;
+
+        gutil_data_from_string(&value, id);
+        size = ndef_msg_template_encode_tlv(tmpl, &value, 1, &params,
+            NULL, 0);
+        g_assert_cmpuint(size % 4, == ,0);
+        g_byte_array_set_size(buf, size);
+        g_assert_cmpuint(ndef_msg_template_encode_tlv(tmpl, &value, 1,
+            &params, buf->data, size), == ,size);
+
+        data.bytes = buf->data;
+        data.size = buf->len;
+        rec = ndef_rec_new_from_tlv(&data);
+        g_assert(rec);
+        g_assert_cmpint(rec->tnf, == ,NDEF_TNF_EMPTY);
+        g_assert(NDEF_IS_REC_SP(rec->next));
+        sp = NDEF_REC_SP(rec->next);
+        g_assert_cmpstr(sp->uri, == ,uri);
+        g_assert_cmpstr(sp->title, == ,title);
+        g_assert_cmpstr(sp->lang, == ,"en");
+        g_assert(!rec->next->next);
+        ndef_rec_unref(rec);
+        g_free(id);
+        g_free(uri);
+        g_free(title);
+    }
+
+    ndef_msg_template_free(tmpl);
+    g_byte_array_free(buf, TRUE);
+}
+
+/*==========================================================================*
+ * template_too_large
+ *==========================================================================*/
+
+static
+void
+test_template_too_large(
+    void)
+{
+    static const char* slots[] = { "<id>", NULL };
+    static const guint8 small[4];
+    NdefRecSp* sp = ndef_rec_sp_new("https://a.b/<id>", NULL, NULL,
+        NULL, 0, NDEF_SP_ACT_DEFAULT, NULL);
+    NdefRecU* urec = ndef_rec_u_new("https://a.b/<id>");
+    NdefMsgTemplate* tmpl;
+    GUtilData value;
+    guint8 buf[64];
+
+    /* The size is never looked at beyond the length check */
+    value.bytes = small;
+
+    /* Too large for the record nested in the Smart Poster */
+    tmpl = ndef_msg_template_new(&sp->rec, slots);
+    ndef_rec_unref(&sp->rec);
+    g_assert(tmpl);
+    value.size = 0x80000000;
+    memset(buf, 0xaa, sizeof(buf));
+    g_assert_cmpuint(ndef_msg_template_encode(tmpl, &value, 1, NULL, 0), == ,
+        0);
+    g_assert_cmpuint(ndef_msg_template_encode(tmpl, &value, 1, buf,
+        sizeof(buf)), == ,0);
+    g_assert_cmpuint(ndef_msg_template_encode_tlv(tmpl, &value, 1, NULL,
+        NULL, 0), == ,0);
+    g_assert_cmpuint(ndef_msg_template_encode_tlv(tmpl, &value, 1, NULL,
+        buf, sizeof(buf)), == ,0);
+
+    /* Fits into the nested record but not into the Smart Poster */
+    value.size = 0x7ffffffa;
+    g_assert_cmpuint(ndef_msg_template_encode(tmpl, &value, 1, NULL, 0), == ,
+        0);
+    g_assert_cmpuint(ndef_msg_template_encode(tmpl, &value, 1, buf,
+        sizeof(buf)), == ,0);
+    g_assert_cmpuint(buf[0], == ,0xaa);
+    ndef_msg_template_free(tmpl);
+
+    /* Would wrap around */
+    tmpl = ndef_msg_template_new(&urec->rec, slots);
+    ndef_rec_unref(&urec->rec);
+    g_assert(tmpl);
+    value.size = G_MAXSIZE - 2;
+    g_assert_cmpuint(ndef_msg_template_encode(tmpl, &value, 1, NULL, 0), == ,
+        0);
+    g_assert_cmpuint(ndef_msg_template_encode(tmpl, &value, 1, buf,
+        sizeof(buf)), == ,0);
+    g_assert_cmpuint(buf[0], == ,0xaa);
+    ndef_msg_template_free(tmpl);
+}
+
+/*==========================================================================*
+ * Common
+ *==========================================================================*/
+
+#define TEST_(t) "/ndef_msg/" t
+
+int main(int argc, char* argv[])
+{
+    guint i;
+
+    G_GNUC_BEGIN_IGNORE_DEPRECATIONS;
+    g_type_init();
+    G_GNUC_END_IGNORE_DEPRECATIONS;
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func(TEST_("msg_null"), test_msg_null);
+    g_test_add_func(TEST_("msg_basic"), test_msg_basic);
+    g_test_add_func(TEST_("msg_tlv"), test_msg_tlv);
+    g_test_add_func(TEST_("iter_null"), test_iter_null);
+    g_test_add_func(TEST_("iter_empty"), test_iter_empty);
+    g_test_add_func(TEST_("iter_basic"), test_iter_basic);
+    g_test_add_func(TEST_("iter_chunked"), test_iter_chunked);
+    g_test_add_func(TEST_("iter_stray"), test_iter_stray);
+    g_test_add_func(TEST_("iter_garbage"), test_iter_garbage);
+    g_test_add_func(TEST_("check_null"), test_check_null);
+    g_test_add_func(TEST_("check_basic"), test_check_basic);
+    g_test_add_func(TEST_("check_chunked"), test_check_chunked);
+    g_test_add_func(TEST_("builder_null"), test_builder_null);
+    g_test_add_func(TEST_("builder_basic"), test_builder_basic);
+    g_test_add_func(TEST_("builder_rec"), test_builder_rec);
+    g_test_add_func(TEST_("builder_empty"), test_builder_empty);
+    g_test_add_func(TEST_("builder_uri"), test_builder_uri);
+    g_test_add_func(TEST_("builder_text"), test_builder_text);
+    g_test_add_func(TEST_("builder_tlv"), test_builder_tlv);
+    g_test_add_func(TEST_("template_null"), test_template_null);
+    g_test_add_func(TEST_("template_basic"), test_template_basic);
+    g_test_add_func(TEST_("template_uri"), test_template_uri);
+    g_test_add_func(TEST_("template_sp"), test_template_sp);
+    g_test_add_func(TEST_("template_too_large"), test_template_too_large);
+    for (i = 0; i < G_N_ELEMENTS(test_check_broken_data); i++) {
+        const TestCheckBrokenData* test = test_check_broken_data + i;
+        char* path = g_strconcat(TEST_("check_broken/"), test->name, NULL);
+
+        g_test_add_data_func(path, test, test_check_broken);
+        g_free(path);
+    }
+    test_init(&test_opt, argc, argv);
+    return g_test_run();
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,594 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "test_common.h"
+
+#include "ndef_parser.h"
+#include "ndef_tlv.h"
+
+static TestOpt test_opt;
+
+static const guint8 test_msg[] = {
+    0x91,           /* NDEF record header (MB,SR,TNF=0x01) */
+    0x01,           /* Length of the record type */
+    0x0a,           /* Length of the record payload */
+    'U',            /* Record type: 'U' (URI) */
+    0x02,           /* "https://www." */
+    'j', 'o', 'l', 'l', 'a', '.', 'c', 'o', 'm',
+    0x32,           /* NDEF record header (CF,SR,TNF=0x02) */
+    0x0a,           /* Length of the record type */
+    0x02,           /* Length of the record payload */
+    't', 'e', 'x', 't', '/', 'p', 'l', 'a', 'i', 'n',
+    'a', 'b',
+    0x06,           /* NDEF record header (TNF=0x06) */
+    0x00,           /* Length of the record type */
+    0x00, 0x00, 0x00, 0x01, /* Length of the record payload */
+    'c',
+    0x51,           /* NDEF record header (ME,SR,TNF=0x01) */
+    0x01,           /* Length of the record type */
+    0x00,           /* Length of the record payload */
+    'x',
+    /* Garbage after the end of the message */
+    0x00, 0x00, 0x00
+};
+
+#define TEST_MSG_END (sizeof(test_msg) - 3)
+#define TEST_URI "https://www.jolla.com"
+
+static
+guint
+test_count_recs(
+    NdefRec* rec)
+{
+    guint n = 0;
+
+    while (rec) {
+        n++;
+        rec = rec->next;
+    }
+    return n;
+}
+
+static
+NdefRec*
+test_feed(
+    NdefParser* parser,
+    const guint8* data,
+    gsize len)
+{
+    GUtilData chunk;
+
+    chunk.bytes = data;
+    chunk.size = len;
+    return ndef_parser_feed(parser, &chunk);
+}
+
+static
+void
+test_check_msg(
+    NdefRec* rec)
+{
+    g_assert(rec);
+    g_assert(NDEF_IS_REC_U(rec));
+    g_assert_cmpstr(ndef_rec_u_uri(NDEF_REC_U(rec)), == ,TEST_URI);
+    g_assert(rec->flags & NDEF_REC_FLAG_FIRST);
+
+    rec = rec->next;
+    g_assert(rec);
+    g_assert(rec->tnf == NDEF_TNF_MEDIA_TYPE);
+    g_assert_cmpuint(rec->payload.size, == ,3);
+    g_assert(!memcmp(rec->payload.bytes, "abc", 3));
+
+    rec = rec->next;
+    g_assert(rec);
+    g_assert_cmpuint(rec->type.size, == ,1);
+    g_assert_cmpuint(rec->type.bytes[0], == ,'x');
+    g_assert(rec->flags & NDEF_REC_FLAG_LAST);
+    g_assert(!rec->next);
+}
+
+/*==========================================================================*
+ * null
+ *==========================================================================*/
+
+static
+void
+test_null(
+    void)
+{
+    NdefParser* parser = ndef_parser_new(NDEF_PARSE_FLAGS_NONE);
+    GUtilData empty;
+
+    memset(&empty, 0, sizeof(empty));
+    ndef_parser_free(NULL);
+    g_assert(!ndef_parser_feed(NULL, NULL));
+    g_assert(!ndef_parser_feed(parser, NULL));
+    g_assert(!ndef_parser_feed(parser, &empty));
+    g_assert_cmpint(ndef_parser_state(NULL), == ,NDEF_PARSER_STATE_ERROR);
+    g_assert_cmpuint(ndef_parser_bytes_needed(NULL), == ,0);
+
+    /* Nothing has been fed yet */
+    g_assert_cmpint(ndef_parser_state(parser), == ,
+        NDEF_PARSER_STATE_PARSING);
+    g_assert_cmpuint(ndef_parser_bytes_needed(parser), == ,3);
+    ndef_parser_free(parser);
+}
+
+/*==========================================================================*
+ * bytewise
+ *==========================================================================*/
+
+static
+void
+test_bytewise(
+    void)
+{
+    NdefParser* parser = ndef_parser_new(NDEF_PARSE_FLAGS_NONE);
+    NdefRec* msg = NULL;
+    NdefRec* last = NULL;
+    gsize i;
+
+    for (i = 0; i < sizeof(test_msg); i++) {
+        const gsize needed = ndef_parser_bytes_needed(parser);
+        NdefRec* rec;
+
+        if (i < TEST_MSG_END) {
+            g_assert(needed > 0);
+        } else {
+            g_assert_cmpuint(needed, == ,0);
+        }
+        rec = test_feed(parser, test_msg + i, 1);
+        switch (i) {
+        case 0:
+        case 1:
+            /* Short record header is being assembled */
+            g_assert(!rec);
+            g_assert_cmpuint(ndef_parser_bytes_needed(parser), == ,2 - i);
+            break;
+        case 2:
+            /* Header is complete, now the size of the record is known */
+            g_assert(!rec);
+            g_assert_cmpuint(ndef_parser_bytes_needed(parser), == ,11);
+            break;
+        case 13:
+            /* URI record is complete */
+            g_assert(rec);
+            g_assert_cmpuint(test_count_recs(rec), == ,1);
+            break;
+        case 35:
+            /* The chunked record is complete */
+            g_assert(rec);
+            g_assert_cmpuint(test_count_recs(rec), == ,1);
+            break;
+        case TEST_MSG_END - 1:
+            g_assert(rec);
+            g_assert_cmpuint(test_count_recs(rec), == ,1);
+            g_assert_cmpint(ndef_parser_state(parser), == ,
+                NDEF_PARSER_STATE_DONE);
+            break;
+        default:
+            g_assert(!rec);
+            break;
+        }
+        if (rec) {
+            if (last) {
+                last->next = rec;
+            } else {
+                msg = rec;
+            }
+            last = rec;
+        }
+    }
+
+    test_check_msg(msg);
+    ndef_rec_unref(msg);
+    ndef_parser_free(parser);
+}
+
+/*==========================================================================*
+ * pages
+ *==========================================================================*/
+
+static
+void
+test_pages(
+    void)
+{
+    static const NDEF_PARSE_FLAGS flags[] = {
+        NDEF_PARSE_FLAGS_NONE,
+        NDEF_PARSE_FLAG_SHARED_STORAGE,
+        NDEF_PARSE_FLAG_LAZY
+    };
+    guint k;
+
+    for (k = 0; k < G_N_ELEMENTS(flags); k++) {
+        NdefParser* parser = ndef_parser_new(flags[k]);
+        GPtrArray* recs = g_ptr_array_new_with_free_func(g_object_unref);
+        NdefRec* msg = NULL;
+        gsize i;
+
+        for (i = 0; i < sizeof(test_msg); i += 4) {
+            NdefRec* rec = test_feed(parser, test_msg + i,
+                MIN(4, sizeof(test_msg) - i));
+
+            while (rec) {
+                NdefRec* next = rec->next;
+
+                rec->next = NULL;
+                g_ptr_array_add(recs, rec);
+                rec = next;
+            }
+        }
+
+        g_assert_cmpint(ndef_parser_state(parser), == ,
+            NDEF_PARSER_STATE_DONE);
+        g_assert_cmpuint(ndef_parser_bytes_needed(parser), == ,0);
+        g_assert_cmpuint(recs->len, == ,3);
+
+        /* Chain them back together to check them */
+        for (i = recs->len; i > 0; i--) {
+            NdefRec* rec = ndef_rec_ref(recs->pdata[i - 1]);
+
+            rec->next = msg;
+            msg = rec;
+        }
+        g_ptr_array_free(recs, TRUE);
+        test_check_msg(msg);
+        ndef_rec_unref(msg);
+        ndef_parser_free(parser);
+    }
+}
+
+/*==========================================================================*
+ * broken
+ *==========================================================================*/
+
+static
+void
+test_broken(
+    void)
+{
+    static const guint8 data[] = {
+        0x91,           /* NDEF record header (MB,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x00,           /* Length of the record payload */
+        'x',
+        0x01,                   /* NDEF record header (TNF=0x01) */
+        0x01,                   /* Length of the record type */
+        0x80, 0x00, 0x00, 0x00, /* Length of the record payload */
+        'x'
+    };
+    NdefParser* parser = ndef_parser_new(NDEF_PARSE_FLAGS_NONE);
+    NdefRec* rec;
+
+    /* The first record is fine */
+    rec = test_feed(parser, data, 6);
+    g_assert(rec);
+    g_assert(!rec->next);
+    ndef_rec_unref(rec);
+    g_assert_cmpuint(ndef_parser_bytes_needed(parser), == ,4);
+
+    /* And the second one is broken */
+    g_assert(!test_feed(parser, data + 6, sizeof(data) - 6));
+    g_assert_cmpint(ndef_parser_state(parser), == ,
+        NDEF_PARSER_STATE_ERROR);
+    g_assert_cmpuint(ndef_parser_bytes_needed(parser), == ,0);
+
+    /* Everything else is ignored */
+    g_assert(!test_feed(parser, test_msg, sizeof(test_msg)));
+    ndef_parser_free(parser);
+}
+
+/*==========================================================================*
+ * tlv
+ *==========================================================================*/
+
+static
+void
+test_tlv(
+    void)
+{
+    static const guint8 head[] = {
+        TLV_LOCK_CONTROL, /* Value type */
+        0x03,             /* Value length */
+        0xa0, 0x0c, 0x34,
+        TLV_NULL,
+        TLV_NDEF_MESSAGE, /* Value type */
+        0xff, 0x00,       /* Value length (3-byte format) */
+        TEST_MSG_END
+    };
+    static const guint8 tail[] = {
+        TLV_TERMINATOR
+    };
+    GByteArray* buf = g_byte_array_new();
+    NdefParser* parser = ndef_parser_new_tlv(NDEF_PARSE_FLAGS_NONE);
+    NdefRec* msg = NULL;
+    NdefRec* last = NULL;
+    gsize i;
+
+    g_byte_array_append(buf, head, sizeof(head));
+    g_byte_array_append(buf, test_msg, TEST_MSG_END);
+    g_byte_array_append(buf, tail, sizeof(tail));
+
+    g_assert_cmpuint(ndef_parser_bytes_needed(parser), == ,1);
+    for (i = 0; i < buf->len; i += 4) {
+        NdefRec* rec = test_feed(parser, buf->data + i,
+            MIN(4, buf->len - i));
+
+        if (rec) {
+            if (last) {
+                last->next = rec;
+            } else {
+                msg = rec;
+            }
+            last = rec;
+            while (last->next) {
+                last = last->next;
+            }
+        }
+        switch (i) {
+        case 0:
+            /* In the middle of the Lock Control TLV */
+            g_assert_cmpuint(ndef_parser_bytes_needed(parser), == ,1);
+            break;
+        case 4:
+            /* Lock Control, NULL, T and the first byte of L */
+            g_assert_cmpuint(ndef_parser_bytes_needed(parser), == ,2);
+            break;
+        case 8:
+            /* The header of the first record is incomplete */
+            g_assert_cmpuint(ndef_parser_bytes_needed(parser), == ,1);
+            break;
+        }
+    }
+
+    g_assert_cmpint(ndef_parser_state(parser), == ,NDEF_PARSER_STATE_DONE);
+    g_assert_cmpuint(ndef_parser_bytes_needed(parser), == ,0);
+    test_check_msg(msg);
+    ndef_rec_unref(msg);
+    ndef_parser_free(parser);
+    g_byte_array_free(buf, TRUE);
+}
+
+/*==========================================================================*
+ * tlv_multiple
+ *==========================================================================*/
+
+static
+void
+test_tlv_multiple(
+    void)
+{
+    static const guint8 data[] = {
+        TLV_NDEF_MESSAGE, /* Value type */
+        0x00,             /* Value length */
+        TLV_NDEF_MESSAGE, /* Value type */
+        0x04,             /* Value length */
+        /* Truncated record */
+        0xd1,             /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,             /* Length of the record type */
+        0x01,             /* Length of the record payload */
+        'x',
+        TLV_NDEF_MESSAGE, /* Value type */
+        0x06,             /* Value length */
+        0xd1,             /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,             /* Length of the record type */
+        0x00,             /* Length of the record payload */
+        'y',
+        /* Garbage after the end of the message (skipped) */
+        0x00, 0x00,
+        0x80,             /* Proprietary TLV */
+        0x01,             /* Value length */
+        0x00,
+        TLV_TERMINATOR,
+        /* Ignored */
+        TLV_NDEF_MESSAGE, /* Value type */
+        0x00              /* Value length */
+    };
+    NdefParser* parser = ndef_parser_new_tlv(NDEF_PARSE_FLAGS_NONE);
+    NdefRec* rec;
+    GUtilData bytes;
+
+    TEST_BYTES_SET(bytes, data);
+    rec = ndef_parser_feed(parser, &bytes);
+    g_assert_cmpint(ndef_parser_state(parser), == ,NDEF_PARSER_STATE_DONE);
+
+    /* Empty NDEF and the 'y' record */
+    g_assert(rec);
+    g_assert_cmpuint(test_count_recs(rec), == ,2);
+    g_assert(!rec->raw.size);
+    g_assert_cmpuint(rec->next->type.size, == ,1);
+    g_assert_cmpuint(rec->next->type.bytes[0], == ,'y');
+    ndef_rec_unref(rec);
+    ndef_parser_free(parser);
+}
+
+/*==========================================================================*
+ * limits
+ *==========================================================================*/
+
+static
+void
+test_limits(
+    void)
+{
+    static const guint8 data[] = {
+        0x91,                   /* NDEF record header (MB,SR,TNF=0x01) */
+        0x01,                   /* Length of the record type */
+        0x00,                   /* Length of the record payload */
+        'x',
+        0x41,                   /* NDEF record header (ME,TNF=0x01) */
+        0x01,                   /* Length of the record type */
+        0x00, 0x00, 0x00, 0x05, /* Length of the record payload */
+        'y',
+        'a', 'b', 'c', 'd', 'e'
+    };
+    NdefParseLimits limits;
+    NdefParser* parser;
+    NdefRec* rec;
+
+    /* The oversized payload is detected as soon as the header arrives */
+    memset(&limits, 0, sizeof(limits));
+    limits.max_payload = 4;
+    ndef_parse_limits_set(&limits);
+    parser = ndef_parser_new(NDEF_PARSE_FLAGS_NONE);
+    rec = test_feed(parser, data, 4);
+    g_assert(rec);
+    ndef_rec_unref(rec);
+    g_assert(!test_feed(parser, data + 4, 6));
+    g_assert_cmpint(ndef_parser_state(parser), == ,
+        NDEF_PARSER_STATE_ERROR);
+    ndef_parser_free(parser);
+
+    /* Too many records */
+    limits.max_payload = 0;
+    limits.max_records = 1;
+    ndef_parse_limits_set(&limits);
+    parser = ndef_parser_new(NDEF_PARSE_FLAGS_NONE);
+    rec = test_feed(parser, data, sizeof(data));
+    g_assert_cmpuint(test_count_recs(rec), == ,1);
+    ndef_rec_unref(rec);
+    g_assert_cmpint(ndef_parser_state(parser), == ,
+        NDEF_PARSER_STATE_ERROR);
+    ndef_parser_free(parser);
+
+    /* Too much data to buffer */
+    limits.max_records = 0;
+    limits.max_alloc = 8;
+    ndef_parse_limits_set(&limits);
+    parser = ndef_parser_new(NDEF_PARSE_FLAGS_NONE);
+    rec = test_feed(parser, data, 4);
+    g_assert(rec);
+    ndef_rec_unref(rec);
+    g_assert(!test_feed(parser, data + 4, 7));
+    g_assert_cmpint(ndef_parser_state(parser), == ,
+        NDEF_PARSER_STATE_PARSING);
+    g_assert(!test_feed(parser, data + 11, 5));
+    g_assert_cmpint(ndef_parser_state(parser), == ,
+        NDEF_PARSER_STATE_ERROR);
+    ndef_parser_free(parser);
+
+    /* The parser takes a snapshot of the limits */
+    parser = ndef_parser_new(NDEF_PARSE_FLAGS_NONE);
+    ndef_parse_limits_set(NULL);
+    g_assert(!test_feed(parser, data, sizeof(data)));
+    g_assert_cmpint(ndef_parser_state(parser), == ,
+        NDEF_PARSER_STATE_ERROR);
+    ndef_parser_free(parser);
+}
+
+/*==========================================================================*
+ * limits_nested
+ *==========================================================================*/
+
+static
+void
+test_limits_nested(
+    void)
+{
+    static const guint8 data[] = {
+        0xd1,           /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x02,           /* Length of the record type */
+        0x06,           /* Length of the record payload */
+        'S', 'p',       /* Record type: 'Sp' (Smart Poster) */
+        0xd1,           /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x02,           /* Length of the record payload */
+        'U',            /* Record type: 'U' (URI) */
+        0x00, 'a'
+    };
+    NdefParseLimits limits;
+    NdefParser* parser;
+    NdefRec* rec;
+
+    /* Nested records are checked against the parser's limits too */
+    parser = ndef_parser_new(NDEF_PARSE_FLAGS_NONE);
+    g_assert(!test_feed(parser, data, 3));
+    memset(&limits, 0, sizeof(limits));
+    limits.max_records = 1;
+    ndef_parse_limits_set(&limits);
+    rec = test_feed(parser, data + 3, sizeof(data) - 3);
+    g_assert(rec);
+    g_assert(NDEF_IS_REC_SP(rec));
+    g_assert_cmpstr(NDEF_REC_SP(rec)->uri, == ,"a");
+    ndef_rec_unref(rec);
+    g_assert_cmpint(ndef_parser_state(parser), == ,
+        NDEF_PARSER_STATE_DONE);
+    ndef_parser_free(parser);
+
+    /* Even if the limits get relaxed in the middle of the stream */
+    parser = ndef_parser_new(NDEF_PARSE_FLAGS_NONE);
+    g_assert(!test_feed(parser, data, 3));
+    ndef_parse_limits_set(NULL);
+    g_assert(!test_feed(parser, data + 3, sizeof(data) - 3));
+    g_assert_cmpint(ndef_parser_state(parser), == ,
+        NDEF_PARSER_STATE_ERROR);
+    ndef_parser_free(parser);
+}
+
+/*==========================================================================*
+ * Common
+ *==========================================================================*/
+
+#define TEST_(t) "/ndef_parser/" t
+
+int main(int argc, char* argv[])
+{
+    G_GNUC_BEGIN_IGNORE_DEPRECATIONS;
+    g_type_init();
+    G_GNUC_END_IGNORE_DEPRECATIONS;
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func(TEST_("null"), test_null);
+    g_test_add_func(TEST_("bytewise"), test_bytewise);
+    g_test_add_func(TEST_("pages"), test_pages);
+    g_test_add_func(TEST_("broken"), test_broken);
+    g_test_add_func(TEST_("tlv"), test_tlv);
+    g_test_add_func(TEST_("tlv_multiple"), test_tlv_multiple);
+    g_test_add_func(TEST_("limits"), test_limits);
+    g_test_add_func(TEST_("limits_nested"), test_limits_nested);
+    test_init(&test_opt, argc, argv);
+    return g_test_run();
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -39,6 +39,7 @@
 
 #include "test_common.h"
 
+#include "ndef_msg.h"
 #include "ndef_rec_p.h"
 #include "ndef_tlv.h"
 #include "ndef_util_p.h"
@@ -46,6 +47,9 @@
 #include <gutil_log.h>
 #include <gutil_misc.h>
 
+#include <sys/uio.h>
+#include <unistd.h>
+
 static TestOpt test_opt;
 
 #define TLV_TEST (0x04)
@@ -142,6 +146,10 @@ test_null(
     /* NULL tolerance */
     g_assert(!ndef_rec_new(NULL));
     g_assert(!ndef_rec_new_from_tlv(NULL));
+    g_assert(!ndef_rec_new_bytes(NULL));
+    g_assert(!ndef_rec_new_from_tlv_bytes(NULL));
+    g_assert(!ndef_rec_new_full(NULL, NDEF_PARSE_FLAG_SHARED_STORAGE));
+    g_assert(!ndef_rec_new_from_tlv_full(NULL, NDEF_PARSE_FLAGS_NONE));
     g_assert(!ndef_rec_ref(NULL));
     g_assert(!ndef_rec_initialize(NULL, NDEF_RTD_UNKNOWN, NULL));
     ndef_rec_unref(NULL);
@@ -199,7 +207,7 @@ void
 test_chunked(
     void)
 {
-    /* Chunked records are not supported (yet?) */
+    /* The terminating chunk is missing */
     static const guint8 data[] = {
         0xf1,   /* NDEF record header (MB,ME,CF,SR,TNF=0x01) */
         0x01,   /* Length of the record type */
@@ -212,6 +220,229 @@ test_chunked(
     g_assert(!ndef_rec_new(&bytes));
 }
 
+/*==========================================================================*
+ * chunked_uri
+ *==========================================================================*/
+
+static
+void
+test_chunked_uri(
+    void)
+{
+    static const guint8 data[] = {
+        0xb9,       /* NDEF record header (MB,CF,SR,IL,TNF=0x01) */
+        0x01,       /* Length of the record type */
+        0x03,       /* Length of the record payload */
+        0x01,       /* Length of the id */
+        'U',        /* Record type: 'U' */
+        'i',        /* Id */
+        0x04, 'e', 'x',
+        0x36,       /* NDEF record header (CF,SR,TNF=0x06) */
+        0x00,       /* Length of the record type */
+        0x04,       /* Length of the record payload */
+        'a', 'm', 'p', 'l',
+        0x36,       /* NDEF record header (CF,SR,TNF=0x06) */
+        0x00,       /* Length of the record type */
+        0x00,       /* Length of the record payload */
+        0x56,       /* NDEF record header (ME,SR,TNF=0x06) */
+        0x00,       /* Length of the record type */
+        0x01,       /* Length of the record payload */
+        'e'
+    };
+    static const guint8 expected[] = {
+        0xd9,       /* NDEF record header (MB,ME,SR,IL,TNF=0x01) */
+        0x01,       /* Length of the record type */
+        0x08,       /* Length of the record payload */
+        0x01,       /* Length of the id */
+        'U',        /* Record type: 'U' */
+        'i',        /* Id */
+        0x04, 'e', 'x', 'a', 'm', 'p', 'l', 'e'
+    };
+    static const NDEF_PARSE_FLAGS flags[] = {
+        NDEF_PARSE_FLAGS_NONE,
+        NDEF_PARSE_FLAG_SHARED_STORAGE,
+        NDEF_PARSE_FLAG_LAZY
+    };
+    GUtilData bytes;
+    guint i;
+
+    TEST_BYTES_SET(bytes, data);
+    for (i = 0; i < G_N_ELEMENTS(flags); i++) {
+        NdefRec* rec = ndef_rec_new_full(&bytes, flags[i]);
+
+        g_assert(rec);
+        g_assert(NDEF_IS_REC_U(rec));
+        g_assert(!rec->next);
+        g_assert(rec->tnf == NDEF_TNF_WELL_KNOWN);
+        g_assert(rec->rtd == NDEF_RTD_URI);
+        g_assert_cmpuint(rec->flags, == ,NDEF_REC_FLAG_FIRST |
+            NDEF_REC_FLAG_LAST);
+        g_assert_cmpuint(rec->id.size, == ,1);
+        g_assert_cmpuint(rec->id.bytes[0], == ,'i');
+        g_assert_cmpuint(rec->payload.size, == ,8);
+        g_assert_cmpuint(rec->raw.size, == ,sizeof(expected));
+        g_assert(!memcmp(rec->raw.bytes, expected, sizeof(expected)));
+        g_assert_cmpstr(ndef_rec_u_uri(NDEF_REC_U(rec)), == ,
+            "https://example");
+        ndef_rec_unref(rec);
+    }
+}
+
+/*==========================================================================*
+ * chunked_long
+ *==========================================================================*/
+
+static
+void
+test_chunked_long(
+    void)
+{
+    static const guint8 head[] = {
+        0xa2,                   /* NDEF record header (MB,CF,TNF=0x02) */
+        0x0a,                   /* Length of the record type */
+        0x00, 0x00, 0x00, 0x80, /* Length of the record payload */
+        't', 'e', 'x', 't', '/', 'p', 'l', 'a', 'i', 'n'
+    };
+    static const guint8 mid[] = {
+        0x26,                   /* NDEF record header (CF,TNF=0x06) */
+        0x00,                   /* Length of the record type */
+        0x00, 0x00, 0x00, 0x80  /* Length of the record payload */
+    };
+    static const guint8 tail[] = {
+        0x56,                   /* NDEF record header (ME,SR,TNF=0x06) */
+        0x00,                   /* Length of the record type */
+        0x10                    /* Length of the record payload */
+    };
+    static const guint8 next[] = {
+        0x51,                   /* NDEF record header (ME,SR,TNF=0x01) */
+        0x01,                   /* Length of the record type */
+        0x00,                   /* Length of the record payload */
+        'x'
+    };
+    const guint payload_size = 0x80 + 0x80 + 0x10;
+    GByteArray* buf = g_byte_array_new();
+    guint8* payload = g_malloc(payload_size);
+    GUtilData bytes;
+    NdefRec* rec;
+    guint i;
+
+    for (i = 0; i < payload_size; i++) {
+        payload[i] = (guint8)i;
+    }
+    g_byte_array_append(buf, head, sizeof(head));
+    g_byte_array_append(buf, payload, 0x80);
+    g_byte_array_append(buf, mid, sizeof(mid));
+    g_byte_array_append(buf, payload + 0x80, 0x80);
+    g_byte_array_append(buf, tail, sizeof(tail));
+    g_byte_array_append(buf, payload + 0x100, 0x10);
+    g_byte_array_append(buf, next, sizeof(next));
+
+    bytes.bytes = buf->data;
+    bytes.size = buf->len;
+    rec = ndef_rec_new(&bytes);
+
+    g_assert(rec);
+    g_assert(rec->tnf == NDEF_TNF_MEDIA_TYPE);
+    g_assert_cmpuint(rec->flags, == ,NDEF_REC_FLAG_FIRST |
+        NDEF_REC_FLAG_LAST);
+    g_assert_cmpuint(rec->type.size, == ,10);
+    g_assert(!memcmp(rec->type.bytes, "text/plain", 10));
+    g_assert_cmpuint(rec->payload.size, == ,payload_size);
+    g_assert(!memcmp(rec->payload.bytes, payload, payload_size));
+
+    /* Long record header, no id */
+    g_assert_cmpuint(rec->raw.size, == ,6 + 10 + payload_size);
+    g_assert_cmpuint(rec->raw.bytes[0], == ,0xc2);
+    g_assert(!rec->id.bytes);
+
+    /* The record following the chunks */
+    g_assert(rec->next);
+    g_assert(!rec->next->next);
+    g_assert_cmpuint(rec->next->type.size, == ,1);
+    g_assert_cmpuint(rec->next->type.bytes[0], == ,'x');
+    ndef_rec_unref(rec);
+
+    g_byte_array_free(buf, TRUE);
+    g_free(payload);
+}
+
+/*==========================================================================*
+ * chunked_broken
+ *==========================================================================*/
+
+static
+void
+test_chunked_broken(
+    void)
+{
+    static const guint8 data1[] = {
+        0xb1,       /* NDEF record header (MB,CF,SR,TNF=0x01) */
+        0x01,       /* Length of the record type */
+        0x01,       /* Length of the record payload */
+        'x', 0x00,
+        /* Middle chunk can't have a type */
+        0x36,       /* NDEF record header (CF,SR,TNF=0x06) */
+        0x01,       /* Length of the record type */
+        0x00,       /* Length of the record payload */
+        'y',
+        /* This one is fine */
+        0x51,       /* NDEF record header (ME,SR,TNF=0x01) */
+        0x01,       /* Length of the record type */
+        0x00,       /* Length of the record payload */
+        'z'
+    };
+    static const guint8 data2[] = {
+        0xb1,       /* NDEF record header (MB,CF,SR,TNF=0x01) */
+        0x01,       /* Length of the record type */
+        0x01,       /* Length of the record payload */
+        'x', 0x00,
+        /* Not a chunk */
+        0x51,       /* NDEF record header (ME,SR,TNF=0x01) */
+        0x01,       /* Length of the record type */
+        0x00,       /* Length of the record payload */
+        'z'
+    };
+    static const guint8 data3[] = {
+        /* Terminating chunk without the first one */
+        0x96,       /* NDEF record header (MB,SR,TNF=0x06) */
+        0x00,       /* Length of the record type */
+        0x00,       /* Length of the record payload */
+        0x51,       /* NDEF record header (ME,SR,TNF=0x01) */
+        0x01,       /* Length of the record type */
+        0x00,       /* Length of the record payload */
+        'z'
+    };
+    GUtilData bytes;
+    NdefRec* rec;
+
+    /* The broken sequence is dropped, parsing continues after it */
+    TEST_BYTES_SET(bytes, data1);
+    rec = ndef_rec_new(&bytes);
+    g_assert(rec);
+    g_assert(!rec->next);
+    g_assert_cmpuint(rec->type.size, == ,1);
+    g_assert_cmpuint(rec->type.bytes[0], == ,'z');
+    ndef_rec_unref(rec);
+
+    /* The unterminated sequence is dropped, the next record is parsed */
+    TEST_BYTES_SET(bytes, data2);
+    rec = ndef_rec_new(&bytes);
+    g_assert(rec);
+    g_assert(!rec->next);
+    g_assert_cmpuint(rec->type.size, == ,1);
+    g_assert_cmpuint(rec->type.bytes[0], == ,'z');
+    ndef_rec_unref(rec);
+
+    /* Stray chunk is skipped */
+    TEST_BYTES_SET(bytes, data3);
+    rec = ndef_rec_new(&bytes);
+    g_assert(rec);
+    g_assert(!rec->next);
+    g_assert_cmpuint(rec->type.size, == ,1);
+    g_assert_cmpuint(rec->type.bytes[0], == ,'z');
+    ndef_rec_unref(rec);
+}
+
 /*==========================================================================*
  * tlv
  *==========================================================================*/
@@ -367,7 +598,7 @@ test_tlv_multiple(
         'x',                  /* Record type: 'x' */
         TLV_NDEF_MESSAGE, /* Value type */
         0x04,             /* Value length */
-        /* This one is ignore because it's chunked */
+        /* This one is ignored because the chunk sequence is incomplete */
         0xf1,                 /* NDEF record header (MB,ME,CF,SR,TNF=0x01) */
         0x01,                 /* Length of the record type */
         0x00,                 /* Length of the record payload */
@@ -399,6 +630,287 @@ test_tlv_multiple(
     ndef_rec_unref(rec);
 }
 
+/*==========================================================================*
+ * bytes
+ *==========================================================================*/
+
+static
+void
+test_bytes(
+    void)
+{
+    static const guint8 data[] = {
+        0x91,           /* NDEF record header (MB,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x0a,           /* Length of the record payload */
+        'U',            /* Record type: 'U' (URI) */
+        0x02,           /* "https://www." */
+        'j', 'o', 'l', 'l', 'a', '.', 'c', 'o', 'm',
+        0x59,           /* NDEF record header (ME,SR,IL,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x01,           /* Length of the record payload */
+        0x01,           /* Length of the record ID */
+        'x',            /* Record type: 'x' */
+        'i',            /* Record ID: 'i' */
+        0x00            /* Payload */
+    };
+    GBytes* bytes = g_bytes_new(TEST_ARRAY_AND_SIZE(data));
+    gsize size;
+    const guint8* ptr = g_bytes_get_data(bytes, &size);
+    NdefRec* rec = ndef_rec_new_bytes(bytes);
+    NdefRec* rec2;
+
+    /* Records keep the reference */
+    g_bytes_unref(bytes);
+
+    g_assert(rec);
+    g_assert(NDEF_IS_REC_U(rec));
+    g_assert_cmpstr(NDEF_REC_U(rec)->uri, == ,"https://www.jolla.com");
+    g_assert(rec->raw.bytes == ptr);
+    g_assert_cmpuint(rec->raw.size, == ,14);
+    g_assert(rec->type.bytes == ptr + 3);
+    g_assert(rec->payload.bytes == ptr + 4);
+
+    rec2 = rec->next;
+    g_assert(rec2);
+    g_assert(!rec2->next);
+    g_assert(rec2->raw.bytes == ptr + 14);
+    g_assert_cmpuint(rec2->raw.size, == ,size - 14);
+    g_assert(rec2->type.bytes == ptr + 18);
+    g_assert(rec2->id.bytes == ptr + 19);
+    g_assert_cmpuint(rec2->id.size, == ,1);
+    g_assert(rec2->payload.bytes == ptr + 20);
+    g_assert_cmpuint(rec2->payload.size, == ,1);
+    g_assert(!(rec2->flags & NDEF_REC_FLAG_FIRST));
+    g_assert(rec2->flags & NDEF_REC_FLAG_LAST);
+
+    /* The second record outlives the first one */
+    ndef_rec_ref(rec2);
+    ndef_rec_unref(rec);
+    g_assert_cmpuint(rec2->payload.bytes[0], == ,0);
+    ndef_rec_unref(rec2);
+}
+
+/*==========================================================================*
+ * bytes_empty
+ *==========================================================================*/
+
+static
+void
+test_bytes_empty(
+    void)
+{
+    GBytes* bytes = g_bytes_new(NULL, 0);
+    NdefRec* rec = ndef_rec_new_bytes(bytes);
+
+    g_assert(rec);
+    g_assert(!rec->next);
+    g_assert_cmpint(rec->tnf, == ,NDEF_TNF_EMPTY);
+    ndef_rec_unref(rec);
+    g_bytes_unref(bytes);
+}
+
+/*==========================================================================*
+ * tlv_bytes
+ *==========================================================================*/
+
+static
+void
+test_tlv_bytes(
+    void)
+{
+    static const guint8 tlv[] = {
+        TLV_NULL,         /* NULL record */
+        TLV_NDEF_MESSAGE, /* Value type */
+        0x04,             /* Value length */
+        0xd1,                 /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,                 /* Length of the record type */
+        0x00,                 /* Length of the record payload */
+        'x',                  /* Record type: 'x' */
+        TLV_NDEF_MESSAGE, /* Value type */
+        0x04,             /* Value length */
+        0xd1,                 /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,                 /* Length of the record type */
+        0x00,                 /* Length of the record payload */
+        'y',                  /* Record type: 'y' */
+        TLV_TERMINATOR    /* Terminator record */
+    };
+    GBytes* bytes = g_bytes_new(TEST_ARRAY_AND_SIZE(tlv));
+    const guint8* ptr = g_bytes_get_data(bytes, NULL);
+    NdefRec* rec = ndef_rec_new_from_tlv_bytes(bytes);
+
+    g_bytes_unref(bytes);
+    g_assert(rec);
+    g_assert(rec->raw.bytes == ptr + 3);
+    g_assert_cmpuint(rec->raw.size, == ,4);
+    g_assert(rec->next);
+    g_assert(rec->next->raw.bytes == ptr + 9);
+    g_assert_cmpuint(rec->next->raw.size, == ,4);
+    g_assert(!rec->next->next);
+    ndef_rec_unref(rec);
+}
+
+/*==========================================================================*
+ * shared
+ *==========================================================================*/
+
+static const guint8 test_shared_data[] = {
+    0x91,           /* NDEF record header (MB,SR,TNF=0x01) */
+    0x01,           /* Length of the record type */
+    0x07,           /* Length of the record payload */
+    'T',            /* Record type: 'T' (Text) */
+    0x82,           /* UTF-16, language code length */
+    'e', 'n',
+    0x00, 'H', 0x00, 'i',
+    0x51,           /* NDEF record header (ME,SR,TNF=0x01) */
+    0x02,           /* Length of the record type */
+    0x10,           /* Length of the record payload */
+    'S', 'p',       /* Record type: 'Sp' (SmartPoster) */
+        0x91,           /* NDEF record header (MB,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x04,           /* Length of the record payload */
+        'U',            /* Record type: 'U' (URI) */
+        0x03,           /* "http://" */
+        'a', '.', 'b',
+        0x51,           /* NDEF record header (ME,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x04,           /* Length of the record payload */
+        'T',            /* Record type: 'T' (Text) */
+        0x02,           /* UTF-8, language code length */
+        'e', 'n',
+        'X'
+};
+
+static
+gboolean
+test_shared_ptr(
+    const NdefRec* first,
+    const void* ptr)
+{
+    /* Decoded data follow the raw data */
+    const guint8* start = first->raw.bytes + sizeof(test_shared_data);
+
+    return (const guint8*)ptr >= start && (const guint8*)ptr <
+        (start + sizeof(test_shared_data));
+}
+
+static
+void
+test_shared_check(
+    NdefRec* rec,
+    gboolean shared)
+{
+    NdefRecT* trec;
+    NdefRecSp* sp;
+
+    g_assert(rec);
+    g_assert(NDEF_IS_REC_T(rec));
+    trec = NDEF_REC_T(rec);
+    g_assert_cmpstr(trec->lang, == ,"en");
+    g_assert_cmpstr(trec->text, == ,"Hi");
+    g_assert(rec->next);
+    g_assert(NDEF_IS_REC_SP(rec->next));
+    g_assert(!rec->next->next);
+    sp = NDEF_REC_SP(rec->next);
+    g_assert_cmpstr(sp->uri, == ,"http://a.b");
+    g_assert_cmpstr(sp->title, == ,"X");
+    g_assert_cmpstr(sp->lang, == ,"en");
+    if (shared) {
+        /* Everything is in one block */
+        g_assert(sp->rec.raw.bytes == rec->raw.bytes + rec->raw.size);
+        g_assert(test_shared_ptr(rec, trec->lang));
+        g_assert(test_shared_ptr(rec, trec->text));
+        g_assert(test_shared_ptr(rec, sp->uri));
+        g_assert(test_shared_ptr(rec, sp->title));
+        g_assert(test_shared_ptr(rec, sp->lang));
+    }
+}
+
+static
+void
+test_shared(
+    void)
+{
+    GUtilData data;
+    NdefRec* rec;
+    NdefRec* sp;
+
+    TEST_BYTES_SET(data, test_shared_data);
+    rec = ndef_rec_new_full(&data, NDEF_PARSE_FLAGS_NONE);
+    test_shared_check(rec, FALSE);
+    ndef_rec_unref(rec);
+
+    rec = ndef_rec_new_full(&data, NDEF_PARSE_FLAG_SHARED_STORAGE);
+    g_assert(rec->raw.bytes != data.bytes);
+    test_shared_check(rec, TRUE);
+
+    /* The second record keeps the whole block alive */
+    sp = ndef_rec_ref(rec->next);
+    ndef_rec_unref(rec);
+    g_assert_cmpstr(NDEF_REC_SP(sp)->uri, == ,"http://a.b");
+    g_assert_cmpstr(NDEF_REC_SP(sp)->title, == ,"X");
+    ndef_rec_unref(sp);
+
+    /* Empty block */
+    data.size = 0;
+    rec = ndef_rec_new_full(&data, NDEF_PARSE_FLAG_SHARED_STORAGE);
+    g_assert(rec);
+    g_assert(!rec->raw.size);
+    ndef_rec_unref(rec);
+}
+
+/*==========================================================================*
+ * tlv_shared
+ *==========================================================================*/
+
+static
+void
+test_tlv_shared(
+    void)
+{
+    static const guint8 tlv[] = {
+        TLV_NDEF_MESSAGE, /* Value type */
+        0x08,             /* Value length */
+        0x91,                 /* NDEF record header (MB,SR,TNF=0x01) */
+        0x01,                 /* Length of the record type */
+        0x04,                 /* Length of the record payload */
+        'U',                  /* Record type: 'U' (URI) */
+        0x03,                 /* "http://" */
+        'a', '.', 'b',
+        TLV_NDEF_MESSAGE, /* Value type */
+        0x08,             /* Value length */
+        0xd1,                 /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,                 /* Length of the record type */
+        0x04,                 /* Length of the record payload */
+        'U',                  /* Record type: 'U' (URI) */
+        0x03,                 /* "http://" */
+        'c', '.', 'd',
+        TLV_TERMINATOR    /* Terminator record */
+    };
+    GUtilData data;
+    NdefRec* rec;
+    NdefRecU* u1;
+    NdefRecU* u2;
+
+    TEST_BYTES_SET(data, tlv);
+    rec = ndef_rec_new_from_tlv_full(&data, NDEF_PARSE_FLAG_SHARED_STORAGE);
+    g_assert(rec);
+    g_assert(NDEF_IS_REC_U(rec));
+    g_assert(rec->next);
+    g_assert(NDEF_IS_REC_U(rec->next));
+    g_assert(!rec->next->next);
+
+    /* Each NDEF message gets its own block */
+    u1 = NDEF_REC_U(rec);
+    u2 = NDEF_REC_U(rec->next);
+    g_assert_cmpstr(u1->uri, == ,"http://a.b");
+    g_assert_cmpstr(u2->uri, == ,"http://c.d");
+    g_assert((const guint8*)u1->uri == rec->raw.bytes + rec->raw.size);
+    g_assert((const guint8*)u2->uri == rec->next->raw.bytes +
+        rec->next->raw.size);
+    ndef_rec_unref(rec);
+}
+
 /*==========================================================================*
  * no_type
  *==========================================================================*/
@@ -854,6 +1366,768 @@ test_broken2(
     g_assert(!ndef_rec_new(&bytes));
 }
 
+/*==========================================================================*
+ * register
+ *==========================================================================*/
+
+typedef NdefRecClass TestRecClass;
+typedef struct test_rec {
+    NdefRec rec;
+    int value;
+} TestRec;
+
+G_DEFINE_TYPE(TestRec, test_rec, NDEF_TYPE_REC)
+#define TEST_TYPE_REC (test_rec_get_type())
+#define TEST_REC(obj) G_TYPE_CHECK_INSTANCE_CAST(obj, TEST_TYPE_REC, TestRec)
+
+static
+void
+test_rec_init(
+    TestRec* self)
+{
+}
+
+static
+void
+test_rec_class_init(
+    TestRecClass* klass)
+{
+}
+
+static
+gboolean
+test_register_init(
+    NdefRec* rec,
+    gpointer user_data)
+{
+    int* count = user_data;
+
+    (*count)++;
+    if (G_TYPE_CHECK_INSTANCE_TYPE(rec, TEST_TYPE_REC)) {
+        TEST_REC(rec)->value = *count;
+    }
+    return rec->payload.size > 0;
+}
+
+static
+void
+test_register_destroy(
+    gpointer user_data)
+{
+    int* count = user_data;
+
+    (*count) = -1;
+}
+
+static
+void
+test_register(
+    void)
+{
+    static const guint8 ext_type[] = { 'a', 'b', ':', 'c' };
+    static const guint8 ext_rec[] = {
+        0xd4,       /* NDEF record header (MB,ME,SR,TNF=0x04) */
+        0x04,       /* Length of the record type */
+        0x01,       /* Length of the record payload */
+        'a', 'b', ':', 'c',
+        0x00
+    };
+    static const guint8 ext_rec_empty[] = {
+        0xd4,       /* NDEF record header (MB,ME,SR,TNF=0x04) */
+        0x04,       /* Length of the record type */
+        0x00,       /* Length of the record payload */
+        'a', 'b', ':', 'c'
+    };
+    GUtilData type, bytes;
+    NdefRec* rec;
+    int count = 0;
+    guint id;
+
+    TEST_BYTES_SET(type, ext_type);
+    TEST_BYTES_SET(bytes, ext_rec);
+
+    /* Unregistered external type is a generic record */
+    rec = ndef_rec_new(&bytes);
+    g_assert(rec);
+    g_assert(G_OBJECT_TYPE(rec) == NDEF_TYPE_REC);
+    g_assert(rec->tnf == NDEF_TNF_EXTERNAL);
+    g_assert(rec->rtd == NDEF_RTD_UNKNOWN);
+    ndef_rec_unref(rec);
+
+    /* Invalid registrations */
+    g_assert(!ndef_rec_type_register(NDEF_TNF_MAX + 1, &type, 0,
+        NULL, NULL, NULL));
+    g_assert(!ndef_rec_type_register(NDEF_TNF_EXTERNAL, &type,
+        G_TYPE_OBJECT, NULL, NULL, NULL));
+    ndef_rec_type_unregister(0);
+
+    id = ndef_rec_type_register(NDEF_TNF_EXTERNAL, &type, TEST_TYPE_REC,
+        test_register_init, &count, test_register_destroy);
+    g_assert(id);
+
+    rec = ndef_rec_new(&bytes);
+    g_assert(rec);
+    g_assert(G_OBJECT_TYPE(rec) == TEST_TYPE_REC);
+    g_assert(rec->tnf == NDEF_TNF_EXTERNAL);
+    g_assert(rec->flags & NDEF_REC_FLAG_FIRST);
+    g_assert(rec->flags & NDEF_REC_FLAG_LAST);
+    g_assert_cmpuint(rec->payload.size, == ,1);
+    g_assert_cmpint(TEST_REC(rec)->value, == ,1);
+    g_assert_cmpint(count, == ,1);
+    ndef_rec_unref(rec);
+
+    /* Init callback rejects empty payload, falling back to generic */
+    TEST_BYTES_SET(bytes, ext_rec_empty);
+    rec = ndef_rec_new(&bytes);
+    g_assert(rec);
+    g_assert(G_OBJECT_TYPE(rec) == NDEF_TYPE_REC);
+    g_assert_cmpint(count, == ,2);
+    ndef_rec_unref(rec);
+
+    /* Unregistering invokes destroy notify */
+    ndef_rec_type_unregister(id);
+    g_assert_cmpint(count, == ,-1);
+    ndef_rec_type_unregister(id);
+
+    rec = ndef_rec_new(&bytes);
+    g_assert(rec);
+    g_assert(G_OBJECT_TYPE(rec) == NDEF_TYPE_REC);
+    ndef_rec_unref(rec);
+}
+
+/*==========================================================================*
+ * register_override
+ *==========================================================================*/
+
+static
+void
+test_register_override(
+    void)
+{
+    static const guint8 uri_type[] = { 'U' };
+    static const guint8 data[] = {
+        0xd1,       /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,       /* Length of the record type */
+        0x04,       /* Length of the record payload */
+        'U',        /* Record type: 'U' */
+        0x00, 'a', 'b', 'c'
+    };
+    GUtilData type, bytes;
+    NdefRec* rec;
+    int count1 = 0, count2 = 0;
+    guint id1, id2;
+
+    TEST_BYTES_SET(type, uri_type);
+    TEST_BYTES_SET(bytes, data);
+
+    /* Default GType, overrides the built-in URI record */
+    id1 = ndef_rec_type_register(NDEF_TNF_WELL_KNOWN, &type, 0,
+        test_register_init, &count1, test_register_destroy);
+    g_assert(id1);
+    rec = ndef_rec_new(&bytes);
+    g_assert(rec);
+    g_assert(G_OBJECT_TYPE(rec) == NDEF_TYPE_REC);
+    g_assert(rec->tnf == NDEF_TNF_WELL_KNOWN);
+    g_assert(rec->rtd == NDEF_RTD_UNKNOWN);
+    g_assert_cmpint(count1, == ,1);
+    ndef_rec_unref(rec);
+
+    /* Registering the same type again replaces the previous handler */
+    id2 = ndef_rec_type_register(NDEF_TNF_WELL_KNOWN, &type, 0,
+        NULL, &count2, test_register_destroy);
+    g_assert(id2);
+    g_assert(id2 != id1);
+    g_assert_cmpint(count1, == ,-1);
+    rec = ndef_rec_new(&bytes);
+    g_assert(rec);
+    g_assert(G_OBJECT_TYPE(rec) == NDEF_TYPE_REC);
+    ndef_rec_unref(rec);
+
+    /* Stale id is ignored */
+    ndef_rec_type_unregister(id1);
+    g_assert_cmpint(count2, == ,0);
+    ndef_rec_type_unregister(id2);
+    g_assert_cmpint(count2, == ,-1);
+
+    /* Built-in handler is back */
+    rec = ndef_rec_new(&bytes);
+    g_assert(NDEF_IS_REC_U(rec));
+    g_assert(rec->rtd == NDEF_RTD_URI);
+    ndef_rec_unref(rec);
+}
+
+/*==========================================================================*
+ * register_threads
+ *==========================================================================*/
+
+#define TEST_REGISTER_THREADS (4)
+#define TEST_REGISTER_LOOPS (200)
+
+static const guint8 test_register_threads_type[] = { 'a', 'b', ':', 'c' };
+static const guint8 test_register_threads_rec[] = {
+    0xd4,       /* NDEF record header (MB,ME,SR,TNF=0x04) */
+    0x04,       /* Length of the record type */
+    0x01,       /* Length of the record payload */
+    'a', 'b', ':', 'c',
+    0x00
+};
+
+static
+gpointer
+test_register_threads_proc(
+    gpointer data)
+{
+    gint* done = data;
+    GUtilData bytes;
+
+    TEST_BYTES_SET(bytes, test_register_threads_rec);
+    while (!g_atomic_int_get(done)) {
+        NdefRec* rec = ndef_rec_new(&bytes);
+        const GType type = G_OBJECT_TYPE(rec);
+
+        g_assert(type == TEST_TYPE_REC || type == NDEF_TYPE_REC);
+        ndef_rec_unref(rec);
+    }
+    return NULL;
+}
+
+static
+void
+test_register_threads(
+    void)
+{
+    GThread* threads[TEST_REGISTER_THREADS];
+    GUtilData type;
+    gint done = FALSE;
+    guint i;
+
+    /* Handlers come and go while other threads are parsing */
+    TEST_BYTES_SET(type, test_register_threads_type);
+    for (i = 0; i < TEST_REGISTER_THREADS; i++) {
+        threads[i] = g_thread_new("test", test_register_threads_proc, &done);
+    }
+    for (i = 0; i < TEST_REGISTER_LOOPS; i++) {
+        const guint id = ndef_rec_type_register(NDEF_TNF_EXTERNAL, &type,
+            TEST_TYPE_REC, NULL, NULL, NULL);
+
+        g_assert(id);
+        ndef_rec_type_unregister(id);
+    }
+    g_atomic_int_set(&done, TRUE);
+    for (i = 0; i < TEST_REGISTER_THREADS; i++) {
+        g_thread_join(threads[i]);
+    }
+}
+
+/*==========================================================================*
+ * many
+ *==========================================================================*/
+
+static
+guint
+test_chain_length(
+    NdefRec* rec)
+{
+    guint n = 0;
+
+    while (rec) {
+        n++;
+        rec = rec->next;
+    }
+    return n;
+}
+
+static
+void
+test_many(
+    void)
+{
+    /*
+     * Each record is just the header (SR,TNF=0x00) with zero type and
+     * payload lengths. Freeing the chain used to recurse once per record
+     * which would overflow the stack with a message like this one.
+     */
+    const guint n = 1000000;
+    const gsize size = 3 * n;
+    guint8* data = g_malloc0(size);
+    GUtilData block;
+    NdefRec* rec;
+    NdefRec* middle;
+    guint i;
+
+    for (i = 0; i < n; i++) {
+        data[3 * i] = NDEF_HDR_SR;
+    }
+    data[0] |= NDEF_HDR_MB;
+    data[size - 3] |= NDEF_HDR_ME;
+    block.bytes = data;
+    block.size = size;
+
+    rec = ndef_rec_new(&block);
+    g_free(data);
+    g_assert(rec);
+    g_assert(rec->flags & NDEF_REC_FLAG_FIRST);
+    g_assert_cmpuint(test_chain_length(rec), == ,n);
+
+    /* Hold a reference in the middle of the chain */
+    middle = rec;
+    for (i = 0; i < n / 2; i++) {
+        middle = middle->next;
+    }
+    ndef_rec_ref(middle);
+
+    /* The first half goes away, the second one survives */
+    ndef_rec_unref(rec);
+    g_assert_cmpuint(test_chain_length(middle), == ,n - n / 2);
+    g_assert(!(middle->flags & NDEF_REC_FLAG_FIRST));
+    ndef_rec_unref(middle);
+}
+
+/*==========================================================================*
+ * limits
+ *==========================================================================*/
+
+static const guint8 test_limits_data[] = {
+    0x91,       /* NDEF record header (MB,SR,TNF=0x01) */
+    0x01,       /* Length of the record type */
+    0x02,       /* Length of the record payload */
+    'x',        /* Record type: 'x' */
+    'a', 'b',
+    0x32,       /* NDEF record header (CF,SR,TNF=0x02) */
+    0x03,       /* Length of the record type */
+    0x02,       /* Length of the record payload */
+    'a', '/', 'b',
+    'c', 'd',
+    0x16,       /* NDEF record header (SR,TNF=0x06) */
+    0x00,       /* Length of the record type */
+    0x03,       /* Length of the record payload */
+    'e', 'f', 'g',
+    0x51,       /* NDEF record header (ME,SR,TNF=0x01) */
+    0x01,       /* Length of the record type */
+    0x00,       /* Length of the record payload */
+    'y'         /* Record type: 'y' */
+};
+
+static
+void
+test_limits_set(
+    guint max_records,
+    guint max_payload,
+    gsize max_alloc,
+    guint max_depth)
+{
+    NdefParseLimits limits;
+
+    limits.max_records = max_records;
+    limits.max_payload = max_payload;
+    limits.max_alloc = max_alloc;
+    limits.max_depth = max_depth;
+    ndef_parse_limits_set(&limits);
+}
+
+/*
+ * Builds a chain of n Smart Posters, each one containing a URI record
+ * and the next Smart Poster. The innermost one contains just the URI.
+ */
+static
+GBytes*
+test_limits_nested_sp(
+    guint n)
+{
+    static const guint8 uri[] = {
+        0x91,       /* NDEF record header (MB,SR,TNF=0x01) */
+        0x01,       /* Length of the record type */
+        0x02,       /* Length of the record payload */
+        'U',        /* Record type: 'U' */
+        0x00, 'a'
+    };
+    GByteArray* content = g_byte_array_new();
+    guint i;
+
+    g_byte_array_append(content, uri, sizeof(uri));
+    content->data[0] |= NDEF_HDR_ME;
+    for (i = 0; i < n; i++) {
+        const gboolean top = (i + 1 == n);
+        GByteArray* buf = g_byte_array_new();
+        guint8 sp[8];
+
+        if (!top) {
+            g_byte_array_append(buf, uri, sizeof(uri));
+        }
+        sp[0] = (top ? NDEF_HDR_MB : 0) | NDEF_HDR_ME | NDEF_TNF_WELL_KNOWN;
+        sp[1] = 2;
+        sp[2] = (guint8)(content->len >> 24);
+        sp[3] = (guint8)(content->len >> 16);
+        sp[4] = (guint8)(content->len >> 8);
+        sp[5] = (guint8)content->len;
+        sp[6] = 'S';
+        sp[7] = 'p';
+        g_byte_array_append(buf, sp, sizeof(sp));
+        g_byte_array_append(buf, content->data, content->len);
+        g_byte_array_free(content, TRUE);
+        content = buf;
+    }
+    return g_byte_array_free_to_bytes(content);
+}
+
+static
+void
+test_limits_defaults(
+    void)
+{
+    NdefParseLimits limits;
+
+    ndef_parse_limits_get(NULL);
+    test_limits_set(1, 2, 3, 4);
+    ndef_parse_limits_get(&limits);
+    g_assert_cmpuint(limits.max_records, == ,1);
+    g_assert_cmpuint(limits.max_payload, == ,2);
+    g_assert_cmpuint(limits.max_alloc, == ,3);
+    g_assert_cmpuint(limits.max_depth, == ,4);
+
+    /* Switching back and forth reuses the snapshots */
+    test_limits_set(5, 6, 7, 8);
+    test_limits_set(1, 2, 3, 4);
+    ndef_parse_limits_get(&limits);
+    g_assert_cmpuint(limits.max_records, == ,1);
+    g_assert_cmpuint(limits.max_depth, == ,4);
+    test_limits_set(0, 0, 0, NDEF_PARSE_DEFAULT_MAX_DEPTH);
+    ndef_parse_limits_get(&limits);
+    g_assert_cmpuint(limits.max_records, == ,0);
+    g_assert_cmpuint(limits.max_depth, == ,NDEF_PARSE_DEFAULT_MAX_DEPTH);
+
+    ndef_parse_limits_set(NULL);
+    ndef_parse_limits_get(&limits);
+    g_assert_cmpuint(limits.max_records, == ,0);
+    g_assert_cmpuint(limits.max_payload, == ,0);
+    g_assert_cmpuint(limits.max_alloc, == ,0);
+    g_assert_cmpuint(limits.max_depth, == ,NDEF_PARSE_DEFAULT_MAX_DEPTH);
+}
+
+static
+void
+test_limits_records(
+    void)
+{
+    GUtilData block;
+    NdefRec* rec;
+
+    /* Chunks make up a single record */
+    TEST_BYTES_SET(block, test_limits_data);
+    test_limits_set(3, 0, 0, 0);
+    rec = ndef_rec_new(&block);
+    g_assert_cmpuint(test_chain_length(rec), == ,3);
+    ndef_rec_unref(rec);
+
+    test_limits_set(2, 0, 0, 0);
+    g_assert(!ndef_rec_new(&block));
+    g_assert(!ndef_rec_new_full(&block, NDEF_PARSE_FLAG_SHARED_STORAGE));
+    ndef_parse_limits_set(NULL);
+}
+
+static
+void
+test_limits_payload(
+    void)
+{
+    GUtilData block;
+    NdefRec* rec;
+
+    /* Payload of the chunked record is the sum of the chunks */
+    TEST_BYTES_SET(block, test_limits_data);
+    test_limits_set(0, 5, 0, 0);
+    rec = ndef_rec_new(&block);
+    g_assert_cmpuint(test_chain_length(rec), == ,3);
+    g_assert_cmpuint(rec->next->payload.size, == ,5);
+    ndef_rec_unref(rec);
+
+    test_limits_set(0, 4, 0, 0);
+    g_assert(!ndef_rec_new(&block));
+    ndef_parse_limits_set(NULL);
+}
+
+static
+void
+test_limits_alloc(
+    void)
+{
+    GBytes* bytes;
+    GUtilData block;
+    NdefRec* rec;
+
+    /* The raw data gets copied */
+    TEST_BYTES_SET(block, test_limits_data);
+    test_limits_set(0, 0, sizeof(test_limits_data), 0);
+    rec = ndef_rec_new(&block);
+    g_assert_cmpuint(test_chain_length(rec), == ,3);
+    ndef_rec_unref(rec);
+
+    test_limits_set(0, 0, sizeof(test_limits_data) - 1, 0);
+    g_assert(!ndef_rec_new(&block));
+    g_assert(!ndef_rec_new_full(&block, NDEF_PARSE_FLAG_SHARED_STORAGE));
+
+    /* Unless it's shared */
+    test_limits_set(0, 0, 1, 0);
+    bytes = g_bytes_new_static(block.bytes, block.size);
+    rec = ndef_rec_new_bytes(bytes);
+    g_assert_cmpuint(test_chain_length(rec), == ,3);
+    ndef_rec_unref(rec);
+    g_bytes_unref(bytes);
+    ndef_parse_limits_set(NULL);
+}
+
+static
+void
+test_limits_depth(
+    void)
+{
+    const guint max = NDEF_PARSE_DEFAULT_MAX_DEPTH;
+    GBytes* ok = test_limits_nested_sp(max);
+    GBytes* deep = test_limits_nested_sp(max + 1);
+    GUtilData block;
+    NdefRec* rec;
+
+    /* Nesting is limited by default */
+    ndef_parse_limits_set(NULL);
+    rec = ndef_rec_new(gutil_data_from_bytes(&block, ok));
+    g_assert(NDEF_IS_REC_SP(rec));
+    ndef_rec_unref(rec);
+    rec = ndef_rec_new_full(&block, NDEF_PARSE_FLAG_SHARED_STORAGE);
+    g_assert(NDEF_IS_REC_SP(rec));
+    ndef_rec_unref(rec);
+
+    gutil_data_from_bytes(&block, deep);
+    g_assert(!ndef_rec_new(&block));
+    g_assert(!ndef_rec_new_full(&block, NDEF_PARSE_FLAG_SHARED_STORAGE));
+    g_assert(!ndef_rec_new_bytes(deep));
+
+    /* Lazily decoded Smart Poster remains empty */
+    rec = ndef_rec_new_full(&block, NDEF_PARSE_FLAG_LAZY);
+    g_assert(NDEF_IS_REC_SP(rec));
+    g_assert(!ndef_rec_sp_uri(NDEF_REC_SP(rec)));
+    ndef_rec_unref(rec);
+
+    /* Unless the limit is lifted */
+    test_limits_set(0, 0, 0, 0);
+    rec = ndef_rec_new(&block);
+    g_assert(NDEF_IS_REC_SP(rec));
+    g_assert_cmpstr(ndef_rec_sp_uri(NDEF_REC_SP(rec)), == ,"a");
+    ndef_rec_unref(rec);
+    rec = ndef_rec_new_full(&block, NDEF_PARSE_FLAG_LAZY);
+    g_assert_cmpstr(ndef_rec_sp_uri(NDEF_REC_SP(rec)), == ,"a");
+    ndef_rec_unref(rec);
+
+    ndef_parse_limits_set(NULL);
+    g_bytes_unref(ok);
+    g_bytes_unref(deep);
+}
+
+/*==========================================================================*
+ * hash
+ *==========================================================================*/
+
+static
+void
+test_hash(
+    void)
+{
+    static const guint8 data[] = {
+        0x91,       /* NDEF record header (MB,SR,TNF=0x01) */
+        0x01,       /* Length of the record type */
+        0x02,       /* Length of the record payload */
+        'x',        /* Record type: 'x' */
+        'a', 'b',
+        0x11,       /* NDEF record header (SR,TNF=0x01) */
+        0x01,       /* Length of the record type */
+        0x02,       /* Length of the record payload */
+        'x',        /* Record type: 'x' */
+        'a', 'b',
+        0x51,       /* NDEF record header (ME,SR,TNF=0x01) */
+        0x01,       /* Length of the record type */
+        0x02,       /* Length of the record payload */
+        'x',        /* Record type: 'x' */
+        'a', 'c'
+    };
+    static const guint8 empty_data[] = {
+        0xd0,       /* NDEF record header (MB,ME,SR,TNF=0x00) */
+        0x00,       /* Length of the record type */
+        0x00        /* Length of the record payload */
+    };
+    GUtilData block;
+    GHashTable* table;
+    NdefRec* chain1;
+    NdefRec* chain2;
+    NdefRec* empty1;
+    NdefRec* empty2;
+    NdefRec* r1;
+    NdefRec* r2;
+    NdefRec* r3;
+
+    g_assert_cmpuint(ndef_rec_hash(NULL), == ,0);
+    g_assert_cmpuint(ndef_rec_chain_hash(NULL), == ,0);
+    g_assert(ndef_rec_equal(NULL, NULL));
+    g_assert(ndef_rec_chain_equal(NULL, NULL));
+
+    TEST_BYTES_SET(block, data);
+    chain1 = ndef_rec_new(&block);
+    chain2 = ndef_rec_new_full(&block, NDEF_PARSE_FLAG_SHARED_STORAGE);
+    r1 = chain1;
+    r2 = r1->next;
+    r3 = r2->next;
+    g_assert(r3);
+    g_assert(!ndef_rec_equal(r1, NULL));
+    g_assert(!ndef_rec_equal(NULL, r1));
+    g_assert(!ndef_rec_chain_equal(r1, NULL));
+
+    /* MB and ME flags are ignored */
+    g_assert_cmpuint(ndef_rec_hash(r1), == ,ndef_rec_hash(r2));
+    g_assert_cmpuint(ndef_rec_hash(r1), != ,ndef_rec_hash(r3));
+    g_assert(ndef_rec_equal(r1, r1));
+    g_assert(ndef_rec_equal(r1, r2));
+    g_assert(!ndef_rec_equal(r2, r3));
+
+    /* Chains */
+    g_assert(ndef_rec_chain_equal(chain1, chain1));
+    g_assert(ndef_rec_chain_equal(chain1, chain2));
+    g_assert(ndef_rec_chain_equal(r2, chain2->next));
+    g_assert(!ndef_rec_chain_equal(r1, r2));
+    g_assert(!ndef_rec_chain_equal(r2, r3));
+    g_assert_cmpuint(ndef_rec_chain_hash(chain1), == ,
+        ndef_rec_chain_hash(chain2));
+    g_assert_cmpuint(ndef_rec_chain_hash(r3), == ,ndef_rec_hash(r3));
+
+    /* Empty NDEF (no raw data at all) vs empty record */
+    TEST_BYTES_SET(block, empty_data);
+    empty2 = ndef_rec_new(&block);
+    block.size = 0;
+    empty1 = ndef_rec_new(&block);
+    g_assert(empty1);
+    g_assert(empty2);
+    g_assert(!empty1->raw.size);
+    g_assert(ndef_rec_hash(empty1));
+    g_assert(!ndef_rec_equal(empty1, empty2));
+
+    /* Works as a hash table key */
+    table = g_hash_table_new(ndef_rec_hash, ndef_rec_equal);
+    g_hash_table_insert(table, r1, r1);
+    g_hash_table_insert(table, r3, r3);
+    g_assert(g_hash_table_lookup(table, r2) == r1);
+    g_assert(g_hash_table_lookup(table, chain2->next->next) == r3);
+    g_assert(!g_hash_table_lookup(table, empty2));
+    g_hash_table_destroy(table);
+
+    ndef_rec_unref(empty1);
+    ndef_rec_unref(empty2);
+    ndef_rec_unref(chain1);
+    ndef_rec_unref(chain2);
+}
+
+/*==========================================================================*
+ * iov
+ *==========================================================================*/
+
+static
+GBytes*
+test_iov_writev(
+    NdefRec* rec)
+{
+    const guint n = ndef_rec_chain_iov(rec, NULL, 0);
+    const gsize size = ndef_rec_chain_size(rec);
+    struct iovec* iov = g_new0(struct iovec, n);
+    guint8* buf = g_malloc(size);
+    int fd[2];
+
+    g_assert_cmpuint(ndef_rec_chain_iov(rec, iov, n), == ,n);
+    g_assert(!pipe(fd));
+    g_assert_cmpint(writev(fd[1], iov, n), == ,size);
+    g_assert_cmpint(read(fd[0], buf, size), == ,size);
+    close(fd[0]);
+    close(fd[1]);
+    g_free(iov);
+    return g_bytes_new_take(buf, size);
+}
+
+static
+void
+test_iov(
+    void)
+{
+    static const guint8 data[] = {
+        0x91,           /* NDEF record header (MB,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x00,           /* Length of the record payload */
+        'x',            /* Record type: 'x' */
+        0x11,           /* NDEF record header (SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x01,           /* Length of the record payload */
+        'y',            /* Record type: 'y' */
+        0x00,           /* Payload */
+        0x52,           /* NDEF record header (ME,SR,TNF=0x02) */
+        0x03,           /* Length of the record type */
+        0x00,           /* Length of the record payload */
+        'a', '/', 'b'   /* Record type */
+    };
+    static const guint8 tail[] = {
+        0x91, 0x01, 0x01, 'y', 0x00,
+        0x52, 0x03, 0x00, 'a', '/', 'b'
+    };
+    NdefRec* rec;
+    NdefRec* t1;
+    NdefRec* t2;
+    NdefMsgBuilder* builder;
+    struct iovec iov[4];
+    GBytes* expected;
+    GBytes* input;
+    GBytes* bytes;
+
+    g_assert_cmpuint(ndef_rec_chain_iov(NULL, iov, 4), == ,0);
+    g_assert_cmpuint(ndef_rec_chain_size(NULL), == ,0);
+
+    /* Message parsed without copying is a single entry */
+    input = g_bytes_new_static(data, sizeof(data));
+    rec = ndef_rec_new_bytes(input);
+    g_bytes_unref(input);
+    g_assert(rec);
+    g_assert_cmpuint(ndef_rec_chain_size(rec), == ,sizeof(data));
+    g_assert_cmpuint(ndef_rec_chain_iov(rec, iov, 4), == ,1);
+    g_assert(iov[0].iov_base == (void*)rec->raw.bytes);
+    g_assert_cmpuint(iov[0].iov_len, == ,sizeof(data));
+
+    /* The rest of the chain needs MB patched */
+    g_assert_cmpuint(ndef_rec_chain_iov(rec->next, iov, 4), == ,2);
+    g_assert_cmpuint(iov[0].iov_len, == ,1);
+    g_assert_cmpuint(*(guint8*)iov[0].iov_base, == ,0x91);
+    g_assert(iov[1].iov_base == (void*)(rec->next->raw.bytes + 1));
+    bytes = test_iov_writev(rec->next);
+    g_assert_cmpuint(g_bytes_get_size(bytes), == ,sizeof(tail));
+    g_assert(!memcmp(g_bytes_get_data(bytes, NULL), tail, sizeof(tail)));
+    g_bytes_unref(bytes);
+    ndef_rec_unref(rec);
+
+    /* Two standalone records (both MB and ME) chained together */
+    t1 = NDEF_REC(ndef_rec_t_new("Hello", "en"));
+    t2 = NDEF_REC(ndef_rec_t_new("World", "en"));
+    builder = ndef_msg_builder_new();
+    g_assert(ndef_msg_builder_add_rec(builder, t1));
+    g_assert(ndef_msg_builder_add_rec(builder, t2));
+    expected = ndef_msg_builder_bytes(builder);
+    ndef_msg_builder_free(builder);
+    t1->next = t2;
+    g_assert_cmpuint(ndef_rec_chain_iov(t1, NULL, 0), == ,4);
+
+    /* Array too small, the required count is still returned */
+    memset(iov, 0, sizeof(iov));
+    g_assert_cmpuint(ndef_rec_chain_iov(t1, iov, 1), == ,4);
+    g_assert_cmpuint(iov[0].iov_len, == ,1);
+    g_assert(!iov[1].iov_base);
+
+    bytes = test_iov_writev(t1);
+    g_assert(g_bytes_equal(bytes, expected));
+    g_bytes_unref(bytes);
+    g_bytes_unref(expected);
+    ndef_rec_unref(t1);
+}
+
 /*==========================================================================*
  * Common
  *==========================================================================*/
@@ -873,10 +2147,18 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_("empty"), test_empty);
     g_test_add_func(TEST_("short"), test_short);
     g_test_add_func(TEST_("chunked"), test_chunked);
+    g_test_add_func(TEST_("chunked_uri"), test_chunked_uri);
+    g_test_add_func(TEST_("chunked_long"), test_chunked_long);
+    g_test_add_func(TEST_("chunked_broken"), test_chunked_broken);
     g_test_add_func(TEST_("tlv"), test_tlv);
     g_test_add_func(TEST_("tlv_empty"), test_tlv_empty);
     g_test_add_func(TEST_("tlv_complex"), test_tlv_complex);
     g_test_add_func(TEST_("tlv_multiple"), test_tlv_multiple);
+    g_test_add_func(TEST_("bytes"), test_bytes);
+    g_test_add_func(TEST_("bytes_empty"), test_bytes_empty);
+    g_test_add_func(TEST_("tlv_bytes"), test_tlv_bytes);
+    g_test_add_func(TEST_("shared"), test_shared);
+    g_test_add_func(TEST_("tlv_shared"), test_tlv_shared);
     g_test_add_func(TEST_("no_type"), test_no_type);
     g_test_add_func(TEST_("uri"), test_uri);
     g_test_add_func(TEST_("well_known_short"), test_well_known_short);
@@ -889,6 +2171,17 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_("invalid_tnf"), test_invalid_tnf);
     g_test_add_func(TEST_("broken1"), test_broken1);
     g_test_add_func(TEST_("broken2"), test_broken2);
+    g_test_add_func(TEST_("register"), test_register);
+    g_test_add_func(TEST_("register_override"), test_register_override);
+    g_test_add_func(TEST_("register_threads"), test_register_threads);
+    g_test_add_func(TEST_("many"), test_many);
+    g_test_add_func(TEST_("limits_defaults"), test_limits_defaults);
+    g_test_add_func(TEST_("limits_records"), test_limits_records);
+    g_test_add_func(TEST_("limits_payload"), test_limits_payload);
+    g_test_add_func(TEST_("limits_alloc"), test_limits_alloc);
+    g_test_add_func(TEST_("limits_depth"), test_limits_depth);
+    g_test_add_func(TEST_("hash"), test_hash);
+    g_test_add_func(TEST_("iov"), test_iov);
     test_init(&test_opt, argc, argv);
     return g_test_run();
 }
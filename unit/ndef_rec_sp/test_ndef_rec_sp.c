@@ -94,6 +94,13 @@ test_null(
     g_assert(!ndef_rec_sp_new_from_data(NULL));
     g_assert(!ndef_rec_sp_new_from_data(&ndef));
     g_assert(!ndef_rec_sp_new(NULL, NULL, NULL, NULL, 0, 0, NULL));
+    g_assert(!ndef_rec_sp_uri(NULL));
+    g_assert(!ndef_rec_sp_title(NULL));
+    g_assert(!ndef_rec_sp_lang(NULL));
+    g_assert(!ndef_rec_sp_type(NULL));
+    g_assert(!ndef_rec_sp_size(NULL));
+    g_assert_cmpint(ndef_rec_sp_act(NULL), == ,NDEF_SP_ACT_DEFAULT);
+    g_assert(!ndef_rec_sp_icon(NULL));
 }
 
 /*==========================================================================*
@@ -667,6 +674,35 @@ test_valid_check(
     }
 }
 
+static
+void
+test_valid_check_lazy(
+    NdefRecSp* sp,
+    const TestValidData* test)
+{
+    const NdefMedia* icon;
+
+    g_assert(sp);
+    g_assert_cmpint(sp->rec.rtd, == ,NDEF_RTD_SMART_POSTER);
+    g_assert(!sp->uri);
+    g_assert_cmpstr(ndef_rec_sp_uri(sp), == ,test->uri);
+    g_assert_cmpstr(ndef_rec_sp_title(sp), == ,test->title);
+    g_assert_cmpstr(ndef_rec_sp_lang(sp), == ,test->lang);
+    g_assert_cmpstr(ndef_rec_sp_type(sp), == ,test->type);
+    g_assert_cmpuint(ndef_rec_sp_size(sp), == ,test->size);
+    g_assert_cmpint(ndef_rec_sp_act(sp), == ,test->act);
+    icon = ndef_rec_sp_icon(sp);
+    if (test->icon.data.bytes) {
+        g_assert(icon);
+        g_assert_cmpstr(icon->type, == ,test->icon.type);
+    } else {
+        g_assert(!icon);
+    }
+
+    /* Now the fields are filled in */
+    test_valid_check(sp, test);
+}
+
 static
 void
 test_valid(
@@ -693,6 +729,18 @@ test_valid(
     g_assert(NDEF_IS_REC_SP(rec));
     test_valid_check(NDEF_REC_SP(rec), test);
     ndef_rec_unref(rec);
+
+    rec = ndef_rec_new_full(&test->rec, NDEF_PARSE_FLAG_SHARED_STORAGE);
+    g_assert(rec);
+    g_assert(NDEF_IS_REC_SP(rec));
+    test_valid_check(NDEF_REC_SP(rec), test);
+    ndef_rec_unref(rec);
+
+    rec = ndef_rec_new_full(&test->rec, NDEF_PARSE_FLAG_LAZY);
+    g_assert(rec);
+    g_assert(NDEF_IS_REC_SP(rec));
+    test_valid_check_lazy(NDEF_REC_SP(rec), test);
+    ndef_rec_unref(rec);
 }
 
 static
@@ -789,6 +837,178 @@ test_invalid(
     rec = ndef_rec_new(&test->rec);
     g_assert(!NDEF_IS_REC_SP(rec));
     ndef_rec_unref(rec);
+
+    /* In lazy mode, the record type is determined by the header */
+    rec = ndef_rec_new_full(&test->rec, NDEF_PARSE_FLAG_LAZY);
+    g_assert(NDEF_IS_REC_SP(rec));
+    g_assert(!ndef_rec_sp_uri(NDEF_REC_SP(rec)));
+    g_assert(!ndef_rec_sp_title(NDEF_REC_SP(rec)));
+    g_assert_cmpint(ndef_rec_sp_act(NDEF_REC_SP(rec)), == ,
+        NDEF_SP_ACT_DEFAULT);
+    ndef_rec_unref(rec);
+}
+
+/*==========================================================================*
+ * encode_titles
+ *==========================================================================*/
+
+static
+void
+test_encode_titles(
+    void)
+{
+    static const guint8 expected[] = {
+        0xd1,         /* NDEF header (MB=1, ME=1, SR=1, TNF=0x01) */
+        0x02,         /* Record name length */
+        0x46,         /* Length of the Smart Poster data */
+        'S','p',      /* The record name "Sp" */
+
+        0x91,         /* NDEF header (MB=1, SR=1, TNF=0x01) */
+        0x01,         /* Record name length (1 byte) */
+        0x0e,         /* The length of the URI payload */
+       'U',           /* Record type: 'U' (URI) */
+        0x01,         /* Abbreviation: "http://www." */
+        'n','f','c','-','f','o','r','u','m','.','o','r','g',
+
+        0x11,         /* NDEF header (SR=1, TNF=0x01) */
+        0x01,         /* Length of the record name */
+        0x12,         /* Length of the record payload */
+        'T',          /* Record type: 'T' (Text) */
+        0x05,         /* Status byte (UTF-8, five-byte code) */
+        'e','n','-','U','S',
+        'H','e','l','l','o',',',' ','w','o','r','l','d',
+
+        0x11,         /* NDEF header (SR=1, TNF=0x01) */
+        0x01,         /* Record name length */
+        0x13,         /* Length of the Text payload */
+        'T',          /* Record type: 'T' (Text) */
+        0x02,         /* Status byte (UTF-8, two-byte language code) */
+        'f','i',
+        'M','o','r','j','e','n','s',',',' ','m','a','a','i','l','m','a',
+
+        0x51,         /* NDEF header (ME=1, SR=1, TNF=0x01) */
+        0x03,         /* The length of the record name */
+        0x01,         /* The length of the "act" payload */
+        'a','c','t',  /* Record type: "act" */
+        0x00          /* Action = Launch browser */
+    };
+    static const NdefSpTitle titles[] = {
+        { "Hello, world", "en-US" },
+        { "Morjens, maailma", "fi" }
+    };
+    static const char uri[] = "http://www.nfc-forum.org";
+    NdefRecSp* sp;
+    NdefRec* rec;
+
+    /* No system language, the first title is the default one */
+    test_system_locale = NULL;
+    g_assert(!ndef_rec_sp_new_full(NULL, titles, 2, NULL, 0,
+        NDEF_SP_ACT_OPEN, NULL));
+    g_assert(!ndef_rec_sp_new_full(uri, NULL, 2, NULL, 0,
+        NDEF_SP_ACT_OPEN, NULL));
+    sp = ndef_rec_sp_new_full(uri, titles, G_N_ELEMENTS(titles), NULL, 0,
+        NDEF_SP_ACT_OPEN, NULL);
+    g_assert(sp);
+    test_dump_data(&sp->rec.raw);
+    g_assert_cmpuint(sp->rec.raw.size, == ,sizeof(expected));
+    g_assert(!memcmp(sp->rec.raw.bytes, expected, sizeof(expected)));
+    g_assert_cmpstr(sp->uri, == ,uri);
+    g_assert_cmpstr(sp->title, == ,"Hello, world");
+    g_assert_cmpstr(sp->lang, == ,"en-US");
+    g_assert_cmpint(sp->act, == ,NDEF_SP_ACT_OPEN);
+    ndef_rec_unref(&sp->rec);
+
+    /* Same title is picked when the record is encoded and parsed */
+    test_system_locale = "fi";
+    sp = ndef_rec_sp_new_full(uri, titles, G_N_ELEMENTS(titles), NULL, 0,
+        NDEF_SP_ACT_OPEN, NULL);
+    g_assert(sp);
+    g_assert(!memcmp(sp->rec.raw.bytes, expected, sizeof(expected)));
+    g_assert_cmpstr(sp->title, == ,"Morjens, maailma");
+    g_assert_cmpstr(sp->lang, == ,"fi");
+    rec = ndef_rec_new(&sp->rec.raw);
+    g_assert(NDEF_IS_REC_SP(rec));
+    g_assert_cmpstr(NDEF_REC_SP(rec)->title, == ,"Morjens, maailma");
+    g_assert_cmpstr(NDEF_REC_SP(rec)->lang, == ,"fi");
+    ndef_rec_unref(rec);
+    ndef_rec_unref(&sp->rec);
+    test_system_locale = NULL;
+}
+
+/*==========================================================================*
+ * encode_misc
+ *==========================================================================*/
+
+static
+void
+test_encode_misc(
+    void)
+{
+    static const guint8 icon_data[] = { 'f', 'o', 'o' };
+    static const char uri[] = "https://www.sailfishos.org";
+    static const NdefSpTitle no_lang[] = {
+        { NULL, NULL }
+    };
+    static const NdefSpTitle bad_lang[] = {
+        { "x", "0123456789012345678901234567890123456789012345678901234567"
+          "8901234567890" }
+    };
+    NdefMedia icon;
+    NdefRecSp* sp;
+    NdefRec* rec;
+
+    /* Language code too long */
+    g_assert(!ndef_rec_sp_new_full(uri, bad_lang, 1, NULL, 0,
+        NDEF_SP_ACT_DEFAULT, NULL));
+
+    /* System language is used if none is given */
+    test_system_locale = "fi";
+    sp = ndef_rec_sp_new_full(uri, no_lang, 1, NULL, 0,
+        NDEF_SP_ACT_DEFAULT, NULL);
+    g_assert(sp);
+    g_assert_cmpstr(sp->title, == ,"");
+    g_assert_cmpstr(sp->lang, == ,"fi");
+    ndef_rec_unref(&sp->rec);
+    test_system_locale = NULL;
+    sp = ndef_rec_sp_new_full(uri, no_lang, 1, NULL, 0,
+        NDEF_SP_ACT_DEFAULT, NULL);
+    g_assert(sp);
+    g_assert_cmpstr(sp->lang, == ,"en");
+    ndef_rec_unref(&sp->rec);
+
+    /* Invalid icon is dropped */
+    icon.type = "foo";
+    icon.data.bytes = icon_data;
+    icon.data.size = sizeof(icon_data);
+    sp = ndef_rec_sp_new_full(uri, NULL, 0, NULL, 0,
+        NDEF_SP_ACT_DEFAULT, &icon);
+    g_assert(sp);
+    g_assert(!sp->icon);
+    ndef_rec_unref(&sp->rec);
+
+    /* Valid icon points into the record */
+    icon.type = "image/foo";
+    sp = ndef_rec_sp_new_full(uri, NULL, 0, "text/html", 1234,
+        NDEF_SP_ACT_SAVE, &icon);
+    g_assert(sp);
+    g_assert(sp->icon);
+    g_assert_cmpstr(sp->icon->type, == ,icon.type);
+    g_assert(gutil_data_equal(&sp->icon->data, &icon.data));
+    g_assert(sp->icon->data.bytes >= sp->rec.raw.bytes);
+    g_assert(sp->icon->data.bytes + sp->icon->data.size ==
+        sp->rec.raw.bytes + sp->rec.raw.size);
+
+    /* Everything survives the round trip */
+    rec = ndef_rec_new(&sp->rec.raw);
+    g_assert(NDEF_IS_REC_SP(rec));
+    g_assert_cmpstr(NDEF_REC_SP(rec)->uri, == ,uri);
+    g_assert_cmpstr(NDEF_REC_SP(rec)->type, == ,"text/html");
+    g_assert_cmpuint(NDEF_REC_SP(rec)->size, == ,1234);
+    g_assert_cmpint(NDEF_REC_SP(rec)->act, == ,NDEF_SP_ACT_SAVE);
+    g_assert(NDEF_REC_SP(rec)->icon);
+    g_assert(gutil_data_equal(&NDEF_REC_SP(rec)->icon->data, &icon.data));
+    ndef_rec_unref(rec);
+    ndef_rec_unref(&sp->rec);
 }
 
 /*==========================================================================*
@@ -827,6 +1047,8 @@ int main(int argc, char* argv[])
         g_test_add_data_func(path, test, test_encode);
         g_free(path);
     }
+    g_test_add_func(TEST_("encode_titles"), test_encode_titles);
+    g_test_add_func(TEST_("encode_misc"), test_encode_misc);
     test_init(&test_opt, argc, argv);
     return g_test_run();
 }
@@ -71,6 +71,8 @@ test_null(
     g_assert(!ndef_rec_t_new_from_data(&ndef));
     g_assert(!ndef_rec_t_steal_lang(NULL));
     g_assert(!ndef_rec_t_steal_text(NULL));
+    g_assert(!ndef_rec_t_lang(NULL));
+    g_assert(!ndef_rec_t_text(NULL));
 }
 
 /*==========================================================================*
@@ -617,6 +619,81 @@ test_utf8(
     ndef_rec_unref(&trec->rec);
 }
 
+/*==========================================================================*
+ * lazy
+ *==========================================================================*/
+
+static
+void
+test_lazy(
+    void)
+{
+    static const guint8 bad_lang_rec[] = {
+        0xd1,           /* NDEF record header (MB=1, ME=1, SR=1, TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x03,           /* Length of the record payload (3 bytes) */
+        'T',            /* Record type: 'T' (Text) */
+        0x05,           /* Language code doesn't fit into the payload */
+        'e', 'n'
+    };
+    GUtilData data;
+    NdefLanguage l;
+    NdefRecT* trec;
+    NdefRec* rec;
+    const char* text;
+
+    TEST_BYTES_SET(data, test_utf16BE);
+    rec = ndef_rec_new_full(&data, NDEF_PARSE_FLAG_LAZY);
+    g_assert(rec);
+    g_assert(NDEF_IS_REC_T(rec));
+    g_assert_cmpint(rec->rtd, == ,NDEF_RTD_TEXT);
+    trec = NDEF_REC_T(rec);
+
+    /* Not decoded until asked */
+    g_assert(!trec->text);
+    g_assert(!trec->lang);
+    text = ndef_rec_t_text(trec);
+    g_assert_cmpstr(text, == ,"omprussia");
+    g_assert(trec->text == text);
+    g_assert_cmpstr(trec->lang, == ,"en");
+    g_assert(ndef_rec_t_lang(trec) == trec->lang);
+    g_assert(ndef_rec_t_text(trec) == text);
+    ndef_rec_unref(rec);
+
+    /* ndef_rec_t_lang_match() decodes the language too */
+    rec = ndef_rec_new_full(&data, NDEF_PARSE_FLAG_LAZY);
+    trec = NDEF_REC_T(rec);
+    g_assert(!trec->lang);
+    memset(&l, 0, sizeof(l));
+    l.language = "en";
+    g_assert_cmpint(ndef_rec_t_lang_match(trec, &l), == ,
+        NDEF_LANG_MATCH_LANGUAGE);
+    g_assert_cmpstr(trec->lang, == ,"en");
+    ndef_rec_unref(rec);
+
+    /* Invalid text is only detected on access */
+    TEST_BYTES_SET(data, invalid_utf16_rec);
+    rec = ndef_rec_new_full(&data, NDEF_PARSE_FLAG_LAZY);
+    g_assert(rec);
+    g_assert(NDEF_IS_REC_T(rec));
+    trec = NDEF_REC_T(rec);
+    g_assert(!ndef_rec_t_text(trec));
+    g_assert(!ndef_rec_t_lang(trec));
+    g_assert(!ndef_rec_t_lang_match(trec, &l));
+    ndef_rec_unref(rec);
+
+    /* But the language code is checked right away, same as eagerly */
+    TEST_BYTES_SET(data, bad_lang_rec);
+    rec = ndef_rec_new_full(&data, NDEF_PARSE_FLAG_LAZY);
+    g_assert(rec);
+    g_assert(!NDEF_IS_REC_T(rec));
+    ndef_rec_unref(rec);
+    rec = ndef_rec_new(&data);
+    g_assert(rec);
+    g_assert(!NDEF_IS_REC_T(rec));
+    ndef_rec_unref(rec);
+}
+
 /*==========================================================================*
  * Common
  *==========================================================================*/
@@ -642,6 +719,7 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_("default_lang"), test_default_lang);
     g_test_add_func(TEST_("locale"), test_locale);
     g_test_add_func(TEST_("lang_match"), test_lang_match);
+    g_test_add_func(TEST_("lazy"), test_lazy);
 
     for (i = 0; i < G_N_ELEMENTS(tests_invalid); i++) {
         const TestInvalid* test = tests_invalid + i;
@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "test_common.h"
+
+#include "ndef_stats.h"
+#include "ndef_tlv.h"
+
+static TestOpt test_opt;
+
+/*==========================================================================*
+ * null
+ *==========================================================================*/
+
+static
+void
+test_null(
+    void)
+{
+    ndef_stats_get(NULL);
+}
+
+/*==========================================================================*
+ * disabled
+ *==========================================================================*/
+
+static
+void
+test_disabled(
+    void)
+{
+    static const guint8 data[] = {
+        0xd1,       /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,       /* Length of the record type */
+        0x00,       /* Length of the record payload */
+        'x'         /* Record type: 'x' */
+    };
+    NdefStats zero, stats;
+    GUtilData block;
+
+    ndef_stats_enable(FALSE);
+    ndef_stats_reset();
+    g_assert(!ndef_stats_enabled());
+
+    TEST_BYTES_SET(block, data);
+    ndef_rec_unref(ndef_rec_new(&block));
+
+    memset(&zero, 0, sizeof(zero));
+    memset(&stats, 0xaa, sizeof(stats));
+    ndef_stats_get(&stats);
+    g_assert(!memcmp(&stats, &zero, sizeof(stats)));
+}
+
+/*==========================================================================*
+ * basic
+ *==========================================================================*/
+
+static
+void
+test_basic(
+    void)
+{
+    static const guint8 data[] = {
+        0x91,       /* NDEF record header (MB,SR,TNF=0x01) */
+        0x01,       /* Length of the record type */
+        0x04,       /* Length of the record payload */
+        'U',        /* Record type: 'U' */
+        0x00, 'a', ':', 'b',
+        0x11,       /* NDEF record header (SR,TNF=0x01) */
+        0x01,       /* Length of the record type */
+        0x03,       /* Length of the record payload */
+        'T',        /* Record type: 'T' */
+        0x00, 0xff, 0xfe, /* Not UTF-8 */
+        0x14,       /* NDEF record header (SR,TNF=0x04) */
+        0x03,       /* Length of the record type */
+        0x00,       /* Length of the record payload */
+        'a', ':', 'b',
+        0x32,       /* NDEF record header (CF,SR,TNF=0x02) */
+        0x03,       /* Length of the record type */
+        0x01,       /* Length of the record payload */
+        'a', '/', 'b', 0x00,
+        0x16,       /* NDEF record header (SR,TNF=0x06) */
+        0x00,       /* Length of the record type */
+        0x01,       /* Length of the record payload */
+        0x00,
+        0x16,       /* NDEF record header (SR,TNF=0x06) - stray chunk */
+        0x00,       /* Length of the record type */
+        0x00,       /* Length of the record payload */
+        0x51,       /* NDEF record header (ME,SR,TNF=0x01) */
+        0x01,       /* Length of the record type */
+        0x05,       /* Length of the record payload (too long) */
+        'x'
+    };
+    NdefStats stats;
+    GUtilData block;
+    NdefRec* rec;
+
+    ndef_stats_enable(TRUE);
+    ndef_stats_reset();
+    g_assert(ndef_stats_enabled());
+
+    TEST_BYTES_SET(block, data);
+    rec = ndef_rec_new(&block);
+    g_assert(rec);
+    ndef_stats_get(&stats);
+    ndef_stats_enable(FALSE);
+    ndef_rec_unref(rec);
+
+    /* URI, Generic (broken Text), external and media type */
+    g_assert_cmpuint(stats.rec_tnf[NDEF_TNF_EMPTY], == ,0);
+    g_assert_cmpuint(stats.rec_tnf[NDEF_TNF_WELL_KNOWN], == ,2);
+    g_assert_cmpuint(stats.rec_tnf[NDEF_TNF_MEDIA_TYPE], == ,1);
+    g_assert_cmpuint(stats.rec_tnf[NDEF_TNF_ABSOLUTE_URI], == ,0);
+    g_assert_cmpuint(stats.rec_tnf[NDEF_TNF_EXTERNAL], == ,1);
+    g_assert_cmpuint(stats.rec_rtd[NDEF_RTD_UNKNOWN], == ,3);
+    g_assert_cmpuint(stats.rec_rtd[NDEF_RTD_URI], == ,1);
+    g_assert_cmpuint(stats.rec_rtd[NDEF_RTD_TEXT], == ,0);
+    g_assert_cmpuint(stats.rec_rtd[NDEF_RTD_SMART_POSTER], == ,0);
+    g_assert_cmpuint(stats.bytes, == ,sizeof(data));
+    g_assert_cmpuint(stats.garbage, == ,1);
+    g_assert_cmpuint(stats.chunked, == ,1);
+    g_assert_cmpuint(stats.chunked_dropped, == ,1);
+    g_assert_cmpuint(stats.text_errors, == ,1);
+    g_assert(stats.allocs >= 4);
+}
+
+/*==========================================================================*
+ * tlv
+ *==========================================================================*/
+
+static
+void
+test_tlv(
+    void)
+{
+    static const guint8 data[] = {
+        TLV_NDEF_MESSAGE, /* Value type */
+        0x04,             /* Value length */
+        0xd1,             /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,             /* Length of the record type */
+        0x00,             /* Length of the record payload */
+        'x',              /* Record type: 'x' */
+        TLV_NDEF_MESSAGE, /* Value type */
+        0x00,             /* Value length */
+        TLV_TERMINATOR
+    };
+    NdefStats stats;
+    GUtilData block;
+    NdefRec* rec;
+
+    ndef_stats_enable(TRUE);
+    ndef_stats_reset();
+
+    /* Only NDEF bytes are counted, not the TLV overhead */
+    TEST_BYTES_SET(block, data);
+    rec = ndef_rec_new_from_tlv(&block);
+    g_assert(rec);
+    ndef_stats_get(&stats);
+    ndef_stats_enable(FALSE);
+    ndef_rec_unref(rec);
+
+    g_assert_cmpuint(stats.bytes, == ,4);
+    g_assert_cmpuint(stats.rec_tnf[NDEF_TNF_WELL_KNOWN], == ,1);
+    g_assert_cmpuint(stats.rec_tnf[NDEF_TNF_EMPTY], == ,1);
+    g_assert_cmpuint(stats.rec_rtd[NDEF_RTD_UNKNOWN], == ,2);
+    g_assert_cmpuint(stats.garbage, == ,0);
+}
+
+/*==========================================================================*
+ * unknown
+ *==========================================================================*/
+
+static
+void
+test_unknown(
+    void)
+{
+    static const guint8 data[] = {
+        0xd5,           /* NDEF record header (MB,ME,SR,TNF=0x05) */
+        0x00,           /* Length of the record type */
+        0x01,           /* Length of the record payload */
+        0x01            /* Payload */
+    };
+    NdefStats stats;
+    GUtilData block;
+    NdefRec* rec;
+    guint i;
+
+    ndef_stats_enable(TRUE);
+    ndef_stats_reset();
+
+    /* TNF values without NDEF_TNF counterparts are counted too */
+    TEST_BYTES_SET(block, data);
+    rec = ndef_rec_new(&block);
+    g_assert(rec);
+    ndef_stats_get(&stats);
+    ndef_stats_enable(FALSE);
+    ndef_rec_unref(rec);
+
+    g_assert_cmpuint(stats.rec_tnf[NDEF_TNF_EMPTY], == ,0);
+    g_assert_cmpuint(stats.rec_tnf[0x05], == ,1);
+    g_assert_cmpuint(stats.rec_rtd[NDEF_RTD_UNKNOWN], == ,1);
+    for (i = 0; i < G_N_ELEMENTS(stats.reserved); i++) {
+        g_assert_cmpuint(stats.reserved[i], == ,0);
+    }
+}
+
+/*==========================================================================*
+ * Common
+ *==========================================================================*/
+
+#define TEST_(t) "/ndef_stats/" t
+
+int main(int argc, char* argv[])
+{
+    G_GNUC_BEGIN_IGNORE_DEPRECATIONS;
+    g_type_init();
+    G_GNUC_END_IGNORE_DEPRECATIONS;
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func(TEST_("null"), test_null);
+    g_test_add_func(TEST_("disabled"), test_disabled);
+    g_test_add_func(TEST_("basic"), test_basic);
+    g_test_add_func(TEST_("tlv"), test_tlv);
+    g_test_add_func(TEST_("unknown"), test_unknown);
+    test_init(&test_opt, argc, argv);
+    return g_test_run();
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -39,10 +39,12 @@
 #include "test_common.h"
 
 #include "ndef_tlv.h"
+#include "ndef_rec.h"
 
 static TestOpt test_opt;
 
 #define TLV_TEST (0x04)
+#define NDEF_TEST_TLV_MAX (0xfffe)
 
 /*==========================================================================*
  * tlv_null
@@ -199,6 +201,287 @@ test_tlv_ndef(
     g_assert_cmpuint(ndef_tlv_next(&buf, &value), == ,0);
 }
 
+/*==========================================================================*
+ * encode_null
+ *==========================================================================*/
+
+static
+void
+test_tlv_encode_null(
+    void)
+{
+    static const guint8 big[NDEF_TEST_TLV_MAX + 1] = { 0 };
+    static const guint8 short_buf[2] = { 0 };
+    GUtilData data, msg;
+    NdefTlvParams params;
+    GByteArray* out = g_byte_array_new();
+    guint8 buf[8];
+
+    memset(&msg, 0, sizeof(msg));
+    g_assert_cmpuint(ndef_tlv_encode(NULL, NULL, buf, sizeof(buf)), == ,0);
+    g_assert_cmpuint(ndef_tlv_encode_rec(NULL, NULL, buf, sizeof(buf)),
+        == ,0);
+    g_assert_cmpuint(ndef_tlv_append(NULL, &msg, NULL), == ,0);
+    g_assert_cmpuint(ndef_tlv_append(out, NULL, NULL), == ,0);
+    g_assert_cmpuint(ndef_tlv_append_rec(out, NULL, NULL), == ,0);
+
+    /* Buffer too small */
+    g_assert_cmpuint(ndef_tlv_encode(&msg, NULL, buf, 2), == ,0);
+
+    /* Message too large */
+    TEST_BYTES_SET(data, big);
+    g_assert_cmpuint(ndef_tlv_encode(&data, NULL, NULL, 0), == ,0);
+    g_assert_cmpuint(ndef_tlv_append(out, &data, NULL), == ,0);
+
+    /* Control TLV too large */
+    memset(&params, 0, sizeof(params));
+    params.lock_control = &data;
+    params.lock_control_count = 1;
+    g_assert_cmpuint(ndef_tlv_encode(&msg, &params, NULL, 0), == ,0);
+    TEST_BYTES_SET(data, short_buf);
+    g_assert_cmpuint(ndef_tlv_encode(&msg, &params, NULL, 0), == ,7);
+    g_assert_cmpuint(out->len, == ,0);
+    g_byte_array_free(out, TRUE);
+}
+
+/*==========================================================================*
+ * encode_basic
+ *==========================================================================*/
+
+static
+void
+test_tlv_encode_basic(
+    void)
+{
+    static const guint8 ndef[] = {
+        0xd1,           /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x00,           /* Length of the record payload */
+        'x'             /* Record type: 'x' */
+    };
+    static const guint8 expected[] = {
+        TLV_NDEF_MESSAGE, sizeof(ndef),
+        0xd1, 0x01, 0x00, 'x',
+        TLV_TERMINATOR
+    };
+    static const guint8 expected_empty[] = {
+        TLV_NDEF_MESSAGE, 0x00,
+        TLV_TERMINATOR
+    };
+    GUtilData msg;
+    GByteArray* out = g_byte_array_new();
+    guint8 buf[sizeof(expected) + 1];
+    NdefRec* rec;
+
+    TEST_BYTES_SET(msg, ndef);
+    g_assert_cmpuint(ndef_tlv_encode(&msg, NULL, NULL, 0), == ,
+        sizeof(expected));
+    memset(buf, 0xaa, sizeof(buf));
+    g_assert_cmpuint(ndef_tlv_encode(&msg, NULL, buf, sizeof(buf)), == ,
+        sizeof(expected));
+    g_assert(!memcmp(buf, expected, sizeof(expected)));
+    g_assert_cmpuint(buf[sizeof(expected)], == ,0xaa); /* Untouched */
+
+    /* Appended to what's already there */
+    g_byte_array_append(out, buf, 1);
+    g_assert_cmpuint(ndef_tlv_append(out, &msg, NULL), == ,
+        sizeof(expected));
+    g_assert_cmpuint(out->len, == ,sizeof(expected) + 1);
+    g_assert(!memcmp(out->data + 1, expected, sizeof(expected)));
+
+    /* Round trip */
+    msg.bytes = out->data + 1;
+    msg.size = out->len - 1;
+    rec = ndef_rec_new_from_tlv(&msg);
+    g_assert(rec);
+    g_assert(!rec->next);
+    g_assert_cmpuint(rec->raw.size, == ,sizeof(ndef));
+    g_assert(!memcmp(rec->raw.bytes, ndef, sizeof(ndef)));
+    g_byte_array_set_size(out, 0);
+    g_assert_cmpuint(ndef_tlv_append_rec(out, rec, NULL), == ,
+        sizeof(expected));
+    g_assert_cmpuint(out->len, == ,sizeof(expected));
+    g_assert(!memcmp(out->data, expected, sizeof(expected)));
+    ndef_rec_unref(rec);
+
+    /* Empty message */
+    msg.bytes = NULL;
+    msg.size = 0;
+    g_assert_cmpuint(ndef_tlv_encode(&msg, NULL, buf, sizeof(buf)), == ,
+        sizeof(expected_empty));
+    g_assert(!memcmp(buf, expected_empty, sizeof(expected_empty)));
+    g_byte_array_free(out, TRUE);
+}
+
+/*==========================================================================*
+ * encode_unknown
+ *==========================================================================*/
+
+static
+void
+test_tlv_encode_unknown(
+    void)
+{
+    static const guint8 ndef[] = {
+        0xd5,           /* NDEF record header (MB,ME,SR,TNF=0x05) */
+        0x00,           /* Length of the record type */
+        0x02,           /* Length of the record payload */
+        0x01, 0x02      /* Payload */
+    };
+    static const guint8 expected[] = {
+        TLV_NDEF_MESSAGE, sizeof(ndef),
+        0xd5, 0x00, 0x02, 0x01, 0x02,
+        TLV_TERMINATOR
+    };
+    GByteArray* out = g_byte_array_new();
+    GUtilData data;
+    NdefRec* rec;
+
+    /* Unknown TNF has no NDEF_TNF counterpart but must be preserved */
+    TEST_BYTES_SET(data, ndef);
+    rec = ndef_rec_new(&data);
+    g_assert(rec);
+    g_assert_cmpint(rec->tnf, == ,NDEF_TNF_EMPTY);
+    g_assert_cmpuint(rec->payload.size, == ,2);
+    g_assert_cmpuint(ndef_tlv_append_rec(out, rec, NULL), == ,
+        sizeof(expected));
+    g_assert_cmpuint(out->len, == ,sizeof(expected));
+    g_assert(!memcmp(out->data, expected, sizeof(expected)));
+    ndef_rec_unref(rec);
+
+    /* And survives the round trip */
+    TEST_BYTES_SET(data, expected);
+    rec = ndef_rec_new_from_tlv(&data);
+    g_assert(rec);
+    g_assert_cmpuint(rec->raw.size, == ,sizeof(ndef));
+    g_assert(!memcmp(rec->raw.bytes, ndef, sizeof(ndef)));
+    ndef_rec_unref(rec);
+    g_byte_array_free(out, TRUE);
+}
+
+/*==========================================================================*
+ * encode_long
+ *==========================================================================*/
+
+static
+void
+test_tlv_encode_long(
+    void)
+{
+    static const guint8 hdr[] = {
+        0x91,           /* NDEF record header (MB,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x00,           /* Length of the record payload */
+        'x',            /* Record type: 'x' */
+        0x42,                   /* NDEF record header (ME,TNF=0x02) */
+        0x03,                   /* Length of the record type */
+        0x00, 0x00, 0x01, 0x00, /* Length of the record payload */
+        'a', '/', 'b'           /* Record type */
+    };
+    static const guint8 big[256] = { 0 };
+    const guint len = sizeof(hdr) + sizeof(big);
+    guint8* ndef = g_malloc(len);
+    GByteArray* out = g_byte_array_new();
+    GUtilData msg, value;
+    NdefRec* rec;
+
+    memcpy(ndef, hdr, sizeof(hdr));
+    memcpy(ndef + sizeof(hdr), big, sizeof(big));
+    msg.bytes = ndef;
+    msg.size = len;
+
+    /* Three consecutive bytes length format */
+    g_assert_cmpuint(ndef_tlv_append(out, &msg, NULL), == ,len + 5);
+    g_assert_cmpuint(out->len, == ,len + 5);
+    g_assert_cmpuint(out->data[0], == ,TLV_NDEF_MESSAGE);
+    g_assert_cmpuint(out->data[1], == ,0xff);
+    g_assert_cmpuint(out->data[2], == ,len >> 8);
+    g_assert_cmpuint(out->data[3], == ,len & 0xff);
+    g_assert(!memcmp(out->data + 4, ndef, len));
+    g_assert_cmpuint(out->data[len + 4], == ,TLV_TERMINATOR);
+
+    /* Records are encoded back into the same message */
+    rec = ndef_rec_new(&msg);
+    g_assert(rec);
+    g_byte_array_set_size(out, 0);
+    g_assert_cmpuint(ndef_tlv_append_rec(out, rec, NULL), == ,len + 5);
+    msg.bytes = out->data;
+    msg.size = out->len;
+    g_assert_cmpuint(ndef_tlv_next(&msg, &value), == ,TLV_NDEF_MESSAGE);
+    g_assert_cmpuint(value.size, == ,len);
+    g_assert(!memcmp(value.bytes, ndef, len));
+    ndef_rec_unref(rec);
+    g_byte_array_free(out, TRUE);
+    g_free(ndef);
+}
+
+/*==========================================================================*
+ * encode_control
+ *==========================================================================*/
+
+static
+void
+test_tlv_encode_control(
+    void)
+{
+    static const guint8 lock[] = { 0xa0, 0x10, 0x44 };
+    static const guint8 mem[] = { 0x4c, 0x02 };
+    static const guint8 expected[] = {
+        TLV_LOCK_CONTROL, 0x03, 0xa0, 0x10, 0x44,
+        TLV_MEMORY_CONTROL, 0x02, 0x4c, 0x02,
+        TLV_NDEF_MESSAGE, 0x03, 0xd0, 0x00, 0x00,
+        TLV_TERMINATOR,
+        TLV_NULL
+    };
+    static const guint8 empty[] = { 0xd0, 0x00, 0x00 };
+    NdefTlvParams params;
+    GUtilData ctl[2], msg, buf, value;
+    NdefRec* rec;
+    guint8 out[sizeof(expected)];
+
+    TEST_BYTES_SET(ctl[0], lock);
+    TEST_BYTES_SET(ctl[1], mem);
+    TEST_BYTES_SET(msg, empty);
+    memset(&params, 0, sizeof(params));
+    params.lock_control = ctl;
+    params.lock_control_count = 1;
+    params.memory_control = ctl + 1;
+    params.memory_control_count = 1;
+    params.page_size = 4;
+
+    /* Padded to the page boundary */
+    g_assert_cmpuint(ndef_tlv_encode(&msg, &params, NULL, 0), == ,
+        sizeof(expected));
+    g_assert_cmpuint(ndef_tlv_encode(&msg, &params, out, sizeof(out) - 1),
+        == ,0);
+    g_assert_cmpuint(ndef_tlv_encode(&msg, &params, out, sizeof(out)),
+        == ,sizeof(expected));
+    g_assert(!memcmp(out, expected, sizeof(expected)));
+    TEST_BYTES_SET(buf, out);
+    g_assert_cmpuint(ndef_tlv_check(&buf), == ,sizeof(expected) - 1);
+    g_assert_cmpuint(ndef_tlv_next(&buf, &value), == ,TLV_LOCK_CONTROL);
+    g_assert_cmpuint(ndef_tlv_next(&buf, &value), == ,TLV_MEMORY_CONTROL);
+    g_assert_cmpuint(ndef_tlv_next(&buf, &value), == ,TLV_NDEF_MESSAGE);
+    g_assert_cmpuint(ndef_tlv_next(&buf, &value), == ,0);
+
+    /* Larger pages */
+    params.page_size = 12;
+    g_assert_cmpuint(ndef_tlv_encode(&msg, &params, NULL, 0), == ,24);
+
+    /* No padding is needed if the size is already aligned */
+    params.page_size = 15;
+    g_assert_cmpuint(ndef_tlv_encode(&msg, &params, NULL, 0), == ,15);
+    params.page_size = 0;
+    g_assert_cmpuint(ndef_tlv_encode(&msg, &params, NULL, 0), == ,15);
+
+    /* And it's still parseable */
+    TEST_BYTES_SET(buf, out);
+    rec = ndef_rec_new_from_tlv(&buf);
+    g_assert(rec);
+    g_assert_cmpuint(rec->tnf, == ,NDEF_TNF_EMPTY);
+    ndef_rec_unref(rec);
+}
+
 /*==========================================================================*
  * Common
  *==========================================================================*/
@@ -225,6 +508,11 @@ int main(int argc, char* argv[])
         g_test_add_data_func(path, test, test_tlv_ndef);
         g_free(path);
     }
+    g_test_add_func(TEST_("encode_null"), test_tlv_encode_null);
+    g_test_add_func(TEST_("encode_basic"), test_tlv_encode_basic);
+    g_test_add_func(TEST_("encode_unknown"), test_tlv_encode_unknown);
+    g_test_add_func(TEST_("encode_long"), test_tlv_encode_long);
+    g_test_add_func(TEST_("encode_control"), test_tlv_encode_control);
     test_init(&test_opt, argc, argv);
     return g_test_run();
 }
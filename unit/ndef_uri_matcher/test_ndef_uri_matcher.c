@@ -0,0 +1,291 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "test_common.h"
+
+#include "ndef_rec.h"
+#include "ndef_uri_matcher.h"
+
+static TestOpt test_opt;
+
+static
+gint
+test_match(
+    const NdefUriMatcher* matcher,
+    const char* uri)
+{
+    const gsize len = strlen(uri);
+    guint8* buf = g_malloc(len + 1);
+    NdefRecU* urec = ndef_rec_u_new(uri);
+    GUtilData payload;
+    gint index = ndef_uri_matcher_match_uri(matcher, uri);
+
+    /* Abbreviated */
+    g_assert_cmpint(ndef_uri_matcher_match(matcher, &urec->rec.payload), == ,
+        index);
+    ndef_rec_unref(&urec->rec);
+
+    /* Not abbreviated */
+    buf[0] = 0;
+    memcpy(buf + 1, uri, len);
+    payload.bytes = buf;
+    payload.size = len + 1;
+    g_assert_cmpint(ndef_uri_matcher_match(matcher, &payload), == ,index);
+    g_free(buf);
+    return index;
+}
+
+/*==========================================================================*
+ * null
+ *==========================================================================*/
+
+static
+void
+test_null(
+    void)
+{
+    static const guint8 bad[] = { 0x24, 'x' };
+    static const char* patterns[] = { "**", NULL };
+    NdefUriMatcher* matcher = ndef_uri_matcher_new(patterns);
+    GUtilData payload;
+
+    ndef_uri_matcher_free(NULL);
+    g_assert_cmpint(ndef_uri_matcher_match(NULL, NULL), == ,-1);
+    g_assert_cmpint(ndef_uri_matcher_match_uri(NULL, NULL), == ,-1);
+    g_assert_cmpint(ndef_uri_matcher_match(matcher, NULL), == ,-1);
+    g_assert_cmpint(ndef_uri_matcher_match_uri(matcher, NULL), == ,-1);
+
+    /* Empty and invalid payloads don't match anything */
+    memset(&payload, 0, sizeof(payload));
+    g_assert_cmpint(ndef_uri_matcher_match(matcher, &payload), == ,-1);
+    TEST_BYTES_SET(payload, bad);
+    g_assert_cmpint(ndef_uri_matcher_match(matcher, &payload), == ,-1);
+    g_assert_cmpint(test_match(matcher, ""), == ,0);
+    ndef_uri_matcher_free(matcher);
+
+    /* No patterns, no matches */
+    matcher = ndef_uri_matcher_new(NULL);
+    g_assert(matcher);
+    g_assert_cmpint(test_match(matcher, ""), == ,-1);
+    g_assert_cmpint(test_match(matcher, "https://www.jolla.com"), == ,-1);
+    ndef_uri_matcher_free(matcher);
+}
+
+/*==========================================================================*
+ * basic
+ *==========================================================================*/
+
+static
+void
+test_basic(
+    void)
+{
+    static const char* patterns[] = {
+        "https://www.jolla.com/",               /* 0 */
+        "https://*.jolla.com/**",               /* 1 */
+        "http*:**",                             /* 2 */
+        "tel:+358**",                           /* 3 */
+        "tel:**",                               /* 4 */
+        "mailto:*@example.com",                 /* 5 */
+        "urn:epc:id:sgtin:**",                  /* 6 */
+        "urn:nfc:wkt:*",                        /* 7 */
+        "myapp://pay/*/confirm",                /* 8 */
+        "geo:\\*",                              /* 9 */
+        "",                                     /* 10 */
+        "tel:**",                               /* 11 (same as 4) */
+        NULL
+    };
+    NdefUriMatcher* matcher = ndef_uri_matcher_new(patterns);
+
+    g_assert(matcher);
+    g_assert_cmpint(test_match(matcher, "https://www.jolla.com/"), == ,0);
+    g_assert_cmpint(test_match(matcher, "https://www.jolla.com/x"), == ,1);
+    g_assert_cmpint(test_match(matcher, "https://shop.jolla.com/"), == ,1);
+    g_assert_cmpint(test_match(matcher, "https://jolla.com/"), == ,2);
+    g_assert_cmpint(test_match(matcher, "https://a/b.jolla.com/"), == ,2);
+    g_assert_cmpint(test_match(matcher, "http://www.jolla.com/"), == ,2);
+    g_assert_cmpint(test_match(matcher, "http:"), == ,2);
+    g_assert_cmpint(test_match(matcher, "htt:"), == ,-1);
+    g_assert_cmpint(test_match(matcher, "tel:+358401234567"), == ,3);
+    g_assert_cmpint(test_match(matcher, "tel:+1234567"), == ,4);
+    g_assert_cmpint(test_match(matcher, "tel:"), == ,4);
+    g_assert_cmpint(test_match(matcher, "mailto:info@example.com"), == ,5);
+    g_assert_cmpint(test_match(matcher, "mailto:@example.com"), == ,5);
+    g_assert_cmpint(test_match(matcher, "mailto:a/b@example.com"), == ,-1);
+    g_assert_cmpint(test_match(matcher, "mailto:info@example.org"), == ,-1);
+    g_assert_cmpint(test_match(matcher,
+        "urn:epc:id:sgtin:0614141.112345.400"), == ,6);
+    g_assert_cmpint(test_match(matcher, "urn:epc:id:sscc:1"), == ,-1);
+    g_assert_cmpint(test_match(matcher, "urn:nfc:wkt:U"), == ,7);
+    g_assert_cmpint(test_match(matcher, "urn:nfc:wkt:U/x"), == ,-1);
+    g_assert_cmpint(test_match(matcher, "myapp://pay/123/confirm"), == ,8);
+    g_assert_cmpint(test_match(matcher, "myapp://pay//confirm"), == ,8);
+    g_assert_cmpint(test_match(matcher, "myapp://pay/1/2/confirm"), == ,-1);
+    g_assert_cmpint(test_match(matcher, "geo:*"), == ,9);
+    g_assert_cmpint(test_match(matcher, "geo:60.1,24.9"), == ,-1);
+    g_assert_cmpint(test_match(matcher, ""), == ,10);
+    g_assert_cmpint(test_match(matcher, "x"), == ,-1);
+    ndef_uri_matcher_free(matcher);
+}
+
+/*==========================================================================*
+ * lazy
+ *==========================================================================*/
+
+static
+void
+test_lazy(
+    void)
+{
+    static const guint8 jolla_rec[] = {
+        0xd1,           /* NDEF record header (MB,ME,SR,TNF=0x01) */
+        0x01,           /* Length of the record type */
+        0x0a,           /* Length of the record payload */
+        'U',            /* Record type: 'U' */
+        0x02,           /* "https://www." */
+        'j', 'o', 'l', 'l', 'a', '.', 'c', 'o', 'm'
+    };
+    static const char* patterns[] = { "https://*.jolla.com", NULL };
+    NdefUriMatcher* matcher = ndef_uri_matcher_new(patterns);
+    GUtilData data;
+    NdefRec* rec;
+
+    /* The URI doesn't get decoded */
+    TEST_BYTES_SET(data, jolla_rec);
+    rec = ndef_rec_new_full(&data, NDEF_PARSE_FLAG_LAZY);
+    g_assert(NDEF_IS_REC_U(rec));
+    g_assert_cmpint(ndef_uri_matcher_match(matcher, &rec->payload), == ,0);
+    g_assert(!NDEF_REC_U(rec)->uri);
+    ndef_rec_unref(rec);
+    ndef_uri_matcher_free(matcher);
+}
+
+/*==========================================================================*
+ * perf
+ *==========================================================================*/
+
+/*
+ * Matching rate as a function of the number of patterns.
+ * Only runs in the perf mode (-m perf).
+ */
+static
+void
+test_perf(
+    void)
+{
+    const guint rounds = 200000;
+    static const char* uris[] = {
+        "https://shop.site42.example.com/item/12345",
+        "https://www.site999.example.com/",
+        "http://www.example.com/index.html",
+        "tel:+358401234567",
+        "urn:epc:id:sgtin:0614141.112345.400"
+    };
+    GUtilData payloads[G_N_ELEMENTS(uris)];
+    NdefRecU* urecs[G_N_ELEMENTS(uris)];
+    guint n, i, k;
+
+    for (i = 0; i < G_N_ELEMENTS(uris); i++) {
+        urecs[i] = ndef_rec_u_new(uris[i]);
+        payloads[i] = urecs[i]->rec.payload;
+    }
+    for (n = 10; n <= 1000; n *= 10) {
+        char** patterns = g_new0(char*, n + 1);
+        NdefUriMatcher* matcher;
+        gdouble secs, rate;
+        gint total = 0;
+
+        for (i = 0; i < n; i++) {
+            patterns[i] = g_strdup_printf((i % 2) ?
+                "https://*.site%u.example.com/**" :
+                "myapp%u://pay/*/confirm", i);
+        }
+        g_test_timer_start();
+        matcher = ndef_uri_matcher_new((const char* const*)patterns);
+        secs = g_test_timer_elapsed();
+        g_assert(matcher);
+        g_test_message("%u patterns compiled in %.3f sec", n, secs);
+
+        g_test_timer_start();
+        for (k = 0; k < rounds; k++) {
+            for (i = 0; i < G_N_ELEMENTS(payloads); i++) {
+                total += ndef_uri_matcher_match(matcher, payloads + i);
+            }
+        }
+        secs = g_test_timer_elapsed();
+        rate = rounds * G_N_ELEMENTS(payloads) / MAX(secs, 1e-6);
+        g_test_maximized_result(rate, "%u patterns: %.0f URIs/sec", n, rate);
+        g_assert(total);
+
+        ndef_uri_matcher_free(matcher);
+        g_strfreev(patterns);
+    }
+    for (i = 0; i < G_N_ELEMENTS(uris); i++) {
+        ndef_rec_unref(&urecs[i]->rec);
+    }
+}
+
+/*==========================================================================*
+ * Common
+ *==========================================================================*/
+
+#define TEST_(t) "/ndef_uri_matcher/" t
+
+int main(int argc, char* argv[])
+{
+    G_GNUC_BEGIN_IGNORE_DEPRECATIONS;
+    g_type_init();
+    G_GNUC_END_IGNORE_DEPRECATIONS;
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func(TEST_("null"), test_null);
+    g_test_add_func(TEST_("basic"), test_basic);
+    g_test_add_func(TEST_("lazy"), test_lazy);
+    if (g_test_perf()) {
+        g_test_add_func(TEST_("perf"), test_perf);
+    }
+    test_init(&test_opt, argc, argv);
+    return g_test_run();
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */